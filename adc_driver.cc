@@ -6,6 +6,7 @@
  *    \li  00-00-00  The Big Bang occurred, followed by the invention of waffles
  *    \li  04-10-08  Code is finished, except that it doesn't work
  *    \li  04-14-08  Implemented new "non-broken" functionality
+ *    \li  10-16-26  The banner goes through STL_LOG_WRITE so it can be compiled out
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -18,6 +19,7 @@
 
 #include "rs232.h"                          // Include header for serial port class
 #include "adc_driver.h"                        // Include header for the A/D class
+#include "stl_log_level.h"                  // Text messages filtered by module and level
 
 
 #define ADC_RETRIES      10000              //!< Retries before giving up on conversion
@@ -53,9 +55,8 @@ adc_driver::adc_driver (base_text_serial* p_serial_port)
 {
 	ptr_to_serial = p_serial_port;          // Store the serial port pointer locally
 
-	// Note that ptr_to_serial is a pointer; the "*" is needed to indicate "the serial
-	// port which is pointed to by the pointer" 
-	*ptr_to_serial << "Setting up AVR A/D converter" << endl;
+	// The banner is only compiled in if the ADC module's messages are turned on
+	STL_LOG_WRITE (ADC, INFO, ptr_to_serial, F ("Setting up AVR A/D converter") << endl);
 
 	// Turns on A/D converter without interrupts and in single sample mode,
 	// with prescaler set to 64
@@ -121,14 +122,14 @@ base_text_serial& operator<< (base_text_serial& serial, adc_driver& my_adc)
 
 
 	// Outputs to the serial port
-	serial  << 	"A/D registers of interest:" << endl << 
-		"ADMUX: " << ADMUX << endl << 
-		"ADCSRA: " << ADCSRA << endl << 
-		"Current value of channels:" << endl <<
-		"Channel 0: " << channel0 << "   in MilliVolt: " << vchannel0 << endl <<
-		"Channel 1: " << channel1 << "   in MilliVolt: " << vchannel1 << endl <<
-		"Channel 2: " << channel2 << "   in MilliVolt: " << vchannel2 << endl << 
-		"Channel 3: " << channel3 << "   in MilliVolt: " << vchannel3 << endl << endl << endl;
+	serial  << 	F ("A/D registers of interest:") << endl << 
+		F ("ADMUX: ") << ADMUX << endl << 
+		F ("ADCSRA: ") << ADCSRA << endl << 
+		F ("Current value of channels:") << endl <<
+		F ("Channel 0: ") << channel0 << F ("   in MilliVolt: ") << vchannel0 << endl <<
+		F ("Channel 1: ") << channel1 << F ("   in MilliVolt: ") << vchannel1 << endl <<
+		F ("Channel 2: ") << channel2 << F ("   in MilliVolt: ") << vchannel2 << endl << 
+		F ("Channel 3: ") << channel3 << F ("   in MilliVolt: ") << vchannel3 << endl << endl << endl;
 
 	return (serial);
 }
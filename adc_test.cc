@@ -47,7 +47,7 @@ int main ()
     sharp_sensor_driver sharp_sensor (&the_serial_port);
 
     // Say hello
-    the_serial_port << "\r\nAnalog to Digital Test Program v0.002\r\n";
+    the_serial_port << F ("\r\nAnalog to Digital Test Program v0.002\r\n");
 
     // Run the main scheduling loop, in which the action to run is done repeatedly.
     // In the future, we'll run tasks here; for now, just do things in a simple loop
@@ -62,9 +62,9 @@ int main ()
 
 	    // Calls the overloaded << operator to print diagnostic information about
 	    // the A/D conversion ports
-            the_serial_port << "A/D value: " << sharp_sensor.get_reading() << endl;
-            the_serial_port << "Distance: " << sharp_sensor.get_distance() << endl;
-	    the_serial_port << "-------------------------------------------------" << endl;
+            the_serial_port << F ("A/D value: ") << sharp_sensor.get_reading() << endl;
+            the_serial_port << F ("Distance: ") << sharp_sensor.get_distance() << endl;
+	    the_serial_port << F ("-------------------------------------------------") << endl;
             }
         }
 
@@ -5,6 +5,9 @@
  *  Revisions:
  *    \li  05-01-08  Created files
  *    \li  05-01-08  Avoiding splitting into gear_controls class and controls class
+ *    \li  10-16-26  Added a Timer 3 interrupt driven control lane
+ *    \li  10-16-26  Added get_motor_gear_position(), which was used but missing
+ *    \li  10-16-26  Replaced the commented-out debug line with binary telemetry
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -27,6 +30,8 @@ long ISR_encoder_gear_max_value; //!< Number of pulses per revolution of geartra
 unsigned int ISR_motor_position; //!< Current position of the motor shaft, in encoder pulses
 unsigned long ISR_gear_position; //!< Current position of the output of the geartrain, in encoder pulses
 int ISR_gear_position_degrees; //!< Current position of the output of the geartrain, in degrees
+controls* ISR_control_lane = NULL; //!< Controller run by the Timer 3 compare interrupt, if any
+unsigned int ISR_lane_overruns; //!< Number of control lane runs which took longer than one period
 
 
 /** ISR for encoder pins picked up on pin four. Increments/decrements position based on
@@ -97,6 +102,20 @@ ISR(INT5_vect){
 	}
 }
 
+/** ISR for the Timer 3 compare match which runs the control lane. The timer runs in CTC
+ * mode, so this happens once per control period no matter how busy the tasks are. If the
+ * next compare match has already happened by the time the controller is done, the
+ * controller is taking longer than one period and an overrun is counted
+ */
+ISR(TIMER3_COMPA_vect){
+	if(ISR_control_lane != NULL){
+		ISR_control_lane->control_lane_ISR();
+	}
+	if(ETIFR & BV(OCF3A)){
+		ISR_lane_overruns += 1;
+	}
+}
+
 //-------------------------------------------------------------------------------------
 /** \brief Constructor which initializes interrupts
  *
@@ -123,6 +142,10 @@ controls::controls (base_text_serial* p_serial_port) : motor_driver(p_serial_por
 	// Zero error_count
 	error_count = 0;
 
+	#ifdef STL_TELEMETRY
+	p_telemetry = NULL;
+	#endif
+
 	// Initialize constants
 	motor_position = 0;
 	gear_position = 0;
@@ -145,6 +168,9 @@ controls::controls (base_text_serial* p_serial_port) : motor_driver(p_serial_por
 	ISR_encoder_pin_A = (PORTE & 0x10);
 	ISR_encoder_pin_B = (PORTE & 0x20);
 
+	// The control lane isn't running until start_control_lane() is called
+	lane_running = false;
+	ISR_lane_overruns = 0;
 
 	// Enable interrupts
 	sei();
@@ -190,6 +216,23 @@ void controls::update_ISR_values(){
 	sei();
 }
 
+/** \brief Returns the current geartrain position in degrees
+ *
+ *  Unlike get_gear_position_degrees(), this reads the position kept by the encoder
+ *  interrupts rather than the copy made by update_ISR_values(), so it's up to date
+ *  \return Current geartrain position in degrees
+ */
+int controls::get_motor_gear_position(void){
+	unsigned long position;
+	unsigned char sreg = SREG;
+
+	cli();
+	position = ISR_gear_position;
+	SREG = sreg;
+
+	return (long)(position * 360) / encoder_gear_max_value;
+}
+
 //-------------------------------------------------------------------------------------
 /** Starts a position controller to tell the motor to move to a position desired_position
  *  degrees from the reference position.
@@ -247,17 +290,41 @@ void controls::start_geared_position_control(int desired_position_degrees, int k
 }
 
 /** \brief Recalculates motor power
+ *
+ *  This method reads the geartrain position from the encoder interrupt's variables and
+ *  runs one step of the geared position controller. It's used when the controller is
+ *  run from a task; when the control lane is running, the Timer 3 interrupt runs the
+ *  controller instead and this method does nothing
+ */
+void controls::update_geared_position_control(void){
+	unsigned long position;
+
+	if(lane_running){
+		return;
+	}
+
+	// Get a consistent copy of the position, which the encoder interrupts change
+	cli();
+	position = ISR_gear_position;
+	sei();
+
+	geared_position_step(position);
+}
+
+/** \brief Runs one step of the geared position controller
  *
  *  This method first calculates the error between current and desired position.
  *  Once that value is found, it's added to the gear_position_error_sum variable
  *  in order to numerically integrate the error. These two values are multiplied
  *  by the gains kp and ki, respectively, to output a value to send to the set_power
- *  method
+ *  method. It doesn't turn interrupts on or off and doesn't print anything, so it
+ *  can be called from the control lane interrupt; its run time doesn't depend on
+ *  the position or the gains
+ *  \param position The position of the geartrain output, in encoder pulses
  */
-void controls::update_geared_position_control(void){
+void controls::geared_position_step(unsigned long position){
 	//Get position in degrees
-	cli();
-	ISR_gear_position_degrees = (long)(ISR_gear_position * 360) / encoder_gear_max_value;
+	ISR_gear_position_degrees = (long)(position * 360) / encoder_gear_max_value;
 
 	// Calculate error
 	if(desired_gear_position > ISR_gear_position_degrees){
@@ -266,7 +333,6 @@ void controls::update_geared_position_control(void){
 	else{
 		gear_position_error = -(ISR_gear_position_degrees - desired_gear_position);
 	}
-	sei();
 
 	//Deals with crossing zero degrees
 	if(gear_position_error > 180){
@@ -282,9 +348,6 @@ void controls::update_geared_position_control(void){
 	// Generate motor setting output
 	motor_setting = gear_position_error * kp + gear_position_error_sum * ki;
 
-	// Debug string
-	//*ptr_to_serial << ISR_gear_position_degrees << "   " << desired_gear_position << "   " << gear_position_error << "   " << gear_position_error_sum << "   " << motor_setting << "                           \r";
-
 	// Saturation control
 	if(motor_setting > 150){
 		motor_setting = 150;
@@ -293,16 +356,99 @@ void controls::update_geared_position_control(void){
 		motor_setting = -150;
 	}
 
+	#ifdef STL_TELEMETRY
+	// Save the controller's state for the telemetry task to send later
+	if(p_telemetry != NULL){
+		int16_t signals[CTL_TELEM_SIGNALS];
+		signals[CTL_TELEM_POSITION] = ISR_gear_position_degrees;
+		signals[CTL_TELEM_TARGET] = desired_gear_position;
+		signals[CTL_TELEM_ERROR] = gear_position_error;
+		signals[CTL_TELEM_ERROR_SUM] = gear_position_error_sum;
+		signals[CTL_TELEM_SETTING] = motor_setting;
+		p_telemetry->sample(signals, CTL_TELEM_SIGNALS);
+	}
+	#endif
+
 	// Sets motor power
 	set_power(motor_setting);
 }
 
+//-------------------------------------------------------------------------------------
+/** \brief Starts running the geared position controller from a timer interrupt
+ *
+ *  Timer 3 is set up in CTC mode with a /8 prescaler, so it counts microseconds with
+ *  an 8 MHz crystal, and its compare match interrupt runs one step of the geared
+ *  position controller every period. This gives the controller the same sample time
+ *  no matter how long the tasks take, so the gains don't need retuning when the tasks
+ *  change. start_geared_position_control() should be called first to set the target
+ *  \param period_us Time between runs of the controller, in microseconds
+ */
+void controls::start_control_lane(unsigned int period_us){
+	// Stop the timer while it's being set up
+	TCCR3B = 0;
+	TCCR3A = 0;
+	TCNT3 = 0;
+	OCR3A = period_us - 1;
+
+	ISR_control_lane = this;
+	ISR_lane_overruns = 0;
+	lane_running = true;
+
+	// Clear any old compare match, enable its interrupt, and start the timer in CTC mode
+	ETIFR = BV(OCF3A);
+	sbi(ETIMSK, OCIE3A);
+	TCCR3B = BV(WGM32) | BV(CS31);
+}
+
+//-------------------------------------------------------------------------------------
+/** \brief Stops the control lane interrupt
+ *
+ *  After this method is called, the geared position controller only runs when
+ *  update_geared_position_control() is called. The motor power is left where the
+ *  controller last set it
+ */
+void controls::stop_control_lane(void){
+	cbi(ETIMSK, OCIE3A);
+	TCCR3B = 0;
+	lane_running = false;
+	ISR_control_lane = NULL;
+}
+
+//-------------------------------------------------------------------------------------
+/** \brief Returns the number of times the controller took longer than one period
+ *  \return Number of control lane overruns since the lane was started
+ */
+unsigned int controls::get_lane_overruns(void){
+	unsigned int overruns;
+
+	cli();
+	overruns = ISR_lane_overruns;
+	sei();
+
+	return overruns;
+}
+
+//-------------------------------------------------------------------------------------
+/** \brief Runs one step of the controller from the control lane interrupt
+ *
+ *  Interrupts are already off inside the ISR, so the encoder position can be read
+ *  directly
+ */
+void controls::control_lane_ISR(void){
+	geared_position_step(ISR_gear_position);
+}
+
 /** \brief Changes the desired gear position to a new value
  *  \param new_position New position to be held by the geartrain output shaft
  */
 void controls::change_gear_position(int new_position){
-	// Changes gear position to a new position
+	unsigned char sreg = SREG;
+
+	// Changes gear position to a new position; the control lane interrupt reads it, so
+	// it mustn't be changed halfway through a run of the controller
+	cli();
 	desired_gear_position = new_position;
+	SREG = sreg;
 }
 //--------------------------------------------------------------------------------------
 /** \brief Outputs a debug string
@@ -310,11 +456,6 @@ void controls::change_gear_position(int new_position){
 
 base_text_serial& operator<< (base_text_serial& serial, controls& controller)
 {
-	// Outputs to the serial port
-	serial << "kp: " << controller.get_kp() << "\n\rki: " << controller.get_ki() << "\n\rMotor position: " 
-		<< controller.get_motor_position() << "\n\rGear Position: " << controller.get_motor_gear_position() 
-		<< "\n\rErrors: " << controller.get_errors() << "\n\rMotor position(degrees): " 
-		<< controller.get_motor_position_degrees() << "\n\rGear position(degrees): " << controller.get_gear_position_degrees() << endl;
-
+	write_controls (serial, controller);
 	return (serial);
 }
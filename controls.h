@@ -4,6 +4,11 @@
  *
  *  Revisions:
  *    \li  05-01-08  Created files
+ *    \li  10-16-26  Added a Timer 3 interrupt driven control lane
+ *    \li  10-16-26  Added get_motor_gear_position(), which was used but missing
+ *    \li  10-16-26  The geared position controller can send its state as telemetry
+ *    \li  10-16-26  The state report is a template, so it can go to a text_stream
+ *    \li  10-16-26  The report's operator<< only takes serial ports and text streams
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -22,6 +27,19 @@
 // Including header files
 #include "rs232.h"      
 #include "motor_driver.h"
+#include "stl_telemetry.h"
+#include "text_stream.h"
+
+/** Default period of the control lane, in microseconds (Timer 3 counts at 1 MHz) */
+#define CONTROL_LANE_PERIOD	1000
+
+// Telemetry channels which the geared position controller fills in each step
+#define CTL_TELEM_POSITION	0	//!< Geartrain position, in degrees
+#define CTL_TELEM_TARGET	1	//!< Desired geartrain position, in degrees
+#define CTL_TELEM_ERROR		2	//!< Position error, in degrees
+#define CTL_TELEM_ERROR_SUM	3	//!< Integrated position error
+#define CTL_TELEM_SETTING	4	//!< Motor power setting after saturation
+#define CTL_TELEM_SIGNALS	5	//!< Number of telemetry channels
 
 /** \brief Implements PID control
  *
@@ -66,6 +84,15 @@ class controls : public motor_driver {
 		long desired_gear_position; //!< Target position of geartrain output for positional control
 		long desired_position; //!< Target position of motor output for positional control
 
+		bool lane_running; //!< True while Timer 3 is running the geared position controller
+
+		#ifdef STL_TELEMETRY
+		stl_telemetry* p_telemetry; //!< Telemetry stream which is sampled each step, if any
+		#endif
+
+		// Computes and sets motor power from a geartrain position; doesn't touch interrupts
+		void geared_position_step(unsigned long);
+
 	public:
 		controls(base_text_serial*);
 		/** \brief Sets proportional gain kp
@@ -99,7 +126,7 @@ class controls : public motor_driver {
 		/** \brief Returns current geartrain position
  		*  \return Current geartrain position
  		*/
-		int get_gear_position(void){return gear_position};
+		int get_gear_position(void){return gear_position;}
 		/** \brief Returns current motor position in degrees
  		*  \return Current motor position in degrees
  		*/
@@ -108,6 +135,8 @@ class controls : public motor_driver {
  		*  \return Current geartrain position in degrees
  		*/
 		int get_gear_position_degrees(void){return gear_position_degrees;}
+		// Reads the geartrain position in degrees directly from the encoder interrupts
+		int get_motor_gear_position(void);
 		/** \brief Returns number of errors encountered by the encoder reader
  		*  \return Errors detected
  		*/
@@ -125,12 +154,59 @@ class controls : public motor_driver {
 		void start_geared_position_control(int, int, int);
 		void update_geared_position_control(void);
 		void change_gear_position(int);
+		// Fixed rate control lane methods
+		void start_control_lane(unsigned int = CONTROL_LANE_PERIOD);
+		void stop_control_lane(void);
+		/** \brief Returns whether the control lane interrupt is running the controller
+ 		*  \return True if the control lane is running
+ 		*/
+		bool control_lane_running(void){return lane_running;}
+		unsigned int get_lane_overruns(void);
+		#ifdef STL_TELEMETRY
+		/** \brief Sets the telemetry stream which the geared position controller samples
+ 		*  \param p_telem Pointer to the telemetry task, or NULL to stop sampling
+ 		*/
+		void set_telemetry(stl_telemetry* p_telem){p_telemetry = p_telem;}
+		#endif
+		// Called only by the Timer 3 compare interrupt
+		void control_lane_ISR(void);
 		// Velocity control methods
 		void start_velocity_control(int); //!< Starts motor shaft velocity control
 		void start_velocity_control(int, int, int); //!< Starts motor shaft velocity control
 		void update_velocity_control(void); //!< Updates motor power value for velocity control of mototor shaft
 };
 
+//--------------------------------------------------------------------------------------
+/** \brief Writes the controller's state as text
+ *
+ *  This is a template so that the same code writes to a base_text_serial, through
+ *  its virtual methods, or to a text_stream, which calls the device directly; it's
+ *  used by the operator<< for each
+ *  \param serial The serial port or text stream to write to
+ *  \param controller The controller whose state is written
+ */
+template <class sStream>
+void write_controls (sStream& serial, controls& controller)
+{
+	serial << F ("kp: ") << controller.get_kp() << F ("\n\rki: ") << controller.get_ki() << F ("\n\rMotor position: ") 
+		<< controller.get_motor_position() << F ("\n\rGear Position: ") << controller.get_motor_gear_position() 
+		<< F ("\n\rErrors: ") << controller.get_errors() << F ("\n\rMotor position(degrees): ") 
+		<< controller.get_motor_position_degrees() << F ("\n\rGear position(degrees): ") << controller.get_gear_position_degrees() << endl;
+}
+
 base_text_serial& operator<< (base_text_serial&, controls&);
 
+//--------------------------------------------------------------------------------------
+/** \brief Outputs a debug string through a text stream, calling the device directly
+ *  \param serial The text stream to write to
+ *  \param controller The controller whose state is written
+ *  \return A reference to the same stream
+ */
+template <class sDevice>
+text_stream<sDevice>& operator<< (text_stream<sDevice>& serial, controls& controller)
+{
+	write_controls (serial, controller);
+	return (serial);
+}
+
 #endif
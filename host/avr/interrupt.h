@@ -0,0 +1,27 @@
+//======================================================================================
+/** \file interrupt.h
+ *    This file stands in for avr-libc's avr/interrupt.h when the project is compiled
+ *    for the host. Interrupt service routines become ordinary functions with the
+ *    vector's name, which the peripheral model in avr_sim.cc calls when the interrupt
+ *    is due; cli() and sei() change the I bit in the model's status register.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _HOST_AVR_INTERRUPT_H_              // To prevent interrupt.h from being
+#define _HOST_AVR_INTERRUPT_H_              // included in a source file more than once
+
+#include <avr/io.h>                         // Registers and the peripheral model
+
+#define ISR(vector) extern "C" void vector (void)
+
+#define cli() sim_cli ()
+#define sei() sim_sei ()
+
+#endif // _HOST_AVR_INTERRUPT_H_
@@ -0,0 +1,154 @@
+//======================================================================================
+/** \file io.h
+ *    This file stands in for avr-libc's avr/io.h when the project is compiled for the
+ *    host. It declares the ATmega128 registers which the project uses as variables in
+ *    the peripheral model (see avr_sim.h), along with the names of their bits.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _HOST_AVR_IO_H_                     // To prevent io.h from being included
+#define _HOST_AVR_IO_H_                     // in a source file more than once
+
+#include <stdint.h>
+#include "avr_sim.h"                        // The peripheral model
+
+// Registers with side effects are modeled by classes in avr_sim.h
+extern sim_sreg_reg SREG;
+extern sim_tcnt1_reg TCNT1;
+extern sim_flag_reg TIFR, ETIFR;
+extern sim_adcsra_reg ADCSRA;
+
+// Timers and external interrupts
+extern volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK, ETIMSK;
+extern volatile uint16_t OCR1A, OCR1B, OCR1C, ICR1;
+extern volatile uint8_t TCCR2, OCR2, TCNT2;
+extern volatile uint8_t TCCR3A, TCCR3B, TCCR3C;
+extern volatile uint16_t TCNT3, OCR3A, OCR3B, OCR3C, ICR3;
+extern volatile uint8_t EICRA, EICRB, EIMSK, EIFR, MCUCR;
+
+// Digital ports
+extern volatile uint8_t PINA, PORTA, DDRA, PINB, PORTB, DDRB, PINC, PORTC, DDRC;
+extern volatile uint8_t PIND, PORTD, DDRD, PINE, PORTE, DDRE, PINF, PORTF, DDRF;
+
+// A/D converter
+extern volatile uint8_t ADMUX, ADCL, ADCH;
+extern volatile uint16_t ADC;
+
+// UARTs and SPI
+extern volatile uint8_t UDR0, UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L;
+extern volatile uint8_t UDR1, UCSR1A, UCSR1B, UCSR1C, UBRR1H, UBRR1L;
+extern volatile uint8_t SPCR, SPSR, SPDR;
+
+// Status register bits
+#define SREG_I  7
+
+// Timer 1 and 3 bits
+#define TOIE1   2
+#define OCIE1B  3
+#define OCIE1A  4
+#define TICIE1  5
+#define TOV1    2
+#define OCF1B   3
+#define OCF1A   4
+#define ICF1    5
+#define TOIE3   2
+#define OCIE3B  3
+#define OCIE3A  4
+#define TOV3    2
+#define OCF3B   3
+#define OCF3A   4
+#define CS10    0
+#define CS11    1
+#define CS12    2
+#define WGM12   3
+#define CS30    0
+#define CS31    1
+#define CS32    2
+#define WGM32   3
+
+// External interrupt bits
+#define ISC40   0
+#define ISC41   1
+#define ISC50   2
+#define ISC51   3
+#define ISC60   4
+#define ISC61   5
+#define ISC70   6
+#define ISC71   7
+#define INT4    4
+#define INT5    5
+#define INT6    6
+#define INT7    7
+#define INTF4   4
+#define INTF5   5
+#define INTF6   6
+#define INTF7   7
+
+// Port bits used for directions
+#define DDE4    4
+#define DDE5    5
+
+// A/D converter bits
+#define ADPS0   0
+#define ADPS1   1
+#define ADPS2   2
+#define ADIE    3
+#define ADIF    4
+#define ADFR    5
+#define ADSC    6
+#define ADEN    7
+
+// UART bits
+#define MPCM0   0
+#define U2X0    1
+#define UPE0    2
+#define DOR0    3
+#define FE0     4
+#define UDRE0   5
+#define TXC0    6
+#define RXC0    7
+#define TXEN0   3
+#define RXEN0   4
+#define UDRIE0  5
+#define TXCIE0  6
+#define RXCIE0  7
+#define MPCM    0                           // The ATmega128 also has these names
+#define U2X     1                           // without port numbers
+#define UPE     2
+#define DOR     3
+#define FE      4
+#define UDRE    5
+#define TXC     6
+#define RXC     7
+#define TXEN    3
+#define RXEN    4
+#define UDRIE   5
+#define TXCIE   6
+#define RXCIE   7
+
+// SPI bits
+#define SPR0    0
+#define SPR1    1
+#define CPHA    2
+#define CPOL    3
+#define MSTR    4
+#define DORD    5
+#define SPE     6
+#define SPIE    7
+#define SPI2X   0
+#define SPIF    7
+
+// Sleep control bits in MCUCR
+#define SM2     2
+#define SM0     3
+#define SM1     4
+#define SE      5
+
+#endif // _HOST_AVR_IO_H_
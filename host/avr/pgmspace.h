@@ -0,0 +1,35 @@
+//======================================================================================
+/** \file pgmspace.h
+ *    This file stands in for avr-libc's avr/pgmspace.h when the project is compiled
+ *    for the host, where there's only one address space. Program memory data is just
+ *    constant data and the _P functions are the ordinary ones.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _HOST_AVR_PGMSPACE_H_               // To prevent pgmspace.h from being
+#define _HOST_AVR_PGMSPACE_H_               // included in a source file more than once
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define PGM_P const char*
+
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strcmp_P strcmp
+
+#endif // _HOST_AVR_PGMSPACE_H_
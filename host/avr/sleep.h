@@ -0,0 +1,32 @@
+//======================================================================================
+/** \file sleep.h
+ *    This file stands in for avr-libc's avr/sleep.h when the project is compiled for
+ *    the host. Sleeping moves the peripheral model's time forward to the next enabled
+ *    interrupt; the sleep mode is ignored.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _HOST_AVR_SLEEP_H_                  // To prevent sleep.h from being included
+#define _HOST_AVR_SLEEP_H_                  // in a source file more than once
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE         0
+#define SLEEP_MODE_ADC          (1 << SM0)
+#define SLEEP_MODE_PWR_DOWN     (1 << SM1)
+#define SLEEP_MODE_PWR_SAVE     ((1 << SM0) | (1 << SM1))
+
+#define set_sleep_mode(mode) (MCUCR = (MCUCR & ~((1 << SM0) | (1 << SM1) \
+    | (1 << SM2))) | (mode))
+#define sleep_enable() (MCUCR |= (1 << SE))
+#define sleep_disable() (MCUCR &= ~(1 << SE))
+#define sleep_cpu() sim_sleep ()
+
+#endif // _HOST_AVR_SLEEP_H_
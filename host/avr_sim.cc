@@ -0,0 +1,496 @@
+//======================================================================================
+/** \file avr_sim.cc
+ *    This file contains the peripheral model which stands in for an ATmega128 when the
+ *    project is compiled for the host. See avr_sim.h for what is and isn't modeled.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *    \li  10-16-26  Added Timer 1 compare B for the timer wheel
+ *    \li  10-16-26  Added UART transmit and receive interrupts
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "avr_sim.h"                        // Header for this file
+
+
+//--------------------------------------------------------------------------------------
+// The registers. Those with side effects are classes; the rest are plain memory
+
+sim_sreg_reg SREG;
+sim_tcnt1_reg TCNT1;
+sim_flag_reg TIFR, ETIFR;
+sim_adcsra_reg ADCSRA;
+
+volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK, ETIMSK;
+volatile uint16_t OCR1A, OCR1B, OCR1C, ICR1;
+volatile uint8_t TCCR2, OCR2, TCNT2;
+volatile uint8_t TCCR3A, TCCR3B, TCCR3C;
+volatile uint16_t TCNT3, OCR3A, OCR3B, OCR3C, ICR3;
+volatile uint8_t EICRA, EICRB, EIMSK, EIFR, MCUCR;
+
+volatile uint8_t PINA, PORTA, DDRA, PINB, PORTB, DDRB, PINC, PORTC, DDRC;
+volatile uint8_t PIND, PORTD, DDRD, PINE, PORTE, DDRE, PINF, PORTF, DDRF;
+
+volatile uint8_t ADMUX, ADCL, ADCH;
+volatile uint16_t ADC;
+
+volatile uint8_t UDR0, UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L;
+volatile uint8_t UDR1, UCSR1A, UCSR1B, UCSR1C, UBRR1H, UBRR1L;
+volatile uint8_t SPCR, SPSR, SPDR;
+
+
+//--------------------------------------------------------------------------------------
+// The interrupt service routines which the model can call. They're weak so that a
+// program which doesn't have one of them links anyway, and the model skips it
+
+extern "C" void INT4_vect (void) __attribute__ ((weak));
+extern "C" void INT5_vect (void) __attribute__ ((weak));
+extern "C" void INT6_vect (void) __attribute__ ((weak));
+extern "C" void INT7_vect (void) __attribute__ ((weak));
+extern "C" void TIMER1_COMPA_vect (void) __attribute__ ((weak));
+extern "C" void TIMER1_COMPB_vect (void) __attribute__ ((weak));
+extern "C" void TIMER1_OVF_vect (void) __attribute__ ((weak));
+extern "C" void TIMER3_COMPA_vect (void) __attribute__ ((weak));
+extern "C" void USART0_RX_vect (void) __attribute__ ((weak));
+extern "C" void USART0_UDRE_vect (void) __attribute__ ((weak));
+extern "C" void USART1_RX_vect (void) __attribute__ ((weak));
+extern "C" void USART1_UDRE_vect (void) __attribute__ ((weak));
+
+
+//--------------------------------------------------------------------------------------
+// The state of the model
+
+static uint8_t sreg_bits;                   // Contents of the status register
+static uint64_t now;                        // Simulated microseconds since reset
+static uint16_t read_cost = 4;              // Microseconds used up by each TCNT1 read
+static uint16_t adc_values[8];              // What each A/D channel will read
+
+static bool t1_running;                     // Timer 1 was counting at the last check
+static uint64_t t1_origin;                  // Time at which Timer 1's count was zero
+static uint16_t t1_stopped_count;           // Timer 1's count while it's stopped
+
+static bool t3_running;                     // Timer 3 was counting at the last check
+static uint64_t t3_next_match;              // Time of Timer 3's next compare match
+
+static const uint8_t SREG_I_MASK = (1 << SREG_I);  // Global interrupt enable bit
+
+
+//--------------------------------------------------------------------------------------
+/** This function notices timers which have been started or stopped since the last time
+ *  it was called. The model only looks at the timer control registers when it needs
+ *  to, so a timer's start is taken to be the time when the model next looks.
+ */
+
+static void sync_timers (void)
+    {
+    bool running = (TCCR1B & 0x07) != 0;
+
+    if (running && !t1_running)
+        t1_origin = now - t1_stopped_count;
+    else if (!running && t1_running)
+        t1_stopped_count = (uint16_t)(now - t1_origin);
+    t1_running = running;
+
+    // Timer 3 is only modeled in CTC mode, as used by the control lane
+    running = (TCCR3B & 0x07) != 0;
+    if (running && !t3_running)
+        t3_next_match = now + (uint16_t)(OCR3A - TCNT3) + 1;
+    t3_running = running;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function finds the first time after now at which a free running Timer 1 will
+ *  have the given count.
+ *  @param count The count to look for
+ *  @return The time in microseconds
+ */
+
+static uint64_t next_t1_count (uint16_t count)
+    {
+    uint64_t when = now + (uint16_t)(count - (uint16_t)(now - t1_origin));
+
+    return (when > now ? when : when + 0x10000);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function calls the interrupt service routines of all the enabled interrupts
+ *  whose flags are set, in the AVR's order of priority, as long as the I bit is set.
+ *  As on the real chip, the I bit is cleared while a service routine runs and each
+ *  interrupt's flag is cleared as it's serviced; a UART's RXC flag stands for the
+ *  read of the data register, which clears it on the chip. A UDRE interrupt has no
+ *  flag to clear, since the model's UARTs are always ready; its service routine must
+ *  turn it off when there's nothing more to send.
+ */
+
+static void deliver_interrupts (void)
+    {
+    void (*p_vector) (void);
+
+    while (sreg_bits & SREG_I_MASK)
+        {
+        uint8_t ext = EIFR & EIMSK & 0xF0;
+
+        if (ext)
+            {
+            uint8_t bit = ext & -ext;
+            EIFR &= ~bit;
+            p_vector = bit == 0x10 ? INT4_vect : bit == 0x20 ? INT5_vect
+                     : bit == 0x40 ? INT6_vect : INT7_vect;
+            }
+        else if (TIFR.bits & TIMSK & (1 << OCF1A))
+            {
+            TIFR.bits &= ~(1 << OCF1A);
+            p_vector = TIMER1_COMPA_vect;
+            }
+        else if (TIFR.bits & TIMSK & (1 << OCF1B))
+            {
+            TIFR.bits &= ~(1 << OCF1B);
+            p_vector = TIMER1_COMPB_vect;
+            }
+        else if (TIFR.bits & TIMSK & (1 << TOV1))
+            {
+            TIFR.bits &= ~(1 << TOV1);
+            p_vector = TIMER1_OVF_vect;
+            }
+        else if (UCSR0A & UCSR0B & (1 << RXC0))
+            {
+            UCSR0A &= ~(1 << RXC0);
+            p_vector = USART0_RX_vect;
+            }
+        else if ((UCSR0B & (1 << UDRIE0)) && USART0_UDRE_vect != NULL)
+            p_vector = USART0_UDRE_vect;
+        else if (ETIFR.bits & ETIMSK & (1 << OCF3A))
+            {
+            ETIFR.bits &= ~(1 << OCF3A);
+            p_vector = TIMER3_COMPA_vect;
+            }
+        else if (UCSR1A & UCSR1B & (1 << RXC0))
+            {
+            UCSR1A &= ~(1 << RXC0);
+            p_vector = USART1_RX_vect;
+            }
+        else if ((UCSR1B & (1 << UDRIE0)) && USART1_UDRE_vect != NULL)
+            p_vector = USART1_UDRE_vect;
+        else
+            return;
+
+        if (p_vector != NULL)
+            {
+            sreg_bits &= ~SREG_I_MASK;
+            p_vector ();
+            sreg_bits |= SREG_I_MASK;
+            }
+        }
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function finds the time of the next timer event.
+ *  @param enabled_only If true, only events whose interrupts are enabled are counted
+ *  @return The time of the next event, or 0 if there isn't one
+ */
+
+static uint64_t next_event (bool enabled_only)
+    {
+    uint64_t when = 0;
+    uint64_t t;
+
+    if (t1_running)
+        {
+        if (!enabled_only || (TIMSK & (1 << TOIE1)))
+            when = next_t1_count (0);
+        if (!enabled_only || (TIMSK & (1 << OCIE1A)))
+            if ((t = next_t1_count (OCR1A)) < when || when == 0)
+                when = t;
+        if (!enabled_only || (TIMSK & (1 << OCIE1B)))
+            if ((t = next_t1_count (OCR1B)) < when || when == 0)
+                when = t;
+        }
+    if (t3_running && (!enabled_only || (ETIMSK & (1 << OCIE3A))))
+        if (t3_next_match < when || when == 0)
+            when = t3_next_match;
+
+    return (when);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function lets time go by, setting timer flags and calling interrupt service
+ *  routines as their times come. Service routines may read TCNT1, which moves time
+ *  along while this function is running, so the time is checked after each event.
+ *  @param microsec The number of microseconds to let go by
+ */
+
+void sim_advance (uint32_t microsec)
+    {
+    uint64_t target = now + microsec;
+    uint64_t when;
+
+    while (now < target)
+        {
+        sync_timers ();
+        when = next_event (false);
+        if (when == 0 || when > target)
+            {
+            now = target;
+            break;
+            }
+
+        now = when;
+        if (t1_running && (uint16_t)(now - t1_origin) == 0)
+            TIFR.bits |= (1 << TOV1);
+        if (t1_running && (uint16_t)(now - t1_origin) == OCR1A)
+            TIFR.bits |= (1 << OCF1A);
+        if (t1_running && (uint16_t)(now - t1_origin) == OCR1B)
+            TIFR.bits |= (1 << OCF1B);
+        if (t3_running && now == t3_next_match)
+            {
+            ETIFR.bits |= (1 << OCF3A);
+            t3_next_match += (uint32_t)OCR3A + 1;
+            }
+        deliver_interrupts ();
+        }
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function puts the model back the way a processor is after a reset, except
+ *  that the UART status registers show empty transmit buffers. The cost of a TCNT1
+ *  read is left as it was set.
+ */
+
+void sim_reset (void)
+    {
+    sreg_bits = 0;
+    now = 0;
+    t1_running = t3_running = false;
+    t1_origin = t3_next_match = 0;
+    t1_stopped_count = 0;
+    TIFR.bits = ETIFR.bits = 0;
+    ADCSRA = 0;
+    TCCR1A = TCCR1B = TCCR1C = TIMSK = ETIMSK = 0;
+    OCR1A = OCR1B = OCR1C = ICR1 = 0;
+    TCCR3A = TCCR3B = TCCR3C = 0;
+    TCNT3 = OCR3A = OCR3B = OCR3C = ICR3 = 0;
+    EICRA = EICRB = EIMSK = EIFR = MCUCR = 0;
+    UCSR0A = UCSR1A = (1 << UDRE0);
+    memset (adc_values, 0, sizeof (adc_values));
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function returns the simulated time.
+ *  @return The number of simulated microseconds since the model was reset
+ */
+
+uint64_t sim_time (void)
+    {
+    return (now);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function sets how much time each read of TCNT1 uses up. Since time only moves
+ *  when the program reads the timer or sleeps, this stands in for the time taken by
+ *  all the code which runs between reads.
+ *  @param microsec The number of microseconds which each read takes
+ */
+
+void sim_set_read_cost (uint16_t microsec)
+    {
+    read_cost = microsec;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function sets the result which conversions on an A/D channel will give.
+ *  @param channel The channel number, 0 through 7
+ *  @param value The 10-bit result
+ */
+
+void sim_set_adc (uint8_t channel, uint16_t value)
+    {
+    adc_values[channel & 0x07] = value & 0x03FF;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function sets the flag of one of the external interrupts INT4 through INT7, as
+ *  if the pin had changed, and services it right away if it's enabled.
+ *  @param number The number of the external interrupt, 4 through 7
+ */
+
+void sim_external_interrupt (uint8_t number)
+    {
+    EIFR |= (1 << number) & 0xF0;
+    deliver_interrupts ();
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function gives one of the UARTs a character, as if it had just come in on the
+ *  line, and services the receive interrupt right away if it's enabled. If the last
+ *  character hasn't been read yet, it's lost and the data overrun flag is set.
+ *  @param port The number of the UART, 0 or 1
+ *  @param data The character which was received
+ */
+
+void sim_uart_receive (uint8_t port, uint8_t data)
+    {
+    volatile uint8_t& status = (port == 0) ? UCSR0A : UCSR1A;
+
+    if (status & (1 << RXC0))
+        status |= (1 << DOR0);
+    else
+        status &= ~(1 << DOR0);
+    (port == 0 ? UDR0 : UDR1) = data;
+    status |= (1 << RXC0);
+    deliver_interrupts ();
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function makes time go by until the next enabled interrupt has been serviced,
+ *  if sleep has been enabled; otherwise it does nothing, like the SLEEP instruction.
+ */
+
+void sim_sleep (void)
+    {
+    uint64_t when;
+
+    if (!(MCUCR & (1 << SE)))
+        return;
+
+    sync_timers ();
+    if ((when = next_event (true)) != 0)
+        sim_advance ((uint32_t)(when - now));
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** These functions clear and set the I bit in the status register. They're called by
+ *  cli() and sei(); being functions in another file, they also keep the compiler from
+ *  moving memory accesses across them, as the real instructions do.
+ */
+
+void sim_cli (void)
+    {
+    sreg_bits &= ~SREG_I_MASK;
+    }
+
+void sim_sei (void)
+    {
+    sreg_bits |= SREG_I_MASK;
+    deliver_interrupts ();
+    }
+
+
+//--------------------------------------------------------------------------------------
+// Methods of the registers which have side effects
+
+sim_sreg_reg::operator uint8_t () const
+    {
+    deliver_interrupts ();
+    return (sreg_bits);
+    }
+
+sim_sreg_reg& sim_sreg_reg::operator= (uint8_t value)
+    {
+    sreg_bits = value;
+    deliver_interrupts ();
+    return (*this);
+    }
+
+sim_tcnt1_reg::operator uint16_t () const
+    {
+    uint16_t count;
+
+    sync_timers ();
+    count = t1_running ? (uint16_t)(now - t1_origin) : t1_stopped_count;
+    sim_advance (read_cost);
+    return (count);
+    }
+
+sim_tcnt1_reg& sim_tcnt1_reg::operator= (uint16_t value)
+    {
+    sync_timers ();
+    t1_origin = now - value;
+    t1_stopped_count = value;
+    return (*this);
+    }
+
+sim_adcsra_reg& sim_adcsra_reg::operator= (uint8_t value)
+    {
+    if ((value & (1 << ADSC)) && (value & (1 << ADEN)))
+        {
+        ADC = adc_values[ADMUX & 0x07];
+        ADCL = ADC & 0xFF;
+        ADCH = ADC >> 8;
+        value |= (1 << ADIF);
+        }
+    bits = value & ~(1 << ADSC);
+    return (*this);
+    }
+
+
+//--------------------------------------------------------------------------------------
+// Number to string conversions which avr-libc has and the host's library doesn't
+
+static char* unsigned_to_string (unsigned long number, char* buffer, int radix)
+    {
+    char reversed[8 * sizeof (long) + 1];
+    char* p_out = buffer;
+    unsigned char count = 0;
+
+    do
+        {
+        unsigned char digit = number % radix;
+        reversed[count++] = digit < 10 ? '0' + digit : 'a' - 10 + digit;
+        number /= radix;
+        }
+    while (number != 0);
+
+    while (count > 0)
+        *p_out++ = reversed[--count];
+    *p_out = '\0';
+
+    return (buffer);
+    }
+
+char* ultoa (unsigned long number, char* buffer, int radix)
+    {
+    return (unsigned_to_string (number, buffer, radix));
+    }
+
+char* ltoa (long number, char* buffer, int radix)
+    {
+    if (number < 0 && radix == 10)
+        {
+        buffer[0] = '-';
+        unsigned_to_string (-(unsigned long)number, buffer + 1, radix);
+        return (buffer);
+        }
+    return (unsigned_to_string ((unsigned long)number, buffer, radix));
+    }
+
+char* utoa (unsigned int number, char* buffer, int radix)
+    {
+    return (unsigned_to_string (number, buffer, radix));
+    }
+
+char* itoa (int number, char* buffer, int radix)
+    {
+    if (number < 0 && radix == 10)
+        return (ltoa (number, buffer, radix));
+    return (unsigned_to_string ((unsigned int)number, buffer, radix));
+    }
@@ -0,0 +1,121 @@
+//======================================================================================
+/** \file avr_sim.h
+ *    This file contains a simple model of the ATmega128 peripherals which the project
+ *    uses, so that the scheduler, timer, control and task code can be compiled and run
+ *    natively on a PC. The headers in host/avr/ stand in for avr-libc's; they declare
+ *    the registers as ordinary variables, and the few registers whose reads or writes
+ *    have side effects on the real chip are small classes which call into the model.
+ *
+ *  Model:
+ *    \li Time is a count of simulated microseconds, one per Timer 1 count at 8 MHz
+ *        with a divide-by-8 prescaler. It moves forward only when the program reads
+ *        TCNT1 (each read costs sim_read_cost microseconds, which stands in for the
+ *        time taken by the code between reads) or sleeps, or when sim_advance() is
+ *        called.
+ *    \li Timer 1 overflow and compares A and B, and Timer 3 compare A in CTC mode, set their
+ *        flags and call their interrupt service routines when their interrupts are
+ *        enabled and the I bit in SREG is set. Interrupts which come due while the I
+ *        bit is clear are delivered when it's set again.
+ *    \li The A/D converter finishes a conversion as soon as ADSC is written, giving
+ *        the value set for the selected channel with sim_set_adc().
+ *    \li sleep_cpu() moves time forward to the next enabled interrupt.
+ *    \li External interrupts 4 through 7 happen when sim_external_interrupt() says so.
+ *    \li Other registers are plain memory. The UARTs always say they're ready to
+ *        send, and what's written to them goes nowhere. Their UDRE interrupts happen
+ *        whenever they're enabled, and their RXC interrupts when sim_uart_receive()
+ *        gives them a character. Since the UART registers are plain memory, turning
+ *        on a UART interrupt doesn't call its service routine right away; as with 
+ *        interrupts which came due while the I bit was clear, it's called the next 
+ *        time SREG is read or written.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *    \li  10-16-26  Added Timer 1 compare B for the timer wheel
+ *    \li  10-16-26  Added UART transmit and receive interrupts
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _AVR_SIM_H_                         // To prevent avr_sim.h from being
+#define _AVR_SIM_H_                         // included in a source file more than once
+
+#include <stdint.h>
+
+
+//--------------------------------------------------------------------------------------
+/** This class models the status register. Only the global interrupt enable bit does
+ *  anything; setting it delivers any interrupts which came due while it was clear.
+ */
+
+class sim_sreg_reg
+    {
+    public:
+        operator uint8_t () const;
+        sim_sreg_reg& operator= (uint8_t);
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This class models the Timer 1 count register, whose value is computed from the
+ *  simulated time when it's read.
+ */
+
+class sim_tcnt1_reg
+    {
+    public:
+        operator uint16_t () const;
+        sim_tcnt1_reg& operator= (uint16_t);
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This class models an interrupt flag register. As on the real chip, writing a one
+ *  to a flag clears it; flags are set only by the model.
+ */
+
+class sim_flag_reg
+    {
+    public:
+        volatile uint8_t bits;              ///< The flags which are currently set
+
+        operator uint8_t () const { return (bits); }
+        sim_flag_reg& operator= (uint8_t clear) { bits &= ~clear; return (*this); }
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This class models the A/D converter control and status register. Writing a one to
+ *  ADSC does a whole conversion at once, so ADSC always reads back as zero.
+ */
+
+class sim_adcsra_reg
+    {
+    protected:
+        uint8_t bits;                       // Register contents other than ADSC
+
+    public:
+        operator uint8_t () const { return (bits); }
+        sim_adcsra_reg& operator= (uint8_t);
+        sim_adcsra_reg& operator|= (uint8_t value) { return (*this = bits | value); }
+        sim_adcsra_reg& operator&= (uint8_t value) { return (*this = bits & value); }
+    };
+
+
+//--------------------------------------------------------------------------------------
+// These functions control the peripheral model from host programs
+
+void sim_reset (void);                      // Set all registers and time back to zero
+void sim_advance (uint32_t);                // Let some microseconds go by
+uint64_t sim_time (void);                   // Simulated microseconds since reset
+void sim_set_read_cost (uint16_t);          // Set microseconds used by each TCNT1 read
+void sim_set_adc (uint8_t, uint16_t);       // Set the value an A/D channel will read
+void sim_external_interrupt (uint8_t);      // Trigger one of INT4 through INT7
+void sim_uart_receive (uint8_t, uint8_t);   // Give a UART a received character
+void sim_sleep (void);                      // Sleep until the next enabled interrupt
+void sim_cli (void);                        // Clear the global interrupt enable bit
+void sim_sei (void);                        // Set it and deliver pending interrupts
+
+#endif // _AVR_SIM_H_
@@ -0,0 +1,343 @@
+//======================================================================================
+/** \file bench_scheduler.cc
+ *    This program runs the scheduler, timer and some of the project's logic on a PC,
+ *    using the peripheral model in avr_sim.cc in place of the ATmega128. It measures
+ *    how much host processor time the scheduler and the logic take, which is useful
+ *    for comparing versions of the code; the numbers are not AVR cycle counts. It also
+ *    reports what the tasks saw in simulated time, such as missed periods, which does
+ *    say something about how the code will behave on the real processor.
+ *
+ *  Usage:
+ *    'make host' builds this program and runs it.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *    \li  10-16-26  Times how long it takes to print a time stamp
+ *    \li  10-16-26  Times writing a line to the buffered serial port
+ *    \li  10-16-26  Times formatting the motor controller's state as text
+ *    \li  10-16-26  Compares the state report through a text_stream
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#include <stdio.h>
+#include <time.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "avr_sim.h"                        // The peripheral model
+#include "rs232.h"                          // Serial port, which goes nowhere here
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "stl_debug.h"                      // Definitions for debugging serial port
+#include "stl_task.h"                       // The state transition logic header
+#include "stl_scheduler.h"                  // Runs tasks in order of their deadlines
+#include "controls.h"                       // Motor controller with its control lane
+#include "triangle.h"                       // Triangulation lookup tables
+#include "text_stream.h"                    // Text output without virtual calls
+
+
+/// This is how many tasks the scheduler benchmark runs
+#define BENCH_NUM_TASKS         6
+
+/// This is how long the scheduler benchmark runs, in simulated microseconds
+#define BENCH_SIM_TIME          10000000UL
+
+
+//--------------------------------------------------------------------------------------
+/** This class is a task which does nothing but count its runs, so that the time it
+ *  takes is almost all scheduler overhead.
+ */
+
+class bench_task : public stl_task
+    {
+    public:
+        unsigned long runs;                 ///< Number of times run() has been called
+
+        bench_task (const time_stamp& time_interval) : stl_task (time_interval)
+            {
+            runs = 0;
+            }
+
+        char run (char state)
+            {
+            runs++;
+            return (STL_NO_TRANSITION);
+            }
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This function reads the host's clock.
+ *  @return The host's monotonic time in nanoseconds
+ */
+
+static unsigned long long host_ns (void)
+    {
+    struct timespec now;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return ((unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function runs a set of do-nothing tasks through the scheduler's main loop for
+ *  a while of simulated time and reports the host time used per dispatch.
+ *  @param p_timer A pointer to the task timer
+ */
+
+static void bench_scheduler (task_timer* p_timer)
+    {
+    static const long intervals[BENCH_NUM_TASKS]
+        = { 1000L, 2000L, 5000L, 10000L, 20000L, 50000L };
+    bench_task* tasks[BENCH_NUM_TASKS];
+    stl_scheduler the_scheduler (p_timer);
+    unsigned long dispatches = 0;
+    unsigned long runs = 0;
+    unsigned long long start_ns;
+    unsigned long long elapsed_ns;
+    uint64_t end_time;
+
+    // As in the AVR program, tasks are never deleted; they have no virtual destructor
+    for (unsigned char index = 0; index < BENCH_NUM_TASKS; index++)
+        {
+        tasks[index] = new bench_task (time_stamp (intervals[index]));
+        the_scheduler.add_task (tasks[index]);
+        }
+
+    end_time = sim_time () + BENCH_SIM_TIME;
+    start_ns = host_ns ();
+    while (sim_time () < end_time)
+        {
+        dispatches++;
+        if (!the_scheduler.dispatch ())
+            the_scheduler.idle ();
+        }
+    elapsed_ns = host_ns () - start_ns;
+
+    printf ("Scheduler: %u tasks, %lu s simulated\n", BENCH_NUM_TASKS,
+            BENCH_SIM_TIME / 1000000UL);
+    for (unsigned char index = 0; index < BENCH_NUM_TASKS; index++)
+        {
+        runs += tasks[index]->runs;
+        printf ("  task %u  interval %6ld us  runs %7lu  missed %5u  worst late %6ld us\n",
+                index, intervals[index], tasks[index]->runs,
+                tasks[index]->get_missed_periods (), tasks[index]->get_worst_lateness ());
+        }
+    printf ("  %lu passes through the main loop, %lu runs\n", dispatches, runs);
+    printf ("  %.1f ns host time per pass, %.1f ns per run\n",
+            (double)elapsed_ns / dispatches, (double)elapsed_ns / runs);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function measures the time stamp arithmetic which the scheduler uses to
+ *  compare deadlines, and the conversion of time stamps to text.
+ */
+
+static void bench_time_stamps (void)
+    {
+    const unsigned long count = 10000000UL;
+    time_stamp a_time (0x7FFFF000L);
+    time_stamp step (1000L);
+    unsigned long later = 0;
+    unsigned long long start_ns = host_ns ();
+
+    for (unsigned long index = 0; index < count; index++)
+        {
+        time_stamp next = a_time + step;
+        if (next >= a_time)
+            later++;
+        a_time = next;
+        }
+
+    printf ("Time stamps: %.2f ns per add and compare (%lu of %lu later)\n",
+            (double)(host_ns () - start_ns) / count, later, count);
+
+    // Printing a time means splitting it into seconds and microseconds and finding
+    // the digits of each
+    char str[14];
+    unsigned long length = 0;
+
+    start_ns = host_ns ();
+    for (unsigned long index = 0; index < count / 10; index++)
+        {
+        time_stamp printed ((long)(index * 4241L));
+        printed.to_string (str, 6);
+        length += str[0];
+        }
+    printf ("Time stamps: %.1f ns per to_string() (checksum %lu)\n",
+            (double)(host_ns () - start_ns) / (count / 10), length);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function measures the triangulation code's conversions between angles and
+ *  global coordinates.
+ *  @param p_port A pointer to the serial port which the triangle object is given
+ */
+
+static void bench_triangle (base_text_serial* p_port)
+    {
+    triangle my_triangle (p_port);
+    unsigned long calls = 0;
+    long checksum = 0;
+    unsigned long long start_ns;
+    unsigned long long elapsed_ns;
+
+    my_triangle.set_position (6, 13, 0);
+
+    start_ns = host_ns ();
+    for (int angle = -180; angle < 180; angle++)
+        for (int distance = 1; distance < 20; distance++)
+            {
+            checksum += my_triangle.angle_to_global (true, angle, distance);
+            checksum += my_triangle.angle_to_global (false, angle, distance);
+            calls += 2;
+            }
+    elapsed_ns = host_ns () - start_ns;
+    printf ("Triangle: %.1f ns per angle_to_global() (checksum %ld)\n",
+            (double)elapsed_ns / calls, checksum);
+
+    calls = 0;
+    checksum = 0;
+    start_ns = host_ns ();
+    for (int x = 0; x < 20; x++)
+        for (int y = 0; y < 20; y++)
+            {
+            checksum += my_triangle.global_to_angle (x, y);
+            calls++;
+            }
+    elapsed_ns = host_ns () - start_ns;
+    printf ("Triangle: %.1f ns per global_to_angle() (checksum %ld)\n",
+            (double)elapsed_ns / calls, checksum);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function runs the geared position controller from the Timer 3 control lane
+ *  for a second of simulated time while the encoder interrupts come in, and reports
+ *  the host time per controller step along with any lane overruns.
+ *  @param p_port A pointer to the serial port which the controller is given
+ */
+
+static void bench_control_lane (base_text_serial* p_port)
+    {
+    static const uint8_t encoder_pins[4] = { 0x20, 0x30, 0x10, 0x00 };
+    controls my_controls (p_port);
+    const unsigned long steps = 1000;
+    unsigned long long start_ns;
+
+    my_controls.start_geared_position_control (90, 4, 1);
+    my_controls.start_control_lane ();
+
+    start_ns = host_ns ();
+    for (unsigned long index = 0; index < steps; index++)
+        {
+        // Turn the encoder forward one step each period: B rises, A rises, B falls,
+        // then A falls, each edge causing its external interrupt
+        PINE = (PINE & ~0x30) | encoder_pins[index & 0x03];
+        sim_external_interrupt (index & 0x01 ? INT4 : INT5);
+        sim_advance (CONTROL_LANE_PERIOD);
+        }
+    my_controls.stop_control_lane ();
+
+    my_controls.update_ISR_values ();
+    printf ("Control lane: %.1f ns per period, %u overruns, motor at %d degrees\n",
+            (double)(host_ns () - start_ns) / steps, my_controls.get_lane_overruns (),
+            my_controls.get_motor_position_degrees ());
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function measures how long it takes to write a line of text to the serial
+ *  port, which puts the characters into the transmit buffer, and has the UDRE 
+ *  interrupt take them out again, then gives a character to the receiver. 
+ *  @param p_port A pointer to the serial port
+ */
+
+static void bench_serial (rs232* p_port)
+    {
+    const unsigned long lines = 100000;
+    unsigned long long start_ns = host_ns ();
+
+    for (unsigned long index = 0; index < lines; index++)
+        p_port->puts ("X: 12 Y: 7 distance 143 angle -35\r\n");
+    printf ("Serial: %.1f ns per 36-character line, %u transmit overruns",
+            (double)(host_ns () - start_ns) / lines, p_port->get_tx_overruns ());
+
+    sim_uart_receive (0, 'a');
+    printf (", received '%c'\n", p_port->check_for_char () ? p_port->getchar () : '?');
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This class is a serial port which throws away what's written to it, counting the
+ *  characters, so that formatting can be timed apart from sending.
+ */
+
+class bench_null_port : public base_text_serial
+    {
+    public:
+        unsigned long count;                ///< Number of characters written
+
+        bench_null_port (void) { count = 0; }
+        bool putchar (char) { count++; return (true); }
+        void puts (char const* str) { while (*str++) count++; }
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This function measures how long it takes to write the motor controller's state as
+ *  text, as task code does for debugging, to a port which takes no time itself. The
+ *  report is written once through base_text_serial's virtual methods and once through
+ *  a text_stream, which calls the port's methods directly.
+ *  @param p_port A pointer to the serial port which the controller is given
+ */
+
+static void bench_controls_report (base_text_serial* p_port)
+    {
+    bench_null_port null_port;
+    base_text_serial& any_port = null_port;
+    text_stream<bench_null_port> null_stream (null_port);
+    controls my_controls (p_port);
+    const unsigned long reports = 100000;
+    unsigned long long start_ns = host_ns ();
+    unsigned long long middle_ns;
+
+    for (unsigned long index = 0; index < reports; index++)
+        any_port << my_controls;
+    middle_ns = host_ns ();
+    for (unsigned long index = 0; index < reports; index++)
+        null_stream << my_controls;
+    printf ("Controls: %.1f ns per state report of %lu characters, %.1f ns by "
+            "text_stream\n", (double)(middle_ns - start_ns) / reports,
+            null_port.count / reports / 2, (double)(host_ns () - middle_ns) / reports);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** The main function sets up the peripheral model and the timer, then runs each of
+ *  the benchmarks in turn.
+ */
+
+int main (void)
+    {
+    sim_reset ();
+
+    rs232 the_serial_port (52, 0);
+    task_timer the_timer;
+
+    sei ();
+
+    bench_scheduler (&the_timer);
+    bench_time_stamps ();
+    bench_triangle (&the_serial_port);
+    bench_control_lane (&the_serial_port);
+    bench_serial (&the_serial_port);
+    bench_controls_report (&the_serial_port);
+
+    return (0);
+    }
@@ -0,0 +1,25 @@
+//======================================================================================
+/** \file stdlib.h
+ *    This file adds the number to string conversion functions which avr-libc has and
+ *    the host's C library doesn't to the host's stdlib.h. They're in avr_sim.cc.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _HOST_STDLIB_H_                     // To prevent stdlib.h from being included
+#define _HOST_STDLIB_H_                     // in a source file more than once
+
+#include_next <stdlib.h>
+
+char* itoa (int, char*, int);
+char* utoa (unsigned int, char*, int);
+char* ltoa (long, char*, int);
+char* ultoa (unsigned long, char*, int);
+
+#endif // _HOST_STDLIB_H_
@@ -0,0 +1,53 @@
+# Decodes a binary log dumped by the stl_log_drain task (built with -DSTL_LOG_RING)
+# back into text, using the table of formats which log_table.rb makes from
+# log_formats.h. Usage:
+#
+#   ruby log_decoder.rb dump.txt [log_formats.tbl]
+#
+# The dump is whatever was captured from the serial port; lines which aren't log
+# records are ignored. Times are in microseconds since the first record.
+
+filename = ARGV.shift
+tablename = ARGV.shift || 'log_formats.tbl'
+
+formats = {}
+File.open(tablename){|file| file.readlines}.each{|line|
+  number, name, format = line.chomp.split("\t", 3)
+  formats[number.to_i] = [name, format.gsub('\\"', '"')]
+}
+
+recordRegex = Regexp.new('LG ([0-9A-F]{8}) ([0-9A-F]{2})((?: [0-9A-F]{4})*)', Regexp::IGNORECASE)
+lostRegex = Regexp.new('LL ([0-9A-F]{2})', Regexp::IGNORECASE)
+
+start = nil
+
+File.open(filename){|file| file.readlines}.each{|line|
+  if match = recordRegex.match(line)
+    # The timer's 32 bit count wraps around, so differences are taken modulo 2^32
+    time = match[1].to_i(16)
+    start = time if start.nil?
+    elapsed = (time - start) % 2**32
+
+    id = match[2].to_i(16)
+    args = match[3].split.map{|arg| arg.to_i(16)}
+    name, format = formats[id]
+    if format.nil?
+      text = "unknown message #{id} #{args.join(' ')}"
+    else
+      # Each argument was logged as a 16-bit integer; %d shows it with its sign
+      conversions = format.scan(/%[-+ #0]*\d*([a-zA-Z])/).map{|conv| conv[0]}
+      args = args.each_with_index.map{|arg, index|
+        conversions[index] == 'd' && arg >= 0x8000 ? arg - 0x10000 : arg
+      }
+      begin
+        text = format % args
+      rescue ArgumentError
+        text = "#{name} #{args.join(' ')}"
+      end
+    end
+
+    puts "%10d us  %s" % [elapsed, text]
+  elsif match = lostRegex.match(line)
+    puts "            ---- #{match[1].to_i(16)} records lost ----"
+  end
+}
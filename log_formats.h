@@ -0,0 +1,28 @@
+//======================================================================================
+/** \file  log_formats.h
+ *  This file lists the messages which the program writes into the binary log; see 
+ *  stl_log.h. Each line gives a message's ID and its printf() style format. The 
+ *  program only ever sees the IDs, which stl_log.h makes into an enumeration from this
+ *  list, so the text takes no room in the AVR's memory and no time to send. The
+ *  Makefile runs log_table.rb on this file to make log_formats.tbl, which the host
+ *  program log_decoder.rb uses to turn the log back into text.
+ *
+ *  Each format may have up to STL_LOG_MAX_ARGS conversions, which should be %d, %u,
+ *  %x or %c since each argument is logged as a 16-bit integer. New messages go at the
+ *  end of the list, so the IDs of the old ones don't change. 
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License. The program is intended
+ *    for educational use only, but its use is not restricted thereto. 
+ */
+//======================================================================================
+
+// This file is included more than once on purpose, with different definitions of
+// STL_LOG_FORMAT each time, so it has no include guard
+
+STL_LOG_FORMAT (LOG_TRI_ANGLES, "loc_angle %d cam_init_angle %d local_angle %d")
+STL_LOG_FORMAT (LOG_RAD_COORDS, "X: %d Y: %d")
+STL_LOG_FORMAT (LOG_RAD_SENDING, "Sending X: %d Y: %d")
@@ -0,0 +1,45 @@
+//======================================================================================
+/** \file  log_levels.h
+ *  This file lists the modules which write text messages through the macros in
+ *  stl_log_level.h. Each module's threshold can be set in the Makefile's LOG_LEVELS;
+ *  a module which isn't mentioned there gets STL_LOG_LEVEL_DEFAULT. A new module
+ *  needs a line here before its messages will compile.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License. The program is intended
+ *    for educational use only, but its use is not restricted thereto.
+ */
+//======================================================================================
+
+#ifndef _LOG_LEVELS_H_                      // To prevent log_levels.h from being
+#define _LOG_LEVELS_H_                      // included in a source file more than once
+
+#ifndef STL_LOG_LEVEL_MAIN                  // The main program
+    #define STL_LOG_LEVEL_MAIN          STL_LOG_LEVEL_DEFAULT
+#endif
+#ifndef STL_LOG_LEVEL_MOTOR                 // Motor task and motor driver
+    #define STL_LOG_LEVEL_MOTOR         STL_LOG_LEVEL_DEFAULT
+#endif
+#ifndef STL_LOG_LEVEL_SENSOR                // Sensor task and Sharp sensor driver
+    #define STL_LOG_LEVEL_SENSOR        STL_LOG_LEVEL_DEFAULT
+#endif
+#ifndef STL_LOG_LEVEL_SOLENOID              // Solenoid task and driver
+    #define STL_LOG_LEVEL_SOLENOID      STL_LOG_LEVEL_DEFAULT
+#endif
+#ifndef STL_LOG_LEVEL_LOGIC                 // Logic task
+    #define STL_LOG_LEVEL_LOGIC         STL_LOG_LEVEL_DEFAULT
+#endif
+#ifndef STL_LOG_LEVEL_RADIO                 // Radio task and packet link
+    #define STL_LOG_LEVEL_RADIO         STL_LOG_LEVEL_DEFAULT
+#endif
+#ifndef STL_LOG_LEVEL_TRIANGLE              // Triangulation
+    #define STL_LOG_LEVEL_TRIANGLE      STL_LOG_LEVEL_DEFAULT
+#endif
+#ifndef STL_LOG_LEVEL_ADC                   // A/D converter driver
+    #define STL_LOG_LEVEL_ADC           STL_LOG_LEVEL_DEFAULT
+#endif
+
+#endif // _LOG_LEVELS_H_
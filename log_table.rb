@@ -0,0 +1,18 @@
+# Makes the table of log message formats which log_decoder.rb uses, from the list in
+# log_formats.h. 'make logtable' runs it whenever log_formats.h has changed. Usage:
+#
+#   ruby log_table.rb log_formats.h > log_formats.tbl
+#
+# Each line of the table holds a message's ID number, its name and its format,
+# separated by tabs. The numbers are given in the order of the list, which is how the
+# compiler numbers the stl_log_id enumeration made from the same list.
+
+formatRegex = Regexp.new('^\s*STL_LOG_FORMAT\s*\(\s*(\w+)\s*,\s*"((?:[^"\\\\]|\\\\.)*)"\s*\)')
+
+number = 0
+File.open(ARGV[0]){|file| file.readlines}.each{|line|
+  if match = formatRegex.match(line)
+    puts "#{number}\t#{match[1]}\t#{match[2]}"
+    number += 1
+  end
+}
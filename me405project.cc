@@ -4,6 +4,7 @@
  *
  *  Revisions
  *    \li  04-05-08  36 hours straight in lab is no fun :(
+ *    \li  10-16-26  Typing 'r' prints the controller's state through a text_stream
  *
  *  License:
  *    This file released under the Lesser GNU Public License, version 2. This program
@@ -18,6 +19,7 @@
 
 // User written headers included with " "
 #include "rs232.h"				// Serial port header
+#include "text_stream.h"			// Writes to the serial port without virtual calls
 #include "stl_us_timer.h"			// Microsecond-resolution timer
 #include "nRF24L01_text.h"			// Nordic nRF24L01 radio module header
 #include "adc_driver.h"				// A/D converter header
@@ -25,6 +27,12 @@
 #include "sharp_sensor_driver.h"		// IR-Sensor
 #include "stl_debug.h"				// Handy debugging macros
 #include "stl_task.h"				// Base class for all task classes
+#include "stl_scheduler.h"			// Runs the tasks in order of their deadlines
+#include "stl_trace.h"				// State transition trace ring
+#include "stl_log.h"				// Binary log ring
+#include "stl_telemetry.h"			// Binary telemetry stream
+#include "stl_log_level.h"			// Text messages filtered by module and level
+#include "stl_timer_wheel.h"			// Calls functions at exact times
 #include "task_solenoid.h"			// The task that runs the motor around
 #include "task_logic.h"				// The task that makes some logic
 #include "task_motor.h"				// The task that controls the motor
@@ -41,8 +49,8 @@
 /** \brief Main function of the project
  *
  *  This function first initializes all of the objects required to run our system, and
- *  then enters an infinite loop which schedules the tasks one after the other in
- *  a round robin fashion
+ *  then enters an infinite loop in which the scheduler runs whichever task's deadline
+ *  comes first
  */
 
 int main ()
@@ -55,13 +63,20 @@ int main ()
 	// Create a serial port object. The time will be printed to this port, which
 	// should be hooked up to a dumb terminal program like minicom on a PC
 	rs232 the_serial_port (BAUD_DIV, 1);
+	// Debugging messages are thrown away rather than holding up the tasks when the
+	// transmit buffer is full; get_tx_overruns() tells how many were lost
+	the_serial_port.set_full_policy (RS232_DROP);
+	// Text written by main() itself goes straight to the rs232 methods, inline
+	text_stream<rs232> the_console (the_serial_port);
 
 	// Print a greeting message. This is almost always a good thing because it lets 
 	// the user know that the program is actually running
-	the_serial_port << "\r\n\nME405 Camera Project" << endl;
+	STL_LOG_WRITE (MAIN, INFO, &the_console, F ("\r\n\nME405 Camera Project") << endl);
 
 	// Create a microsecond-resolution timer
 	task_timer the_timer;
+	// Create the timer wheel, which times things too short for tasks to time
+	stl_timer_wheel the_wheel (&the_timer);
 
 	// Create a controls object
 	controls my_controls(&the_serial_port);
@@ -77,50 +92,101 @@ int main ()
 	// Set global position of camera in the room coord system (in tiles) and the angle the camera is facing
 	my_triangle.set_position(6,13,0);
 
-	//Create a bit-banged SPI port interface object. Masks are SCK, MISO, MOSI
-	spi_bb_port my_SPI (PINB, PORTB, DDRB, 0x02, 0x04, 0x08);
+	#ifdef NRF24_HW_SPI
+		// Use the AVR's SPI hardware, whose pins are fixed: SCK, MOSI, MISO on PB1-PB3
+		nRF24_spi_port my_SPI;
+	#else
+		//Create a bit-banged SPI port interface object. Masks are SCK, MISO, MOSI
+		nRF24_spi_port my_SPI (PINB, PORTB, DDRB, 0x02, 0x04, 0x08);
+	#endif
 
 	//Set up a radio module object. Parameters are port, DDR, and bitmask for each 
 	//line SS, CE, and IRQ; last parameter is debugging serial port's address
 	nRF24L01_text my_radio (PORTE, DDRE, 0x40, PORTE, DDRE, 0x80, &my_SPI, 0x01, &the_serial_port);
 
 	//Give a long, overly complex message to make sure multi-packet strings work
-	my_radio << "Hello, this is the radio module text mode test program. It mostly works." << endl;
+	my_radio << F ("Hello, this is the radio module text mode test program. It mostly works.") << endl;
 
 	//======================================================//
 	//	Create Task - Objects				//
 	//======================================================//
 
-	// Create a time stamp which holds the interval between runs of the solenoid task
+	//solenoid task; it sets its own interval, the camera's wake-up time
+	task_solenoid my_solenoid_task(&mysol, &the_wheel, &the_serial_port);
+	// Create a time stamp which holds the interval between runs of the other tasks
 	// The time stamp is initialized with a number of seconds, then microseconds
-	time_stamp interval_time(0, 10000);
-	//solenoid task
-	task_solenoid my_solenoid_task(&interval_time, &mysol, &the_serial_port);
-	interval_time.set_time(0,1000);
+	time_stamp interval_time(0, 1000);
 	//motor task
 	task_motor my_motor_task(&interval_time, &the_serial_port, &my_controls);
-	//sensor task
+	//sensor task; it runs when a reading is requested, so its interval is only a timeout
+	interval_time.set_time(0,100000);
 	task_sensor my_sensor_task(&interval_time, &my_sensor, &my_motor_task, &the_serial_port);
+	interval_time.set_time(0,1000);
 	//Radio Task
-	task_rad my_task_radio(5, 1, &interval_time, &my_radio, &the_serial_port, &my_motor_task, &my_triangle, &my_sensor);
+	task_rad my_task_radio(5, 1, &interval_time, &the_timer, &my_radio, &the_serial_port, &my_motor_task, &my_triangle, &my_sensor);
 
 	// Create THE logic task which rules the world
 	task_logic my_logic_task(&interval_time, &my_solenoid_task, &my_sensor_task, &my_motor_task, &my_task_radio, &my_triangle,	 &the_serial_port);
 
+	// Create the scheduler which runs the tasks, and give it all the tasks to run
+	stl_scheduler the_scheduler (&the_timer);
+	the_scheduler.add_task (&my_logic_task);
+	the_scheduler.add_task (&my_motor_task);
+	the_scheduler.add_task (&my_solenoid_task);
+	the_scheduler.add_task (&my_sensor_task);
+	the_scheduler.add_task (&my_task_radio);
+
+	#ifdef STL_TRACE_RING
+		// Print the state transition trace every 20 ms, emptying the ring each time
+		interval_time.set_time(0,20000);
+		stl_trace_drain my_trace_drain (interval_time, &the_serial_port);
+		the_scheduler.add_task (&my_trace_drain);
+	#endif
+
+	#ifdef STL_LOG_RING
+		// Print the binary log every 20 ms, a couple of records at a time
+		interval_time.set_time(0,20000);
+		stl_log_drain my_log_drain (interval_time, &the_timer, &the_serial_port);
+		the_scheduler.add_task (&my_log_drain);
+	#endif
+
+	#ifdef STL_TELEMETRY
+		// Send the motor controller's state every 5 ms. A frame with all the channels
+		// is 22 bytes, so at 9600 baud only every 50th run of the 1 kHz control lane
+		// is sent; full rate step responses need a faster baud rate and decimation 1
+		interval_time.set_time(0,5000);
+		stl_telemetry my_telemetry (interval_time, &the_timer, &the_serial_port);
+		for (unsigned char channel = 0; channel < CTL_TELEM_SIGNALS; channel++)
+			my_telemetry.set_decimation (channel, 50);
+		my_controls.set_telemetry (&my_telemetry);
+		the_scheduler.add_task (&my_telemetry);
+	#endif
+
 	// Turn on interrupt processing so the timer can work
 	sei ();
 
-	// Run the main scheduling loop, in which the tasks are continuously scheduled.
-	// This program currently uses very simple "round robin" scheduling in which the
-	// tasks are simply called in order. More sophisticated scheduling strategies
-	// will be used in other more sophisticated programs
+	// Run the main scheduling loop. Each pass reads the time once and runs only the
+	// task whose deadline is earliest, and only if that deadline has come. When no
+	// task is due, the processor sleeps until the next deadline or an interrupt
 	while (true)
 	{
-		my_logic_task.schedule(the_timer.get_time_now());
-		my_motor_task.schedule (the_timer.get_time_now ());
-		my_solenoid_task.schedule (the_timer.get_time_now ());
-		my_sensor_task.schedule (the_timer.get_time_now ());
-		my_task_radio.schedule (the_timer.get_time_now ());
+		if (!the_scheduler.dispatch ())
+			the_scheduler.idle ();
+
+		// Typing 'r' prints the motor controller's state. With profiling on, 'p'
+		// prints the tasks' execution profiles and 'c' clears them
+		if (the_serial_port.check_for_char ())
+		{
+			char key = the_serial_port.getchar ();
+			if (key == 'r')
+				the_console << my_controls;
+			#ifdef STL_PROFILING
+				else if (key == 'p')
+					the_scheduler.print_profiles (&the_serial_port);
+				else if (key == 'c')
+					the_scheduler.clear_profiles ();
+			#endif
+		}
 	}
 	return (0);
     }
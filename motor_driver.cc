@@ -7,6 +7,7 @@
  *    \li  04-17-08  Created files
  *    \li  04-21-08  Began implementing methods
  *    \li  04-24-08  Finished class
+ *    \li  10-16-26  The banner goes through STL_LOG_WRITE so it can be compiled out
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -19,6 +20,7 @@
 
 #include "rs232.h"                          // Include header for serial port class
 #include "motor_driver.h"                        // Include header for the A/D class
+#include "stl_log_level.h"                  // Text messages filtered by module and level
 
 
 #define BV(bit) (1<<(bit)) //!< Byte Value => sets bit'th bit to 1
@@ -37,7 +39,7 @@ motor_driver::motor_driver (base_text_serial* p_serial_port)
 {
 	// Store the serial port locally and print a message
 	ptr_to_serial = p_serial_port;
-	*ptr_to_serial << "Setting up motor controller" << endl;
+	STL_LOG_WRITE (MOTOR, INFO, ptr_to_serial, F ("Setting up motor controller") << endl);
 	power_level = 0;
 	direction_of_motor = true;
 	brake_on = false;
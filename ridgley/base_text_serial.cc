@@ -21,6 +21,12 @@
  *      \li 01-12-08  JRR  Added code for the ATmega128 using USART number 1 only
  *      \li 02-13-08  JRR  Split into base class and device specific classes; changed
  *                         from write() to overloaded << operator in the "cout" style
+ *      \li 10-16-26       Numbers are formatted into a buffer without dividing and
+ *                         sent with one call to puts(); negative decimal numbers get
+ *                         their minus signs back
+ *      \li 10-16-26       Strings can be written from program memory
+ *      \li 10-16-26       Flash strings are copied by put_flash_string(), which
+ *                         text_stream shares
  */
 //*************************************************************************************
 
@@ -92,16 +98,225 @@ void base_text_serial::transmit_now (void)
     }
 
 
+//-------------------------------------------------------------------------------------
+/** This function divides a number by ten without dividing. The quotient is found by
+ *  multiplying by an approximation of 1/10 made of shifts and adds, which can come out
+ *  one too small; the remainder shows when it has, and both are corrected. On the AVR
+ *  this is several times quicker than the library's 32-bit division. 
+ *  @param number The number to be divided
+ *  @param remainder A reference to a variable in which the remainder is put
+ *  @return The number divided by ten
+ */
+
+static inline uint32_t divide_by_ten (uint32_t number, unsigned char& remainder)
+    {
+    uint32_t quotient;                      // The number over ten, or one less
+    unsigned char left;                     // What's left over, which may be 10 to 19
+
+    quotient = (number >> 1) + (number >> 2);
+    quotient += quotient >> 4;
+    quotient += quotient >> 8;
+    quotient += quotient >> 16;
+    quotient >>= 3;
+    left = (unsigned char)(number - ((quotient << 3) + (quotient << 1)));
+    if (left > 9)
+        {
+        quotient++;
+        left -= 10;
+        }
+    remainder = left;
+
+    return (quotient);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This function writes a number as text in the given base, into a buffer from the 
+ *  right end. Binary, octal and hexadecimal digits are taken off with shifts and 
+ *  masks. Decimal digits are taken off with divide_by_ten() until the number fits in
+ *  16 bits, then by multiplying by 0xCCCD, which is 2^19 / 10 rounded up and gives 
+ *  exact quotients for 16-bit numbers. In decimal, a signed number is written with a
+ *  minus sign if it's negative; in the other bases the bits are written as they are,
+ *  as they would be by ltoa(). Binary numbers are written with all their bits, 
+ *  including leading zeros. 
+ *  @param p_end A pointer to the last place in the buffer, where the '\0' goes; there
+ *      must be room for TEXT_NUMBER_SIZE characters up to and including it
+ *  @param num The number, sign extended to 32 bits if it's signed
+ *  @param is_signed True if the number is of a signed type
+ *  @param size The size of the number's type in bytes
+ *  @param base The base in which to write the number: 2, 8, 10 or 16
+ *  @return A pointer to the first character of the number in the buffer
+ */
+
+char* format_number (char* p_end, uint32_t num, bool is_signed, unsigned char size,
+                     unsigned char base)
+    {
+    char* p_digit = p_end;                  // Where the next digit goes
+    unsigned char bits = (size < 4 ? size : 4) * 8;     // Number of bits to write
+    bool negative = false;                  // True if a minus sign is needed
+
+    *p_digit = '\0';
+    if (base == 10 && is_signed && (int32_t)num < 0)
+        {
+        negative = true;
+        num = -num;
+        }
+    else if (bits < 32)
+        num &= ((uint32_t)1 << bits) - 1;
+
+    switch (base)
+        {
+        case (2):
+            for ( ; bits > 0; bits--)
+                {
+                *--p_digit = '0' + (char)(num & 0x01);
+                num >>= 1;
+                }
+            break;
+        case (8):
+            do
+                {
+                *--p_digit = '0' + (char)(num & 0x07);
+                num >>= 3;
+                }
+            while (num != 0);
+            break;
+        case (16):
+            do
+                {
+                char digit = (char)(num & 0x0F);
+                *--p_digit = (digit < 10) ? ('0' + digit) : ('a' - 10 + digit);
+                num >>= 4;
+                }
+            while (num != 0);
+            break;
+        default:
+            {
+            unsigned char remainder;        // One decimal digit's value
+            uint16_t small;                 // The number, once it fits in 16 bits
+
+            while (num > 0xFFFF)
+                {
+                num = divide_by_ten (num, remainder);
+                *--p_digit = '0' + remainder;
+                }
+            small = (uint16_t)num;
+            do
+                {
+                uint16_t quotient = (uint16_t)(((uint32_t)small * 0xCCCDUL) >> 19);
+                *--p_digit = '0' + (char)(small - quotient * 10);
+                small = quotient;
+                }
+            while (small != 0);
+            }
+            break;
+        }
+    if (negative)
+        *--p_digit = '-';
+
+    return (p_digit);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method writes a number to the serial device in the current base. The digits
+ *  are put into a buffer on the stack by format_number(), and the whole buffer is 
+ *  sent with one call to puts(), so a buffered port or radio gets the number at once
+ *  rather than a character at a time. 
+ *  @param num The number, sign extended to 32 bits if it's signed
+ *  @param is_signed True if the number is of a signed type
+ *  @param size The size of the number's type in bytes
+ */
+
+void base_text_serial::put_number (uint32_t num, bool is_signed, unsigned char size)
+    {
+    char buffer[TEXT_NUMBER_SIZE];          // Room for 32 bits in binary and a '\0'
+
+    puts (format_number (buffer + TEXT_NUMBER_SIZE - 1, num, is_signed, size, base));
+    }
+
+
 //-------------------------------------------------------------------------------------
 /** This method writes the string whose first character is pointed to by the given
- *  character pointer to the serial device. It acts in about the same way as puts(). 
- *  As with puts(), the string must have a null character (ASCII zero) at the end. 
+ *  character pointer to the serial device. It acts in about the same way as puts(),
+ *  and it is puts(), so the device can send the string all at once. As with puts(),
+ *  the string must have a null character (ASCII zero) at the end. 
  *  @param string Pointer to the string to be written
  */
 
 base_text_serial& base_text_serial::operator<< (const char* string)
     {
-    while (*string) putchar (*string++);
+    puts (string);
+
+    return (*this);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This function writes a string which is kept in program memory, as made by the F()
+ *  macro. The string is copied into a buffer on the stack a piece at a time, and each
+ *  piece is given to the writer function, so a device which sends strings in packets
+ *  sends one packet for each piece rather than one for each character. Both
+ *  base_text_serial and text_stream write their flash strings through here.
+ *  @param string Pointer to the string in program memory
+ *  @param writer The function which writes each piece to the device
+ *  @param p_device Pointer to the device, which is given to the writer function
+ */
+
+void put_flash_string (const flash_string* string, flash_piece_writer writer,
+                       void* p_device)
+    {
+    const char* p_next = reinterpret_cast<const char*> (string);
+    char buffer[FLASH_STRING_CHUNK + 1];    // One piece of the string and a '\0'
+    unsigned char length;                   // Number of characters in the buffer
+
+    do
+        {
+        for (length = 0; length < FLASH_STRING_CHUNK; length++)
+            if ((buffer[length] = pgm_read_byte (p_next++)) == '\0')
+                break;
+        buffer[length] = '\0';
+        if (length > 0)
+            writer (p_device, buffer);
+        }
+    while (length == FLASH_STRING_CHUNK);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This function writes a piece of a flash string through a base_text_serial's puts(),
+ *  whichever kind of device it is.
+ *  @param p_device Pointer to the serial device
+ *  @param piece The piece of the string, copied into RAM
+ */
+
+static void write_flash_piece (void* p_device, const char* piece)
+    {
+    static_cast<base_text_serial*> (p_device)->puts (piece);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method writes a string which is kept in program memory, as made by the F()
+ *  macro, using put_flash_string(). 
+ *  @param string Pointer to the string in program memory
+ */
+
+void base_text_serial::puts (const flash_string* string)
+    {
+    put_flash_string (string, write_flash_piece, this);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method writes a string which is kept in program memory, as made by the F()
+ *  macro, to the serial device. 
+ *  @param string Pointer to the string in program memory
+ */
+
+base_text_serial& base_text_serial::operator<< (const flash_string* string)
+    {
+    puts (string);
 
     return (*this);
     }
@@ -134,21 +349,7 @@ base_text_serial& base_text_serial::operator<< (bool value)
 
 base_text_serial& base_text_serial::operator<< (unsigned char num)
     {
-    if (base == 2)
-        {
-        for (unsigned char bmask = 0x80; bmask != 0; bmask >>= 1)
-            {
-            if (num & bmask) putchar ('1');
-            else             putchar ('0');
-            }
-        }
-    else
-        {
-        char out_str[9];
-
-        utoa ((unsigned int)num, out_str, base);
-        puts (out_str);
-        }
+    put_number (num, false, sizeof (num));
 
     return (*this);
     }
@@ -164,21 +365,7 @@ base_text_serial& base_text_serial::operator<< (unsigned char num)
 
 base_text_serial& base_text_serial::operator<< (char num)
     {
-    if (base == 2)
-        {
-        for (unsigned char bmask = 0x80; bmask != 0; bmask >>= 1)
-            {
-            if (num & bmask) putchar ('1');
-            else             putchar ('0');
-            }
-        }
-    else
-        {
-        char out_str[10];
-
-        utoa ((unsigned int)num, out_str, base);
-        puts (out_str);
-        }
+    put_number ((int32_t)(signed char)num, true, sizeof (num));
 
     return (*this);
     }
@@ -192,21 +379,7 @@ base_text_serial& base_text_serial::operator<< (char num)
 
 base_text_serial& base_text_serial::operator<< (unsigned int num)
     {
-    if (base == 2)
-        {
-        for (unsigned int bmask = 0x8000; bmask != 0; bmask >>= 1)
-            {
-            if (num & bmask) putchar ('1');
-            else             putchar ('0');
-            }
-        }
-    else
-        {
-        char out_str[17];
-
-        utoa (num, out_str, base);
-        puts (out_str);
-        }
+    put_number (num, false, sizeof (num));
 
     return (*this);
     }
@@ -220,21 +393,7 @@ base_text_serial& base_text_serial::operator<< (unsigned int num)
 
 base_text_serial& base_text_serial::operator<< (int num)
     {
-    if (base == 2)
-        {
-        for (unsigned int bmask = 0x8000; bmask != 0; bmask >>= 1)
-            {
-            if (num & bmask) putchar ('1');
-            else             putchar ('0');
-            }
-        }
-    else
-        {
-        char out_str[17];
-
-        utoa (num, out_str, base);
-        puts (out_str);
-        }
+    put_number ((int32_t)num, true, sizeof (num));
 
     return (*this);
     }
@@ -248,21 +407,7 @@ base_text_serial& base_text_serial::operator<< (int num)
 
 base_text_serial& base_text_serial::operator<< (unsigned long num)
     {
-    if (base == 2)
-        {
-        union {
-            unsigned long whole;
-            unsigned char bits[4];
-            } parts;
-        parts.whole = num;
-        *this << parts.bits[3] << parts.bits[2] << parts.bits[1] << parts.bits[0];
-        }
-    else
-        {
-        char out_str[33];
-        ultoa ((long)num, out_str, base);
-        puts (out_str);
-        }
+    put_number ((uint32_t)num, false, sizeof (num));
 
     return (*this);
     }
@@ -276,21 +421,7 @@ base_text_serial& base_text_serial::operator<< (unsigned long num)
 
 base_text_serial& base_text_serial::operator<< (long num)
     {
-    if (base == 2)
-        {
-        union {
-            unsigned long whole;
-            unsigned char bits[4];
-            } parts;
-        parts.whole = num;
-        *this << parts.bits[3] << parts.bits[2] << parts.bits[1] << parts.bits[0];
-        }
-    else
-        {
-        char out_str[34];
-        ltoa ((long)num, out_str, base);
-        puts (out_str);
-        }
+    put_number ((int32_t)num, true, sizeof (num));
 
     return (*this);
     }
@@ -321,7 +452,7 @@ base_text_serial& base_text_serial::operator<< (ser_manipulator new_base)
             base = 16;
             break;
         case (endl):
-            puts ("\r\n");
+            puts (F ("\r\n"));
             break;
         case (send_now):
             transmit_now ();
@@ -17,6 +17,12 @@
  *      \li 01-12-08  JRR  Added code for the ATmega128 using USART number 1 only
  *      \li 02-13-08  JRR  Split into base class and device specific classes; changed
  *                         from write() to overloaded << operator in the "cout" style
+ *      \li 10-16-26       Numbers are formatted into a buffer without dividing and
+ *                         sent with one call to puts()
+ *      \li 10-16-26       Added flash_string and F(), for string constants which stay
+ *                         in program memory instead of being copied into SRAM
+ *      \li 10-16-26       Flash strings are copied by put_flash_string(), which
+ *                         text_stream shares
  */
 //*************************************************************************************
 
@@ -24,6 +30,9 @@
 #ifndef _BASE_TEXT_SERIAL_H_
 #define _BASE_TEXT_SERIAL_H_
 
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
 
 //-------------------------------------------------------------------------------------
 /** This enumeration is used to change the display base for the output stream from the
@@ -42,6 +51,44 @@ typedef enum {
     } ser_manipulator;
 
 
+//-------------------------------------------------------------------------------------
+/** This class is never defined. A pointer to it points to a string constant which is
+ *  kept in program memory, where it must be read with pgm_read_byte(); because it's a
+ *  different type from a char pointer, the compiler picks the versions of puts() and
+ *  operator<<() which read it that way. Such pointers are made with the F() macro. 
+ */
+
+class flash_string;
+
+/** This macro makes a string constant which stays in program memory. An ordinary 
+ *  string constant is copied into SRAM when the program starts and takes up room 
+ *  there for as long as the program runs; one written with F() doesn't. It can only be
+ *  used inside a function:
+ *  \code
+ *  *p_serial << F ("Position: ") << position << endl;
+ *  \endcode
+ *  @param text The string constant
+ */
+#define F(text) (reinterpret_cast<const flash_string*> (PSTR (text)))
+
+/// This is the size of the pieces in which strings in program memory are sent
+#define FLASH_STRING_CHUNK      32
+
+/// This is the size of a buffer which can hold any number written as text, with '\0'
+#define TEXT_NUMBER_SIZE        34
+
+// This function writes a number as text into a buffer, from the right end
+char* format_number (char*, uint32_t, bool, unsigned char, unsigned char);
+
+/** This is the type of a function which writes one piece of a string from program
+ *  memory, copied into RAM, to a device; the first parameter points to the device.
+ */
+typedef void (*flash_piece_writer) (void*, const char*);
+
+// This function writes a string from program memory in pieces with the given function
+void put_flash_string (const flash_string*, flash_piece_writer, void*);
+
+
 //-------------------------------------------------------------------------------------
 /** This is a base class for lots of serial devices which send text over some type of
  *  communication interface. Descendents of this class will be able to send text over
@@ -68,6 +115,9 @@ class base_text_serial
         /// This is the currently used base for converting numbers to text
         unsigned char base;
 
+        // Format a number of the given size in the current base and send it
+        void put_number (uint32_t, bool, unsigned char);
+
     // Public methods can be called from anywhere in the program where there is a 
     // pointer or reference to an object of this class
     public:
@@ -78,11 +128,13 @@ class base_text_serial
         virtual bool check_for_char (void); // Check if a character is in the buffer
         virtual char getchar (void);        // Get a character; wait if none is ready
         virtual void transmit_now (void);   // Immediately transmit any buffered data
+        void puts (const flash_string*);    // Write a string from program memory
 
         // The overloaded left-shift operators convert numbers to strings and send the 
         // strings out the serial device; manipulators change the formatting
         base_text_serial& operator<< (bool);
         base_text_serial& operator<< (const char*);
+        base_text_serial& operator<< (const flash_string*);
         base_text_serial& operator<< (unsigned char);
         base_text_serial& operator<< (char num);
         base_text_serial& operator<< (unsigned int);
@@ -0,0 +1,48 @@
+//======================================================================================
+/** \file crc16.h
+ *    This file contains functions which compute the 16-bit cyclic redundancy check
+ *    used by the CCITT (polynomial 0x1021, starting value 0xFFFF). A CRC catches every
+ *    error of one or two bits and every burst of 16 or fewer bits in a packet, where an
+ *    8-bit sum misses any two errors which cancel each other and any reordering.
+ *
+ *  Usage:
+ *    \code
+ *    uint16_t check = crc16 (buffer, length);
+ *    \endcode
+ *    A CRC can also be built up a byte at a time, starting from CRC16_START:
+ *    \code
+ *    uint16_t check = CRC16_START;
+ *    while (more_data ())
+ *        check = crc16_update (check, next_byte ());
+ *    \endcode
+ *
+ *  How it works:
+ *    Each byte is folded in with one lookup in a table of 256 words which is kept in
+ *    program memory, instead of eight rounds of shifting and exclusive-or'ing.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _CRC16_H_                           // To prevent crc16.h from being
+#define _CRC16_H_                           // included in a source file more than once
+
+#include <stdint.h>
+
+
+/// This is the value with which every CRC starts
+#define CRC16_START             0xFFFF
+
+
+// This function adds one byte to a CRC which is being computed
+uint16_t crc16_update (uint16_t, uint8_t);
+
+// This function computes the CRC of a block of bytes
+uint16_t crc16 (const void*, uint8_t);
+
+#endif // _CRC16_H_
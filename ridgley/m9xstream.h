@@ -100,6 +100,7 @@ class m9XStream : public base_text_serial
         bool ready_to_send (void);          // Check if the port is ready to transmit
         bool putchar (char);                // Write one character to serial port
         void puts (char const*);            // Write a string constant to serial port
+        using base_text_serial::puts;       // and from program memory, by the base's
         bool check_for_char (void);         // Check if a character is in the buffer
         char getchar (void);                // Get a character; wait if none is ready
     };
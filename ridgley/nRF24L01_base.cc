@@ -31,14 +31,14 @@
  *  @param IRQ_port Port for the Interrupt ReQuest (input) line
  *  @param IRQ_ddr Data direction register for the Interrupt ReQuest line
  *  @param IRQ_mask Bitmask for the Interrupt ReQuest line 
- *  @param p_spi_port A pointer to a bit-banged SPI port connecting to the radio
+ *  @param p_spi_port A pointer to the SPI port connecting to the radio
  *  @param slave_mask A bitmask for the slave select (called CSN by radio) bit
  *  @param debug_port A serial port (usually RS232) for debugging text (default NULL)
  */
 
 nRF24L01_base::nRF24L01_base (volatile unsigned char& CE_port, volatile unsigned char& 
     CE_ddr, unsigned char CE_mask, volatile unsigned char& IRQ_port, volatile unsigned 
-    char& IRQ_ddr, unsigned char IRQ_mask, spi_bb_port* p_spi_port, unsigned char 
+    char& IRQ_ddr, unsigned char IRQ_mask, nRF24_spi_port* p_spi_port, unsigned char 
     slave_mask, base_text_serial* debug_port)
     {
     port_CE = &CE_port;                     // Save CE port
@@ -324,80 +324,80 @@ void nRF24L01_base::dump_regs (base_text_serial* p_serial, ser_manipulator base)
     {
     unsigned char reg_data[6];
 
-    *p_serial << "Registers in nRF24L01:" << base << endl;
+    *p_serial << F ("Registers in nRF24L01:") << base << endl;
 
     reg_data[0] = nRF24_REG_CONF;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "Config:   " << reg_data[1] << endl;
+    *p_serial << F ("Config:   ") << reg_data[1] << endl;
 
     reg_data[0] = nRF24_REG_EN_AA;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "Auto Ack: " << reg_data[1] << endl;
+    *p_serial << F ("Auto Ack: ") << reg_data[1] << endl;
 
     reg_data[0] = nRF24_REG_EN_RXADDR;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "Pipes En: " << reg_data[1] << endl;
+    *p_serial << F ("Pipes En: ") << reg_data[1] << endl;
 
     reg_data[0] = nRF24_REG_SETUP_AW;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "Addr Wid: " << reg_data[1] << endl;
+    *p_serial << F ("Addr Wid: ") << reg_data[1] << endl;
 
     reg_data[0] = nRF24_REG_SETUP_RETR;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "Retry:    " << reg_data[1] << endl;
+    *p_serial << F ("Retry:    ") << reg_data[1] << endl;
 
     reg_data[0] = nRF24_REG_RF_CH;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "RF Chan:  " << reg_data[1] << endl;
+    *p_serial << F ("RF Chan:  ") << reg_data[1] << endl;
 
     reg_data[0] = nRF24_REG_RF_SETUP;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "RF Setup: " << reg_data[1] << endl;
+    *p_serial << F ("RF Setup: ") << reg_data[1] << endl;
 
     reg_data[0] = nRF24_REG_STATUS;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "Status:   " << reg_data[1] << endl;
+    *p_serial << F ("Status:   ") << reg_data[1] << endl;
 
     reg_data[0] = nRF24_REG_OBS_TX;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "TX Errs:  " << reg_data[1] << endl;
+    *p_serial << F ("TX Errs:  ") << reg_data[1] << endl;
 
     reg_data[0] = nRF24_REG_CD;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "Carrier:  " << reg_data[1] << endl;
+    *p_serial << F ("Carrier:  ") << reg_data[1] << endl;
 
     reg_data[0] = nRF24_REG_RX_ADDR_P0;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 6, slave_msk);
-    *p_serial << "P0 Addr:  " << hex << reg_data[1] << "." << reg_data[2] << "." 
-        << reg_data[3] << "." << reg_data[4] << "." << reg_data[5] << endl << base;
+    *p_serial << F ("P0 Addr:  ") << hex << reg_data[1] << F (".") << reg_data[2] << F (".") 
+        << reg_data[3] << F (".") << reg_data[4] << F (".") << reg_data[5] << endl << base;
 
     reg_data[0] = nRF24_REG_TX_ADDR;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 6, slave_msk);
-    *p_serial << "TX Addr:  " << hex << reg_data[1] << "." << reg_data[2] << "." 
-        << reg_data[3] << "." << reg_data[4] << "." << reg_data[5] << endl << base;
+    *p_serial << F ("TX Addr:  ") << hex << reg_data[1] << F (".") << reg_data[2] << F (".") 
+        << reg_data[3] << F (".") << reg_data[4] << F (".") << reg_data[5] << endl << base;
 
     reg_data[0] = nRF24_REG_PW_P0;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "P0 Width: " << reg_data[1] << " (" << dec << reg_data[1] << ")" 
+    *p_serial << F ("P0 Width: ") << reg_data[1] << F (" (") << dec << reg_data[1] << F (")") 
         << endl << base;
 
     reg_data[0] = nRF24_REG_FIFO_STATUS;
     reg_data[1] = 0x00;
     p_spi->transfer (reg_data, 2, slave_msk);
-    *p_serial << "FIFO:     " << reg_data[1] << endl;
+    *p_serial << F ("FIFO:     ") << reg_data[1] << endl;
 
     *p_serial << endl;
     }
@@ -19,9 +19,18 @@
 #define _NRF24L01_BASE_H_
 
 #include "avr_queue.h"                      // Template header for circular buffer
-#include "spi_bb.h"                         // Header for bit-banged SPI port
 #include "base_text_serial.h"               // Header for base serial devices
 
+// The radio talks through the SPI hardware if RADIO_SPI in the Makefile asks for it,
+// or through a bit-banged port otherwise; both have the same methods
+#ifdef NRF24_HW_SPI
+    #include "spi_hw.h"                     // Header for hardware SPI port
+    typedef spi_hw_port nRF24_spi_port;
+#else
+    #include "spi_bb.h"                     // Header for bit-banged SPI port
+    typedef spi_bb_port nRF24_spi_port;
+#endif
+
 
 #define nRF24_MAX_PKT_SZ    32              // Maximum packet size for the radio
 #define nRF24_SPI_TIMEOUT   1000            // Retries until timeout for SPI port
@@ -164,8 +173,8 @@ class nRF24L01_base
         /// using interrupts
         unsigned char mask_IRQ;
 
-        /// This is a pointer to a bit-banged SPI port object
-        spi_bb_port* p_spi;
+        /// This is a pointer to the SPI port object, bit-banged or hardware
+        nRF24_spi_port* p_spi;
 
         /// This is a bitmask for the Slave Select (SS on CPU, CSN on the radio) bit
         unsigned char slave_msk;
@@ -180,7 +189,7 @@ class nRF24L01_base
         // The constructor sets up the radio interface
         nRF24L01_base (volatile unsigned char&, volatile unsigned char&, unsigned char,
             volatile unsigned char&, volatile unsigned char&, unsigned char, 
-            spi_bb_port*, unsigned char slave_mask, base_text_serial* = NULL);
+            nRF24_spi_port*, unsigned char slave_mask, base_text_serial* = NULL);
 
         bool ready_to_send (void);          // Check if the port is ready to transmit
         void reset (void);                  // Reset radio module to starting state
@@ -13,6 +13,9 @@
  *    \li 11-15-07 SCH Overhauled to properly control radios and increase speed
  *    \li 01-26-07 SCH Fixed more major flaws
  *    \li 02-15-08 JRR Text based version, written for use on ME405 boards
+ *    \li 10-16-26     Received characters go through a lock-free ring buffer, so
+ *                     the receive interrupt can't spoil getchar()'s count of them
+ *    \li 10-16-26     Received packets are read straight into a pool of buffers
  */
 //*************************************************************************************
 
@@ -33,15 +36,16 @@
 /** This is a file-scope pointer to the SPI port object. It's needed by the interrupt
  *  service routine, as the ISR needs to communicate with the radio chip. Users of the
  *  radio class generally should have no need to use this pointer. */
-spi_bb_port* g_p_spi;
+nRF24_spi_port* g_p_spi;
 
 /** This is a file-scope copy of the bitmask used to access the SPI slave select bit
  *  connected to the CSN line of the radio. The ISR uses it to talk to the radio. */
 unsigned char g_slave_mask;
 
-/** This circular buffer holds characters received from the radio. The characters can
- *  be read by calls to getchar(). */
-queue<unsigned char, unsigned char, 64> g_RX_queue;
+/** This pool holds packets received from the radio. The interrupt service routine reads
+ *  each packet into an empty buffer, and tasks take the packets with get_packet() or 
+ *  a character at a time with getchar(). */
+packet_pool<nRF24_rx_frame, nRF24_RX_POOL_SIZE> g_RX_pool;
 
 
 //-------------------------------------------------------------------------------------
@@ -54,14 +58,14 @@ queue<unsigned char, unsigned char, 64> g_RX_queue;
  *  @param IRQ_port Port for the Interrupt ReQuest (input) line
  *  @param IRQ_ddr Data direction register for the Interrupt ReQuest line
  *  @param IRQ_mask Bitmask for the Interrupt ReQuest line 
- *  @param p_spi_port A pointer to a bit-banged SPI port connecting to the radio
+ *  @param p_spi_port A pointer to the SPI port connecting to the radio
  *  @param slave_mask A bitmask for the slave select (called CSN by radio) bit
  *  @param debug_port A serial port (usually RS232) for debugging text (default NULL)
  */
 
 nRF24L01_text::nRF24L01_text (volatile unsigned char& CE_port, volatile unsigned char& 
     CE_ddr, unsigned char CE_mask, volatile unsigned char& IRQ_port, volatile unsigned 
-    char& IRQ_ddr, unsigned char IRQ_mask, spi_bb_port* p_spi_port, unsigned char 
+    char& IRQ_ddr, unsigned char IRQ_mask, nRF24_spi_port* p_spi_port, unsigned char 
     slave_mask, base_text_serial* debug_port)
     : nRF24L01_base (CE_port, CE_ddr, CE_mask, IRQ_port, IRQ_ddr, IRQ_mask, 
         p_spi_port, slave_mask, debug_port),
@@ -78,6 +82,10 @@ nRF24L01_text::nRF24L01_text (volatile unsigned char& CE_port, volatile unsigned
     // Save file-scope variables used to access the SPI port object
     g_p_spi = p_spi_port;
     g_slave_mask = slave_mask;
+
+    // No received packet is being read a character at a time yet
+    rx_handle = PKT_POOL_NONE;
+    rx_index = 0;
     }
 
 
@@ -171,10 +179,21 @@ void nRF24L01_text::puts32 (char const* str)
 
 char nRF24L01_text::getchar (void)
     {
-    if (!(g_RX_queue.is_empty ()))
-        return (g_RX_queue.get ());
+    char ch;                                // Character from the received packet
+
+    if (!check_for_char ())
+        return ('\0');
+
+    // A packet's characters are read up to and including the first '\0'; then the
+    // packet's buffer is given back
+    ch = g_RX_pool[rx_handle].payload[rx_index++];
+    if (ch == '\0' || rx_index >= nRF24_PAYLOAD_SIZE)
+        {
+        g_RX_pool.release (rx_handle);
+        rx_handle = PKT_POOL_NONE;
+        }
 
-    return ('\0');
+    return (ch);
     }
 
 
@@ -186,40 +205,101 @@ char nRF24L01_text::getchar (void)
 
 bool nRF24L01_text::check_for_char (void)
     {
-    // Check the receiver queue first; if there's something there, we're done
-    if (g_RX_queue.is_empty ())
-        return (false);
+    // If a packet is being read, there's a character in it; if not, start the next
+    if (rx_handle == PKT_POOL_NONE)
+        {
+        rx_handle = g_RX_pool.take_full ();
+        rx_index = 0;
+        }
 
-    return (true);
+    return (rx_handle != PKT_POOL_NONE);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method takes the oldest received packet, so that it can be read all at once
+ *  in place with packet_data(). Packets which getchar() has started on aren't taken
+ *  here. The packet's buffer must be given back with release_packet() when the caller
+ *  is finished with it, or the radio will run out of places to put packets. 
+ *  @return A handle for the packet, or PKT_POOL_NONE if no packet has been received
+ */
+
+unsigned char nRF24L01_text::get_packet (void)
+    {
+    return (g_RX_pool.take_full ());
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method finds the payload of a received packet. 
+ *  @param handle The packet's handle, from get_packet()
+ *  @return A pointer to the packet's nRF24_PAYLOAD_SIZE bytes of payload
+ */
+
+unsigned char* nRF24L01_text::packet_data (unsigned char handle)
+    {
+    return (g_RX_pool[handle].payload);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method gives a received packet's buffer back so that another packet can be 
+ *  received into it. 
+ *  @param handle The packet's handle, from get_packet()
+ */
+
+void nRF24L01_text::release_packet (unsigned char handle)
+    {
+    g_RX_pool.release (handle);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method returns the number of packets which have been lost since it was last
+ *  called because every buffer was full when they arrived. 
+ *  @return The number of packets lost
+ */
+
+unsigned char nRF24L01_text::get_dropped_packets (void)
+    {
+    return (g_RX_pool.take_dropped ());
     }
 
 
 //--------------------------------------------------------------------------------------
 /** This is the interrupt service routine which is called whenever the nRF23L01 radio
  *  module drops its interrupt pin low. This even occurs when there's data which has
- *  arrived into the receiver. The ISR gets the data from the radio and puts it into
- *  the receiving queue. 
+ *  arrived into the receiver. The ISR reads the packet from the radio straight into an
+ *  empty buffer in the receive pool and, if the radio's status says data did arrive,
+ *  hands the buffer over. Otherwise the interrupt was for a transmission and the 
+ *  buffer is kept for next time, since only the task may put buffers back in the 
+ *  pool. If there's no empty buffer, a packet which arrived is dropped and counted. 
  */
 
 ISR (INT7_vect)
     {
-    static unsigned char buffer[33];        // Buffer holds data from radio
-    unsigned char index;                    // Index into the buffer
+    static unsigned char handle = PKT_POOL_NONE;    // Handle of the packet buffer
+    unsigned char buffer[2];                // Buffer holds commands to the radio
+    bool stored = false;                    // True if a packet was handed over
 
     // Clear the interrupt flag in the processor
     EIFR |= (1 << INTF7);
 
-    // Get data out from the buffer
-    buffer[0] = nRF24_RD_PLD;
-    for (unsigned char count = 1; count < 33; count++)
-        buffer[count] = '\0';
-    g_p_spi->transfer (buffer, 33, g_slave_mask);
-
-    // Put data from the buffer into the queue
-    for (index = 1; index <= 33; index++)
+    // Read the payload into the packet buffer; what goes out after the command 
+    // doesn't matter to the radio, and the status comes back in place of the command
+    if (handle == PKT_POOL_NONE)
+        handle = g_RX_pool.take_empty ();
+    if (handle != PKT_POOL_NONE)
         {
-        g_RX_queue.put (buffer[index]);
-        if (buffer[index] == '\0') break;
+        g_RX_pool[handle].status = nRF24_RD_PLD;
+        g_p_spi->transfer (&(g_RX_pool[handle].status), nRF24_PAYLOAD_SIZE + 1, 
+                           g_slave_mask);
+        if (g_RX_pool[handle].status & nRF24_RX_DR)
+            {
+            g_RX_pool.hand_over (handle);
+            handle = PKT_POOL_NONE;
+            stored = true;
+            }
         }
 
     // Flush the buffer
@@ -227,6 +307,11 @@ ISR (INT7_vect)
     buffer[1] = 0x00;
     g_p_spi->transfer (buffer, 2, g_slave_mask);
 
+    // RX_DR stays set until the status is written below, so a packet which was just
+    // stored still shows in the status; only one which wasn't stored is counted
+    if (!stored && (buffer[0] & nRF24_RX_DR))
+        g_RX_pool.drop ();
+
     // Clear the interrupt source in the nRF24L01 radio 
     buffer[0] = nRF24_WR_REG | nRF24_REG_STATUS;
     buffer[1] = nRF24_RX_DR | nRF24_TX_DS | nRF24_MAX_RT;
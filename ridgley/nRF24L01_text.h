@@ -16,6 +16,7 @@
  *    \li 11-15-07 SCH Overhauled to properly control radios and increase speed
  *    \li 01-26-07 SCH Fixed more major flaws
  *    \li 02-15-08 JRR Changed to use hardware SPI port on ME405 boards
+ *    \li 10-16-26     Received packets are read straight into a pool of buffers
  */
 //*************************************************************************************
 
@@ -23,12 +24,32 @@
 #ifndef _NRF24L01_TEXT_H_
 #define _NRF24L01_TEXT_H_
 
-#include "spi_bb.h"                         // Header for bit-banged SPI port
-#include "avr_queue.h"                      // Template header for circular buffer
+#include "packet_pool.h"                    // Buffers passed from ISR to task
 #include "base_text_serial.h"               // Header for base serial devices
 #include "nRF24L01_base.h"                  // Header for base nRF24L01 radio driver
 
 
+/// This is the number of received packets which can wait to be read; a power of two
+#define nRF24_RX_POOL_SIZE      4
+
+/// This is the number of bytes in the payload of every packet
+#define nRF24_PAYLOAD_SIZE      32
+
+
+//-------------------------------------------------------------------------------------
+/** This structure holds one received packet laid out as it comes in over the SPI port:
+ *  the radio's status byte, which arrives while the read command goes out, and then 
+ *  the payload. The interrupt service routine reads each packet straight into one of
+ *  these in the receive pool.
+ */
+
+struct nRF24_rx_frame
+    {
+    unsigned char status;                   ///< Command going out, status coming in
+    unsigned char payload[nRF24_PAYLOAD_SIZE];  ///< The data which was received
+    };
+
+
 //-------------------------------------------------------------------------------------
 /** This class operates a radio module based on a Nordic nRF24L01 chip in text mode.
  *  In this mode, the radio sends and receives character strings, acting as similarly
@@ -56,6 +77,9 @@ class nRF24L01_text: public nRF24L01_base, public base_text_serial
 
     // Protected data and methods are accessible from this class and its descendents
     protected:
+        unsigned char rx_handle;            // Packet being read by getchar(), if any
+        unsigned char rx_index;             // Next character in that packet
+
         void puts32 (const char*);          // Sends 32-char string chunks to radio
 
     // Public methods can be called from anywhere in the program where there is a 
@@ -64,12 +88,18 @@ class nRF24L01_text: public nRF24L01_base, public base_text_serial
         // The constructor sets up the radio interface
         nRF24L01_text (volatile unsigned char&, volatile unsigned char&, unsigned char,
             volatile unsigned char&, volatile unsigned char&, unsigned char, 
-            spi_bb_port*, unsigned char slave_mask, base_text_serial* = NULL);
+            nRF24_spi_port*, unsigned char slave_mask, base_text_serial* = NULL);
 
         bool putchar (char);                // Write one character to serial port
         void puts (char const*);            // Write a string to serial port
+        using base_text_serial::puts;       // and from program memory, by the base's
         bool check_for_char (void);         // Check if a character is in the buffer
         char getchar (void);                // Get a character; wait if none is ready
+
+        unsigned char get_packet (void);    // Take the oldest received packet
+        unsigned char* packet_data (unsigned char); // Find a received packet's payload
+        void release_packet (unsigned char);    // Give a packet's buffer back
+        unsigned char get_dropped_packets (void);   // Count packets lost for no buffer
     };
 
 #endif  // _NRF24L01_TEXT_H_
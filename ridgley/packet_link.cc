@@ -0,0 +1,290 @@
+//======================================================================================
+/** \file packet_link.cc
+ *    This file contains the link protocol which carries checked, acknowledged packets
+ *    over the nRF24L01 radio. See packet_link.h for how it's used.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *    \li  10-16-26  Lost packets are reported through STL_LOG_WRITE
+ *    \li  10-16-26  So are packets the radio dropped for lack of a receive buffer
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "nRF24L01_text.h"                  // Nordic nRF24L01 radio module header
+#include "stl_log_level.h"                  // Text messages filtered by module and level
+#include "packet_link.h"                    // Header for this file
+
+
+/// This type can't be declared unless a packet exactly fills one radio payload, which
+/// it must do to be read in place from the radio's receive buffers
+typedef char link_size_check[(sizeof (link_packet) == nRF24_PAYLOAD_SIZE) ? 1 : -1];
+
+
+//--------------------------------------------------------------------------------------
+/** This constructor sets up a link through the given radio. The first sequence number
+ *  is taken from the timer, so that a board which has been reset doesn't start with
+ *  the number its last packet had, which the receivers would take for a repeat.
+ *  @param a_radio A pointer to the radio which carries the packets
+ *  @param a_timer A pointer to the task timer, which times retransmissions
+ *  @param my_address This board's address on the link; it mustn't be LINK_BROADCAST
+ *  @param a_serial A pointer to a serial port on which lost packets are reported
+ */
+
+packet_link::packet_link (nRF24L01_text* a_radio, task_timer* a_timer,
+                          unsigned char my_address, base_text_serial* a_serial)
+    {
+    p_radio = a_radio;
+    p_timer = a_timer;
+    p_serial = a_serial;
+    address = my_address;
+
+    tx_waiting = false;
+    tx_sequence = (unsigned char)task_timer::get_ticks ();
+    tx_tries = 0;
+    retry_at = 0;
+    rx_full = false;
+    num_peers = 0;
+    next_peer = 0;
+
+    num_retries = 0;
+    num_failed = 0;
+    num_dropped = 0;
+    num_bad = 0;
+    num_duplicates = 0;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method reads the time from the task timer as one number.
+ *  @return The current time in timer counts
+ */
+
+long packet_link::read_time (void)
+    {
+    time_stamp now;                         // The current time
+    long counts;                            // The same time as a number
+
+    p_timer->save_time_stamp (now);
+    now.get_time (counts);
+
+    return (counts);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method sends a packet once over the radio. The radio's transmit() overwrites
+ *  the buffer it's given with what comes back over the SPI port, so the packet is
+ *  copied into a buffer which can be thrown away, after the radio's command byte.
+ *  @param packet The packet to be sent, which must have been sealed
+ */
+
+void packet_link::send_frame (link_packet& packet)
+    {
+    unsigned char frame[nRF24_PAYLOAD_SIZE + 1];    // Command byte, then the packet
+
+    memcpy (frame + 1, &packet, nRF24_PAYLOAD_SIZE);
+    p_radio->transmit (frame);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method sends an acknowledgement for a packet which was received.
+ *  @param packet The packet which was received
+ */
+
+void packet_link::send_ack (link_packet& packet)
+    {
+    link_packet ack (packet.get_source_address (), address, PKT_ACK, NULL, 0);
+
+    ack.set_sequence (packet.get_sequence ());
+    ack.seal ();
+    send_frame (ack);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method checks if a packet has the same sequence number as the last one which
+ *  was passed on from the same sender. A sender which isn't remembered takes the place
+ *  of the one which was remembered longest ago if there's no room.
+ *  @param packet The packet which was received
+ *  @return True if the packet is a repeat of one which was already passed on
+ */
+
+bool packet_link::is_duplicate (link_packet& packet)
+    {
+    unsigned char from = packet.get_source_address ();
+
+    for (unsigned char index = 0; index < num_peers; index++)
+        if (peer_address[index] == from)
+            {
+            if (peer_sequence[index] == packet.get_sequence ())
+                return (true);
+            peer_sequence[index] = packet.get_sequence ();
+            return (false);
+            }
+
+    peer_address[next_peer] = from;
+    peer_sequence[next_peer] = packet.get_sequence ();
+    if (num_peers < LINK_MAX_PEERS)
+        num_peers++;
+    if (++next_peer >= LINK_MAX_PEERS)
+        next_peer = 0;
+
+    return (false);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method deals with one packet from the radio. An acknowledgement of the packet
+ *  being waited for ends the wait. A new packet is acknowledged and kept for receive(),
+ *  unless the last one hasn't been taken yet; then it isn't acknowledged, so that the
+ *  sender will send it again later. A repeat of a packet which was already kept is
+ *  acknowledged again, since the first acknowledgement must have been lost.
+ *  @param packet The packet, still in the radio's receive buffer
+ */
+
+void packet_link::handle_packet (link_packet& packet)
+    {
+    unsigned char to = packet.get_destination_address ();
+
+    if (!packet.is_valid ())
+        {
+        num_bad++;
+        return;
+        }
+    if (to != address && to != LINK_BROADCAST)
+        return;
+
+    if (packet.get_type () == PKT_ACK)
+        {
+        if (tx_waiting && to == address && packet.get_sequence () == tx_sequence
+            && (tx_packet.get_destination_address () == LINK_BROADCAST
+                || tx_packet.get_destination_address () == packet.get_source_address ()))
+            tx_waiting = false;
+        return;
+        }
+
+    if (rx_full)
+        return;
+
+    if (is_duplicate (packet))
+        num_duplicates++;
+    else
+        {
+        memcpy (&rx_packet, &packet, sizeof (link_packet));
+        rx_full = true;
+        }
+    send_ack (packet);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method sends a packet and starts waiting for it to be acknowledged. It gives
+ *  the packet the next sequence number and its CRC.
+ *  @param to The address of the board to which the packet is sent, or LINK_BROADCAST
+ *  @param type The type of data in the packet
+ *  @param p_data A pointer to the data to be sent
+ *  @param bytes The number of bytes of data, up to LINK_PAYLOAD_SIZE
+ *  @return True if the packet was sent, false if the link is still busy with another
+ */
+
+bool packet_link::send (unsigned char to, pkt_type type, const void* p_data,
+                        unsigned char bytes)
+    {
+    if (tx_waiting)
+        return (false);
+
+    tx_packet.set_destination_address (to);
+    tx_packet.set_source_address (address);
+    tx_packet.set_type (type);
+    tx_packet.set_sequence (++tx_sequence);
+    tx_packet.fill_payload (p_data, bytes);
+    tx_packet.seal ();
+
+    send_frame (tx_packet);
+    tx_waiting = true;
+    tx_tries = 1;
+    retry_at = read_time () + LINK_RETRY_TIME;
+
+    return (true);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method handles every packet the radio has received since it was last called,
+ *  counting and reporting any which the radio had to drop for lack of a buffer, then
+ *  sends the packet being waited for again if its time has come, or gives up on
+ *  it if it has been sent LINK_MAX_TRIES times.
+ */
+
+void packet_link::poll (void)
+    {
+    unsigned char handle;                   // Handle of a packet from the radio
+    unsigned char dropped;                  // Packets the radio dropped since last time
+    long now;                               // Current time in timer counts
+
+    while ((handle = p_radio->get_packet ()) != PKT_POOL_NONE)
+        {
+        handle_packet (*(link_packet*)(p_radio->packet_data (handle)));
+        p_radio->release_packet (handle);
+        }
+
+    if ((dropped = p_radio->get_dropped_packets ()) != 0)
+        {
+        num_dropped += dropped;
+        if (p_serial != NULL)
+            STL_LOG_WRITE (RADIO, WARN, p_serial, F ("Radio: ") << dropped
+                           << F (" received packets dropped, no buffer") << endl);
+        }
+
+    if (!tx_waiting)
+        return;
+
+    now = read_time ();
+    if (now - retry_at < 0)
+        return;
+
+    if (tx_tries >= LINK_MAX_TRIES)
+        {
+        tx_waiting = false;
+        num_failed++;
+        if (p_serial != NULL)
+            STL_LOG_WRITE (RADIO, WARN, p_serial, F ("Radio: packet ")
+                           << tx_packet.get_sequence () << F (" to ")
+                           << tx_packet.get_destination_address () << F (" lost") << endl);
+        return;
+        }
+
+    send_frame (tx_packet);
+    num_retries++;
+    retry_at = now + (LINK_RETRY_TIME << tx_tries) 
+               + (task_timer::get_ticks () & 0x03FF);
+    tx_tries++;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method takes the packet which was last received, if there is one, making room
+ *  for the next.
+ *  @param packet A reference to a packet into which the received one is copied
+ *  @return True if a packet was taken, false if there wasn't one
+ */
+
+bool packet_link::receive (link_packet& packet)
+    {
+    if (!rx_full)
+        return (false);
+
+    memcpy (&packet, &rx_packet, sizeof (link_packet));
+    rx_full = false;
+
+    return (true);
+    }
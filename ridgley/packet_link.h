@@ -0,0 +1,167 @@
+//======================================================================================
+/** \file packet_link.h
+ *    This file contains a link protocol which carries packet_n packets over the nRF24L01
+ *    radio so that they get through or the sender finds out that they didn't. The radio
+ *    chip's own acknowledgement and retransmission are turned off, and text sent with
+ *    the radio's << operator is sent once, unchecked, with nothing to say whether it
+ *    arrived. Here each packet has a CRC-16 and a sequence number; the receiver sends
+ *    back an acknowledgement for each good packet addressed to it, and the sender sends
+ *    the packet again, waiting longer each time, until it's acknowledged or it has been
+ *    tried LINK_MAX_TRIES times.
+ *
+ *  Usage:
+ *    The link belongs to the task which uses the radio. The task calls poll() each time
+ *    it runs, which handles everything the radio has received and sends packets again
+ *    when they're due; it then sends and receives packets:
+ *    \code
+ *    link.poll ();
+ *    if (!link.is_busy ())
+ *        link.send (LINK_BROADCAST, PKT_COORDS, coords, 2);
+ *    if (link.receive (packet))
+ *        use (packet);
+ *    \endcode
+ *    One packet at a time is sent and waited for. Packets which were given up on, and
+ *    packets which the radio had to drop because all its receive buffers were full,
+ *    are counted and reported on the serial port, if there is one, so that lost data
+ *    is no longer lost silently.
+ *
+ *  How it works:
+ *    A packet fills one 32-byte radio payload: four bytes of header, a payload of
+ *    LINK_PAYLOAD_SIZE bytes and the CRC. Packets whose CRC is wrong, such as the text
+ *    which other programs send with the radio, are thrown away and counted. An
+ *    acknowledgement is a PKT_ACK packet carrying the sequence number of the packet it
+ *    answers. When an acknowledgement is lost, the sender sends the packet again; the
+ *    receiver remembers the last sequence number it got from each of a few senders, so
+ *    it acknowledges the copy but doesn't pass it on a second time. Each wait before
+ *    sending again is twice as long as the one before it, plus up to a millisecond
+ *    taken from the low bits of the timer, so that two boards whose packets collided
+ *    don't collide again on every try.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *    \li  10-16-26  Packets dropped by the radio on receiving are counted and reported
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _PACKET_LINK_H_                     // To prevent packet_link.h from being
+#define _PACKET_LINK_H_                     // included in a source file more than once
+
+#include "base_text_serial.h"               // Serial port for reporting lost packets
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "nRF24L01_text.h"                  // Nordic nRF24L01 radio module header
+#include "packet_n.h"                       // The packets which the link carries
+
+
+/// This is the number of payload bytes in each packet, which fills one radio payload
+#define LINK_PAYLOAD_SIZE       (nRF24_PAYLOAD_SIZE - 6)
+
+/// Packets sent to this address are accepted, and acknowledged, by every receiver
+#define LINK_BROADCAST          0xFF
+
+/// This is the number of times a packet is sent before the sender gives up on it
+#define LINK_MAX_TRIES          5
+
+/// This is how long in microseconds the sender waits for an acknowledgement before
+/// sending a packet the second time; each later wait is twice as long
+#define LINK_RETRY_TIME         4000L
+
+/// This is the number of senders whose last sequence numbers are remembered
+#define LINK_MAX_PEERS          4
+
+
+/// This is the type of packet which the link sends and receives
+typedef packet_n<LINK_PAYLOAD_SIZE> link_packet;
+
+
+//--------------------------------------------------------------------------------------
+/** This class implements the link protocol over one radio.
+ */
+
+class packet_link
+    {
+    protected:
+        nRF24L01_text* p_radio;             ///< The radio which carries the packets
+        task_timer* p_timer;                ///< Timer which times retransmissions
+        base_text_serial* p_serial;         ///< Serial port for reports, or NULL
+        unsigned char address;              ///< This board's address on the link
+
+        link_packet tx_packet;              ///< Packet waiting to be acknowledged
+        bool tx_waiting;                    ///< True while tx_packet isn't acknowledged
+        unsigned char tx_sequence;          ///< Sequence number of the last new packet
+        unsigned char tx_tries;             ///< Times tx_packet has been sent so far
+        long retry_at;                      ///< Time at which to send tx_packet again
+
+        link_packet rx_packet;              ///< Packet received and not yet taken
+        bool rx_full;                       ///< True while rx_packet hasn't been taken
+
+        unsigned char peer_address[LINK_MAX_PEERS];     ///< Senders heard from
+        unsigned char peer_sequence[LINK_MAX_PEERS];    ///< Last sequence from each
+        unsigned char num_peers;            ///< Number of senders remembered
+        unsigned char next_peer;            ///< Place to forget when there's no room
+
+        unsigned int num_retries;           ///< Packets sent again for lack of an ack
+        unsigned int num_failed;            ///< Packets given up on
+        unsigned int num_dropped;           ///< Packets lost for lack of a buffer
+        unsigned int num_bad;               ///< Packets received with a wrong CRC
+        unsigned int num_duplicates;        ///< Repeated packets which weren't passed on
+
+        long read_time (void);              // Get the time as a number of counts
+        void send_frame (link_packet&);     // Send a packet once over the radio
+        void send_ack (link_packet&);       // Acknowledge a packet which was received
+        bool is_duplicate (link_packet&);   // Check if a packet has been had already
+        void handle_packet (link_packet&);  // Deal with one packet from the radio
+
+    public:
+        // The constructor sets up a link through the given radio
+        packet_link (nRF24L01_text*, task_timer*, unsigned char, base_text_serial* = NULL);
+
+        // This method sends a packet and starts waiting for it to be acknowledged
+        bool send (unsigned char, pkt_type, const void*, unsigned char);
+
+        // This method handles received packets and sends packets again when they're due
+        void poll (void);
+
+        // This method takes the packet which was last received, if there is one
+        bool receive (link_packet&);
+
+        /** This method checks if a packet is still waiting to be acknowledged; if so,
+         *  send() won't take another one yet.
+         *  @return True if the link is busy with a packet
+         */
+        bool is_busy (void) { return (tx_waiting); }
+
+        /** This method returns the number of packets which were sent again because no
+         *  acknowledgement came back in time.
+         *  @return The number of retransmissions
+         */
+        unsigned int get_retries (void) { return (num_retries); }
+
+        /** This method returns the number of packets which were given up on after
+         *  LINK_MAX_TRIES tries.
+         *  @return The number of packets which were lost
+         */
+        unsigned int get_failures (void) { return (num_failed); }
+
+        /** This method returns the number of packets which arrived when the radio had
+         *  no empty receive buffer to put them in.
+         *  @return The number of packets which were dropped on receiving
+         */
+        unsigned int get_dropped (void) { return (num_dropped); }
+
+        /** This method returns the number of packets received whose CRC was wrong.
+         *  @return The number of bad packets
+         */
+        unsigned int get_bad_packets (void) { return (num_bad); }
+
+        /** This method returns the number of repeated packets which were acknowledged
+         *  but not passed on.
+         *  @return The number of duplicates
+         */
+        unsigned int get_duplicates (void) { return (num_duplicates); }
+    };
+
+#endif // _PACKET_LINK_H_
@@ -9,18 +9,25 @@
  *      \li Address of recipient  - 1 byte
  *      \li Address of sender     - 1 byte
  *      \li Code for type of data - 1 byte
+ *      \li Sequence number       - 1 byte
  *      \li Payload               - N bytes
- *      \li Checksum              - 1 byte
+ *      \li CRC-16, high byte first - 2 bytes
  *
  *      The packet content codes are defined and described in the enumeration called
- *      'pkt_code' in this file. 
+ *      'pkt_code' in this file. The packet is laid out in memory exactly as it's sent,
+ *      so it can be copied to and from a radio's buffer as a block of bytes. The 
+ *      sequence number tells a receiver whether a packet is new or is a repeat of one
+ *      it has already seen; see packet_link.h for the protocol which uses it. 
  *
  *  Revised:
  *      \li 03-29-08  JRR  Original file
+ *      \li 10-16-26       Template methods compile; added a sequence number and a
+ *                         CRC-16 in place of the checksum
  */
 //*************************************************************************************
 
 #include "base_text_serial.h"
+#include "crc16.h"
 
 
 /// These defines prevent this file from being included more than once in a *.cc file
@@ -50,6 +57,7 @@ typedef enum pkt_type {
     PKT_INT_ARRAY,          ///< An array of short (16 bit) integers
     PKT_LONG_ARRAY,         ///< An array of long (32 bit) integers
     PKT_WXDATA,             ///< Data from a weather measurement station
+    PKT_COORDS,             ///< Room coordinates of something which has been found
     PKT_ERROR               ///< Packet code shouldn't ever be used
     };
 
@@ -78,14 +86,24 @@ class packet_n
         /// This is the address of the device from which packet is being sent.
         address_type addr_from;
 
-        /// This code shows what type of data is in the packet. 
-        pkt_type type;
+        /// This code shows what type of data is in the packet. It's one of the codes
+        /// in pkt_type, kept in one byte so the packet's layout doesn't depend on how
+        /// big the compiler makes an enum
+        unsigned char type;
+
+        /// This number is one more than that of the last new packet from the sender
+        unsigned char sequence;
 
         /// This array holds the "payload" of data which will be sent or received
         unsigned char payload[payload_size];
 
-        /// This is a simple checksum computed by adding address, code, and data bytes
-        unsigned char checksum;
+        /// This is a CRC-16 of everything above, high byte first
+        unsigned char crc[2];
+
+        /// This method computes the CRC of the packet's contents
+        /// @return The CRC of every byte in the packet which comes before the CRC
+        uint16_t compute_crc (void) 
+            { return (crc16 (this, (unsigned char*)crc - (unsigned char*)this)); }
 
     // Public methods can be called from anywhere in the program where there is a 
     // pointer or reference to an object of this class
@@ -93,7 +111,7 @@ class packet_n
         packet_n (void);                    ///< Default constructor makes empty packet
 
         /// Constructor which creates a packet and fills its contents all at once
-        packet_n (address_type, address_type, pkt_type, void*, 
+        packet_n (address_type, address_type, pkt_type, const void*, 
                   unsigned char bytes = payload_size);
 
         /// This method sets the packet's destination address
@@ -113,18 +131,48 @@ class packet_n
 
         /// This method sets the packet's data type
         /// @param new_type The type of packet which will be sent
-        void set_type (pkt_type new_type) { type = new_type; }
+        void set_type (pkt_type new_type) { type = (unsigned char)new_type; }
+
+        /// This method returns the packet's data type
+        /// @return The type of data in the packet
+        pkt_type get_type (void) { return ((pkt_type)type); }
+
+        /// This method sets the packet's sequence number
+        /// @param number The sequence number
+        void set_sequence (unsigned char number) { sequence = number; }
+
+        /// This method returns the packet's sequence number
+        /// @return The sequence number
+        unsigned char get_sequence (void) { return (sequence); }
 
         /// This method returns the number of bytes in the packet's payload
         /// @return The number of bytes in the payload
         unsigned char get_payload_size (void) { return (payload_size); }
 
         /// This method fills the packet's contents from the given buffer
-        void fill_payload (void* p_buf, unsigned char bytes = payload_size);
+        void fill_payload (const void* p_buf, unsigned char bytes = payload_size);
 
         /// This method copies the payload into the given buffer
         void copy_payload (void* p_buf, unsigned char bytes = payload_size);
-        
+
+        /// This method puts the CRC into the packet once its contents are complete.
+        /// It must be called again after anything in the packet is changed
+        void seal (void) 
+            {
+            uint16_t check = compute_crc ();
+            crc[0] = (unsigned char)(check >> 8);
+            crc[1] = (unsigned char)check;
+            }
+
+        /// This method checks the CRC of a packet which has been received
+        /// @return True if the packet's contents match its CRC
+        bool is_valid (void)
+            {
+            uint16_t check = compute_crc ();
+            return (crc[0] == (unsigned char)(check >> 8) 
+                    && crc[1] == (unsigned char)check);
+            }
+
         /// This operator allows access to one byte in the payload buffer
         unsigned char& operator [] (unsigned char i) { return payload[i]; }
     };
@@ -136,12 +184,13 @@ class packet_n
  *  The payload is not initialized, so it should be assumed to contain garbage. 
  */
 
-template <unsigned char payload_size = PKT_DEFSZ, class address_type = unsigned char>
-packet_n::packet_n (void)
+template <unsigned char payload_size, class address_type>
+packet_n<payload_size, address_type>::packet_n (void)
     {
     set_source_address (0);                 // The addressing data is zero and null
     set_destination_address (0);
     set_type (PKT_NULL);
+    set_sequence (0);
     }
 
 
@@ -155,13 +204,14 @@ packet_n::packet_n (void)
  *  @param bytes How many bytes of data are to be put in the packet
  */
 
-template <unsigned char payload_size = PKT_DEFSZ, class address_type = unsigned char>
-packet_n::packet_n (address_type where_to, address_type where_from, pkt_type a_type,
-    void* p_data, unsigned char bytes = payload_size)
+template <unsigned char payload_size, class address_type>
+packet_n<payload_size, address_type>::packet_n (address_type where_to, 
+    address_type where_from, pkt_type a_type, const void* p_data, unsigned char bytes)
     {
     set_destination_address (where_to);
     set_source_address (where_from);
     set_type (a_type);
+    set_sequence (0);
     fill_payload (p_data, bytes);
     }
 
@@ -174,14 +224,16 @@ packet_n::packet_n (address_type where_to, address_type where_from, pkt_type a_t
  *      the packet); the following bytes will be set to zero.
  */
 
-template <unsigned char payload_size = PKT_DEFSZ, class address_type = unsigned char>
-void packet_n::fill_payload (void* p_data, unsigned char bytes)
+template <unsigned char payload_size, class address_type>
+void packet_n<payload_size, address_type>::fill_payload (const void* p_data, 
+                                                         unsigned char bytes)
     {
+    const unsigned char* p_byte = (const unsigned char*)p_data;
     unsigned char index;                    // Counts through elements in the buffer
 
     // Copy the payload bytes from the given address into the buffer
-    for (index = 0; index < bytes; index++)
-        payload[index] = *p_data++;
+    for (index = 0; index < bytes && index < payload_size; index++)
+        payload[index] = *p_byte++;
 
     // If the buffer hasn't been completely filled, pad the rest with zeros
     while (index < payload_size)
@@ -192,17 +244,20 @@ void packet_n::fill_payload (void* p_data, unsigned char bytes)
 //-------------------------------------------------------------------------------------
 /** This method copies a bunch of bytes from the buffer for this packet into a buffer
  *  at the given location. 
- *  @param p_data A pointer to the data to be copied into this packet
+ *  @param p_data A pointer to the place where the data is to be copied
  *  @param bytes The number of bytes to be copied (default is the number of bytes in
- *      the packet); the following bytes will be set to zero.
+ *      the packet)
  */
 
-template <unsigned char payload_size = PKT_DEFSZ, class address_type = unsigned char>
-void packet_n::copy_payload (void* p_data, unsigned char bytes)
+template <unsigned char payload_size, class address_type>
+void packet_n<payload_size, address_type>::copy_payload (void* p_data, 
+                                                         unsigned char bytes)
     {
-    // Copy the payload bytes from the given address into the buffer
-    for (unsigned char index = 0; index < bytes; index++)
-        payload[index] = *p_data++ = payload[index];
+    unsigned char* p_byte = (unsigned char*)p_data;
+
+    // Copy the payload bytes from the buffer to the given address
+    for (unsigned char index = 0; index < bytes && index < payload_size; index++)
+        *p_byte++ = payload[index];
     }
 
 
@@ -0,0 +1,144 @@
+//======================================================================================
+/** \file packet_pool.h
+ *    This file contains a fixed pool of packet buffers which are passed between an
+ *    interrupt service routine and a task by handle, so that a packet is written once,
+ *    in place, by whatever receives it and read in place by whatever uses it. Nothing
+ *    is copied and nothing is queued a byte at a time.
+ *
+ *  Usage:
+ *    The producer, usually a receive interrupt, takes an empty buffer, fills it and
+ *    hands it over; the consumer, usually a task, takes full buffers in the order they
+ *    were handed over, uses them and gives them back:
+ *    \code
+ *    unsigned char handle = pool.take_empty ();     // In the ISR
+ *    if (handle != PKT_POOL_NONE)
+ *        {
+ *        read_packet_into (pool[handle]);
+ *        pool.hand_over (handle);
+ *        }
+ *    ...
+ *    unsigned char handle = pool.take_full ();      // In the task
+ *    if (handle != PKT_POOL_NONE)
+ *        {
+ *        use (pool[handle]);
+ *        pool.release (handle);
+ *        }
+ *    \endcode
+ *    If the consumer falls so far behind that there's no empty buffer, the producer
+ *    gets PKT_POOL_NONE and the packet is lost; the producer calls drop() to count it,
+ *    and take_dropped() tells the consumer.
+ *
+ *  How it works:
+ *    Handles travel between the two sides in two spsc_queue's, one of empty buffers
+ *    and one of full ones. Each side only puts into one queue and gets from the other,
+ *    so neither ever has to turn interrupts off.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _PACKET_POOL_H_                     // To prevent packet_pool.h from being
+#define _PACKET_POOL_H_                     // included in a source file more than once
+
+#include "spsc_queue.h"                     // Lock-free queues carry the handles
+
+
+/// This handle means no buffer; it's returned when there isn't one to be had
+#define PKT_POOL_NONE           0xFF
+
+
+//--------------------------------------------------------------------------------------
+/** This class implements the packet buffer pool. The template parameters are:
+ *    \li pType: The type of one buffer, usually a structure laid out as the hardware
+ *        delivers packets
+ *    \li pCount: The number of buffers, which must be a power of two no bigger than
+ *        128 as for spsc_queue
+ */
+
+template <class pType, unsigned char pCount>
+class packet_pool
+    {
+    protected:
+        pType buffers[pCount];              ///< The packet buffers themselves
+        spsc_queue<unsigned char, pCount> empty;    ///< Handles of empty buffers
+        spsc_queue<unsigned char, pCount> full;     ///< Handles of full buffers
+        volatile unsigned char num_dropped; ///< Packets lost; written by the producer
+        unsigned char num_reported;         ///< Of those, how many have been reported
+
+    public:
+        /** This constructor creates a pool in which all the buffers are empty. */
+        packet_pool (void)
+            {
+            for (unsigned char handle = 0; handle < pCount; handle++)
+                empty.put (handle);
+            num_dropped = 0;
+            num_reported = 0;
+            }
+
+        /** This method gives the producer an empty buffer to fill.
+         *  @return The buffer's handle, or PKT_POOL_NONE if none are empty
+         */
+        unsigned char take_empty (void)
+            {
+            unsigned char handle;           // Handle of the empty buffer
+
+            return (empty.get (handle) ? handle : PKT_POOL_NONE);
+            }
+
+        /** This method is called by the producer to count a packet which was lost
+         *  because there was no empty buffer to put it in.
+         */
+        void drop (void) { num_dropped = num_dropped + 1; }
+
+        /** This method passes a buffer which the producer has filled to the consumer.
+         *  @param handle The handle of the buffer, as returned by take_empty()
+         */
+        void hand_over (unsigned char handle) { full.put (handle); }
+
+        /** This method gives the consumer the oldest full buffer.
+         *  @return The buffer's handle, or PKT_POOL_NONE if there are no full buffers
+         */
+        unsigned char take_full (void)
+            {
+            unsigned char handle;           // Handle of the full buffer
+
+            return (full.get (handle) ? handle : PKT_POOL_NONE);
+            }
+
+        /** This method gives a buffer which the consumer has finished with back to the
+         *  producer.
+         *  @param handle The handle of the buffer, as returned by take_full()
+         */
+        void release (unsigned char handle) { empty.put (handle); }
+
+        /** This method returns the number of full buffers waiting for the consumer.
+         *  @return The number of packets which have been handed over and not taken
+         */
+        unsigned char num_full (void) const { return (full.num_items ()); }
+
+        /** This method tells the consumer how many packets have been dropped since it
+         *  last asked. The count is kept modulo 256.
+         *  @return The number of packets dropped because no buffer was empty
+         */
+        unsigned char take_dropped (void)
+            {
+            unsigned char dropped = num_dropped;    // One read of the producer's count
+            unsigned char newly = dropped - num_reported;
+
+            num_reported = dropped;
+            return (newly);
+            }
+
+        /** This operator gets a buffer by its handle.
+         *  @param handle The buffer's handle
+         *  @return A reference to the buffer
+         */
+        pType& operator[] (unsigned char handle) { return (buffers[handle]); }
+    };
+
+#endif // _PACKET_POOL_H_
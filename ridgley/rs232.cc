@@ -3,9 +3,9 @@
  *        This file contains functions which allow the use of a serial port on an AVR 
  *        microcontroller. 
  *
- *        This code is designed to work for low-performance applications without 
- *        requiring the use of interrupts.  Interrupt based receiving code has not 
- *        been completed or tested.
+ *        On processors whose UART interrupt vectors are known, characters go through
+ *        ring buffers which are emptied and filled by the UDRE and RXC interrupts;
+ *        see rs232.h. Elsewhere the port is polled without interrupts. 
  *
  *  Revised:
  *      \li 04-03-06  JRR  For updated version of compiler
@@ -18,15 +18,24 @@
  *      \li 07-19-07  JRR  Changed some character return values to bool, added m324p
  *      \li 01-12-08  JRR  Added code for the ATmega128 using USART number 1 only
  *      \li 02-14-08  JRR  Split between base_text_serial and rs232 files
+ *      \li 10-16-26       Transmit and receive through interrupt-driven buffers
+ *      \li 10-16-26       putchar() and puts() are inline for text_stream<rs232>
  */
 //*************************************************************************************
 
 #include <stdint.h>
 #include <stdlib.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "rs232.h"
 
 
+#ifdef RS232_BUFFERED
+/// These pointers let the UART interrupts find the port objects, one for each UART
+static rs232* p_rs232_ports[2] = { NULL, NULL };
+#endif
+
+
 //-------------------------------------------------------------------------------------
 /** This method sets up the AVR UART for communications.  It enables the appropriate 
  *  inputs and outputs and sets the baud rate divisor, and it saves pointers to the
@@ -91,16 +100,261 @@ rs232::rs232 (unsigned char divisor, unsigned char port_number)
         #endif
         }
 
+    #ifdef RS232_BUFFERED
+        full_policy = RS232_BLOCK;
+        tx_overruns = 0;
+        rx_overruns = 0;
+        p_rs232_ports[port_number] = this;
+    #endif
+
     // Read the data register to ensure that it's empty
     port_number = *p_UDR;
     port_number = *p_UDR;
 
+    #ifdef RS232_BUFFERED
+        *p_UCR |= (1 << RXCIE0);            // Received characters cause interrupts
+    #endif
+
 //     #ifdef UART_DOUBLE_SPEED                // If double-speed macro has been defined,
 //         UART_STATUS |= 0x02;                // Turn on double-speed operation
 //     #endif
     }
 
 
+#ifdef RS232_BUFFERED
+
+//-------------------------------------------------------------------------------------
+/** This function checks if the serial port is ready to take another character. 
+ *  @return True if there's room in the transmit buffer, and false if not
+ */
+
+bool rs232::ready_to_send (void)
+    {
+    return (!tx_queue.is_full ());
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method sends all the characters waiting in the transmit buffer by polling the
+ *  UART. It's used when interrupts are disabled, so that the UDRE interrupt can't be
+ *  taking characters out of the buffer at the same time. It gives up on a character,
+ *  and on the ones after it, if the UART isn't ready in UART_TX_TOUT tries. 
+ */
+
+void rs232::send_polled (void)
+    {
+    char ch;                                // Character taken from the buffer
+
+    while (tx_queue.get (ch))
+        {
+        for (unsigned int count = 0; (*p_USR & UDRE_MASK) == 0; count++)
+            if (count > UART_TX_TOUT)
+                {
+                tx_queue.flush ();
+                return;
+                }
+        *p_UDR = ch;
+        }
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method writes a character which putchar() couldn't just put into the transmit
+ *  buffer, because interrupts are disabled or the buffer is full. While interrupts are
+ *  disabled, the buffer can't be emptied by the interrupt, so the character is sent
+ *  right away by polling after any characters which were waiting. If the buffer is 
+ *  full, what happens depends on the policy set with set_full_policy(). 
+ *  @param chout The character to be sent out
+ *  @return True if the character was put into the buffer or sent, false if it was 
+ *      thrown away
+ */
+
+bool rs232::putchar_slow (char chout)
+    {
+    unsigned char sreg = SREG;              // Saved status register
+    char oldest;                            // Character thrown away to make room
+
+    if ((sreg & (1 << SREG_I)) == 0)
+        {
+        send_polled ();                     // Characters already waiting go first
+        tx_queue.put (chout);
+        send_polled ();
+        return (true);
+        }
+
+    if (!tx_queue.put (chout))
+        {
+        if (tx_overruns < 0xFFFF)
+            tx_overruns++;
+
+        switch (full_policy)
+            {
+            case (RS232_DROP):
+                return (false);
+
+            // The oldest character belongs to the interrupt's end of the buffer, so
+            // it can only be taken while the interrupt can't run
+            case (RS232_OVERWRITE):
+                cli ();
+                if (tx_queue.is_full ())
+                    tx_queue.get (oldest);
+                tx_queue.put (chout);
+                SREG = sreg;
+                break;
+
+            // If interrupts are turned off while waiting, nothing else will make room
+            default:
+                while (!tx_queue.put (chout))
+                    if ((SREG & (1 << SREG_I)) == 0)
+                        send_polled ();
+                break;
+            };
+        }
+
+    // The interrupt only turns this bit off when the buffer is empty, which it can't
+    // be now, so the bit needn't be set with interrupts disabled
+    *p_UCR |= (1 << UDRIE0);
+
+    return (true);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method waits until every character in the transmit buffer has been handed to
+ *  the UART. It's called by the send_now manipulator. 
+ */
+
+void rs232::transmit_now (void)
+    {
+    while (!tx_queue.is_empty ())
+        if ((SREG & (1 << SREG_I)) == 0)
+            send_polled ();
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method gets one character from the receive buffer. If there isn't one, it
+ *  waits until there is.  This can sometimes take a long time (even forever), so use 
+ *  this function carefully.  One should almost always use check_for_char() to ensure
+ *  that there's data available first. 
+ *  @return The oldest character which was received
+ */
+
+char rs232::getchar (void)
+    {
+    char ch;                                // Character from the buffer
+
+    // check_for_char() fills the buffer from the UART while interrupts are disabled
+    while (!check_for_char () || !rx_queue.get (ch))
+        ;
+
+    return (ch);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This function checks if there is a character in the receive buffer. While 
+ *  interrupts are disabled, it takes a character from the UART itself if one is there.
+ *  @return True for character available, false for no character available
+ */
+
+bool rs232::check_for_char (void)
+    {
+    if ((SREG & (1 << SREG_I)) == 0 && (*p_USR & RXC_MASK))
+        rx_interrupt ();
+
+    return (!rx_queue.is_empty ());
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method returns the number of received characters which were lost, either 
+ *  because the receive buffer was full or because the UART received another before 
+ *  the last was read. 
+ *  @return The number of receive overruns, which stops at 65535
+ */
+
+unsigned int rs232::get_rx_overruns (void)
+    {
+    unsigned char sreg = SREG;              // Saved status register
+    unsigned int count;                     // Copy of the interrupt's count
+
+    cli ();
+    count = rx_overruns;
+    SREG = sreg;
+
+    return (count);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method is called by the UDRE interrupt when the UART can take a character. It
+ *  gives the UART the oldest character in the transmit buffer, or if there are none,
+ *  turns the interrupt off until putchar() puts another one in. 
+ */
+
+void rs232::tx_interrupt (void)
+    {
+    char ch;                                // Character taken from the buffer
+
+    if (tx_queue.get (ch))
+        *p_UDR = ch;
+    else
+        *p_UCR &= ~(1 << UDRIE0);
+    }
+
+
+//-------------------------------------------------------------------------------------
+/** This method is called by the RXC interrupt when the UART has received a character.
+ *  The status is read before the data, since reading the data clears it. 
+ */
+
+void rs232::rx_interrupt (void)
+    {
+    unsigned char status = *p_USR;          // UART status, including data overrun
+    char ch = *p_UDR;                       // The character which was received
+
+    if (status & (1 << DOR0))
+        if (rx_overruns < 0xFFFF)
+            rx_overruns++;
+    if (!rx_queue.put (ch))
+        if (rx_overruns < 0xFFFF)
+            rx_overruns++;
+    }
+
+
+//-------------------------------------------------------------------------------------
+// These are the interrupt service routines for the UARTs. Each one passes the work on
+// to the port object for its UART, if there is one
+
+ISR (USART0_UDRE_vect)
+    {
+    if (p_rs232_ports[0] != NULL)
+        p_rs232_ports[0]->tx_interrupt ();
+    }
+
+ISR (USART0_RX_vect)
+    {
+    if (p_rs232_ports[0] != NULL)
+        p_rs232_ports[0]->rx_interrupt ();
+    }
+
+#if defined __AVR_ATmega128__ || defined __AVR_ATmega324P__
+ISR (USART1_UDRE_vect)
+    {
+    if (p_rs232_ports[1] != NULL)
+        p_rs232_ports[1]->tx_interrupt ();
+    }
+
+ISR (USART1_RX_vect)
+    {
+    if (p_rs232_ports[1] != NULL)
+        p_rs232_ports[1]->rx_interrupt ();
+    }
+#endif
+
+#else  // RS232_BUFFERED
+
 //-------------------------------------------------------------------------------------
 /** This function checks if the serial port transmitter is ready to send data.  It 
  *  tests whether transmitter buffer is empty. 
@@ -147,18 +401,6 @@ bool rs232::putchar (char chout)
     }
 
 
-//-------------------------------------------------------------------------------------
-/** This method writes all the characters in a string until it gets to the '\\0' at 
- *  the end. Warning: This function blocks until it's finished. 
- *  @param str The string to be written 
- */
-
-void rs232::puts (char const* str)
-    {
-    while (*str) putchar (*str++);
-    }
-
-
 //-------------------------------------------------------------------------------------
 /** This method gets one character from the serial port, if one is there.  If not, it
  *  waits until there is a character available.  This can sometimes take a long time
@@ -190,3 +432,5 @@ bool rs232::check_for_char (void)
     else
         return (false);
     }
+
+#endif // RS232_BUFFERED
@@ -3,9 +3,13 @@
  *        This file contains functions which allow the use of a serial port on an AVR 
  *        microcontroller. 
  *
- *        This code is designed to work for low-performance applications without 
- *        requiring the use of interrupts.  Interrupt based receiving code has not 
- *        been completed or tested.
+ *        On the ATmega128, 324P and 644, characters go through ring buffers which
+ *        the UART's interrupts fill and empty, so writing to the port takes only as
+ *        long as copying characters into the transmit buffer and a task never waits
+ *        for the UART to send them. What happens when the transmit buffer is full is
+ *        chosen with set_full_policy(). While interrupts are disabled, such as at 
+ *        startup before sei() is called, characters are sent right away as they 
+ *        always were. On other processors the port is polled without interrupts. 
  *
  *  Revised:
  *      \li 04-03-06  JRR  For updated version of compiler
@@ -18,6 +22,8 @@
  *      \li 07-19-07  JRR  Changed some character return values to bool, added m324p
  *      \li 01-12-08  JRR  Added code for the ATmega128 using USART number 1 only
  *      \li 02-14-08  JRR  Split between base_text_serial and rs232 files
+ *      \li 10-16-26       Transmit and receive through interrupt-driven buffers
+ *      \li 10-16-26       putchar() and puts() are inline for text_stream<rs232>
  */
 //*************************************************************************************
 
@@ -26,6 +32,7 @@
 #define _RS232_H_
 
 #include "base_text_serial.h"               // Pull in the base class header file
+#include "spsc_queue.h"                     // Lock-free buffers between task and ISR
 
 
 //-------------------------------------------------------------------------------------
@@ -61,6 +68,32 @@
 /** The number of tries to wait for the transmitter buffer to become empty */
 #define UART_TX_TOUT        20000
 
+// The UART is run from interrupts on processors whose interrupt vectors are known here
+#if defined __AVR_ATmega644__ || defined __AVR_ATmega324P__ || defined __AVR_ATmega128__
+    #define RS232_BUFFERED
+#endif
+
+/** The number of characters the transmit buffer holds: 2, 4, 8, ... 128. At 9600 baud
+ *  a full buffer takes 133 ms to send. */
+#define RS232_TX_SIZE       128
+
+/** The number of characters the receive buffer holds: 2, 4, 8, ... 128 */
+#define RS232_RX_SIZE       32
+
+
+//-------------------------------------------------------------------------------------
+/** This enumeration lists the things putchar() can do when the transmit buffer is 
+ *  full. The receive buffer can't wait for anything, since it's filled by an interrupt
+ *  service routine, so when it's full new characters are always thrown away. 
+ */
+
+enum rs232_full_policy
+    {
+    RS232_DROP,             ///< Throw the new character away and return false
+    RS232_BLOCK,            ///< Wait for room, as the unbuffered port always did
+    RS232_OVERWRITE         ///< Throw the oldest waiting character away to make room
+    };
+
 
 //-------------------------------------------------------------------------------------
 /** This class controls a UART (Universal Asynchronous Receiver Transmitter), a common 
@@ -88,16 +121,94 @@ class rs232 : public base_text_serial
         /// This is a pointer to the control register used by the UART
         volatile unsigned char* p_UCR;
 
+    #ifdef RS232_BUFFERED
+        /// This buffer holds characters waiting to be sent by the UDRE interrupt
+        spsc_queue<char, RS232_TX_SIZE> tx_queue;
+
+        /// This buffer holds characters received by the RXC interrupt
+        spsc_queue<char, RS232_RX_SIZE> rx_queue;
+
+        /// This is what putchar() does when the transmit buffer is full
+        rs232_full_policy full_policy;
+
+        /// This counts the characters which found the transmit buffer full
+        unsigned int tx_overruns;
+
+        /// This counts characters lost because the receive buffer or the UART was full
+        volatile unsigned int rx_overruns;
+
+        // Send any waiting characters without interrupts, while they're disabled
+        void send_polled (void);
+
+        // Write a character which couldn't just be put into the transmit buffer
+        bool putchar_slow (char);
+    #endif
+
     // Public methods can be called from anywhere in the program where there is a 
     // pointer or reference to an object of this class
     public:
         // The constructor sets up the UART, saving its baud divisor and location
         rs232 (unsigned char, unsigned char = 0);
         bool ready_to_send (void);          // Check if the port is ready to transmit
+
+    #ifdef RS232_BUFFERED
+        /** This method writes one character to the serial port. The usual case, with
+         *  interrupts on and room in the transmit buffer, is done here in the header
+         *  so that it's compiled inline where the class is known, as it is through a
+         *  text_stream<rs232>; anything else is handled by putchar_slow(). 
+         *  @param chout The character to be sent out
+         *  @return True if the character was put into the buffer or sent, false if it
+         *      was thrown away
+         */
+        bool putchar (char chout)
+            {
+            if ((SREG & (1 << SREG_I)) && tx_queue.put (chout))
+                {
+                *p_UCR |= (1 << UDRIE0);    // Interrupt sends it when the UART's ready
+                return (true);
+                }
+            return (putchar_slow (chout));
+            }
+    #else
         bool putchar (char);                // Write one character to serial port
-        void puts (char const*);            // Write a string constant to serial port
+    #endif
+
+        /** This method writes all the characters in a string until it gets to the 
+         *  '\\0' at the end. It calls this class's putchar() directly, so the 
+         *  character loop is compiled with putchar() inline. Warning: Unless the port
+         *  is buffered, this function blocks until it's finished. 
+         *  @param str The string to be written 
+         */
+        void puts (char const* str)
+            {
+            while (*str)
+                rs232::putchar (*str++);
+            }
+        using base_text_serial::puts;       // and from program memory, by the base's
         bool check_for_char (void);         // Check if a character is in the buffer
         char getchar (void);                // Get a character; wait if none is ready
+
+    #ifdef RS232_BUFFERED
+        void transmit_now (void);           // Wait until everything has been sent
+
+        /** This method chooses what putchar() does when the transmit buffer is full.
+         *  The default is RS232_BLOCK. 
+         *  @param policy The policy to use from now on
+         */
+        void set_full_policy (rs232_full_policy policy) { full_policy = policy; }
+
+        /** This method returns the number of characters which were written when the
+         *  transmit buffer was full. Under RS232_BLOCK each of them had to wait; under
+         *  the other policies each meant a character was thrown away. 
+         *  @return The number of transmit overruns, which stops at 65535
+         */
+        unsigned int get_tx_overruns (void) { return (tx_overruns); }
+
+        unsigned int get_rx_overruns (void);    // Count characters lost on receiving
+
+        void tx_interrupt (void);           // Called by the UDRE interrupt
+        void rx_interrupt (void);           // Called by the RXC interrupt
+    #endif
     };
 
 #endif  // _RS232_H_
@@ -0,0 +1,103 @@
+//======================================================================================
+/** \file spi_hw.cc
+ *    This file contains a class which runs an SPI port with the AVR's SPI hardware.
+ *    See spi_hw.h for how it's used.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#include <stdlib.h>
+#include <avr/io.h>
+
+#include "spi_hw.h"                         // Header for hardware SPI port code
+
+
+//--------------------------------------------------------------------------------------
+/** This constructor sets up the SPI hardware as a master in mode 0, most significant
+ *  bit first, with its clock at half the processor's clock. The SCK and MOSI pins are
+ *  made outputs and MISO an input; the hardware slave select pin is made an output,
+ *  set high, so that it can't take the SPI hardware out of master mode.
+ */
+
+spi_hw_port::spi_hw_port (void)
+    {
+    PORTB &= ~(SPI_HW_SCK_MASK | SPI_HW_MISO_MASK); // SCK low, no pullup on MISO
+    PORTB |= SPI_HW_SS_MASK | SPI_HW_MOSI_MASK;     // Slave select and MOSI high
+    DDRB |= SPI_HW_SS_MASK | SPI_HW_SCK_MASK | SPI_HW_MOSI_MASK;
+    DDRB &= ~SPI_HW_MISO_MASK;
+
+    SPCR = (1 << SPE) | (1 << MSTR);        // Enable as master, mode 0, fosc / 4
+    SPSR = (1 << SPI2X);                    // Double the clock rate to fosc / 2
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method adds an SPI slave by making its slave select pin on port B an output,
+ *  set high so that the slave isn't selected.
+ *  @param ss_mask The mask for the Slave Select (aka Chip Select) pin on slave chip
+ */
+
+void spi_hw_port::add_slave (unsigned char ss_mask)
+    {
+    PORTB |= ss_mask;
+    DDRB |= ss_mask;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method sends the first part of an SPI transmission that consists of a command
+ *  byte plus data. It drops the slave select line, then sends one byte, leaving the
+ *  slave selected for the bytes which follow.
+ *  @param command The command byte to be transmitted over the SPI connection
+ *  @param slave_mask Mask for slave select bit of device with which we're talking
+ */
+
+void spi_hw_port::exch_cmd (unsigned char* command, unsigned char slave_mask)
+    {
+    PORTB &= ~slave_mask;
+    exch_byte (command);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method sends the data of an SPI transmission that consists of a command byte
+ *  plus data, then deselects the slave; it's meant to be called right after
+ *  exch_cmd().
+ *  @param bytes Pointer to an array holding bytes sent to and received from the device
+ *  @param size The number of bytes of data to be sent and received
+ *  @param slave_mask Mask for slave select bit of device with which we're talking
+ */
+
+void spi_hw_port::exch_data (unsigned char* bytes, char size, unsigned char slave_mask)
+    {
+    for ( ; size > 0; size--)
+        exch_byte (bytes++);
+
+    PORTB |= slave_mask;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method transfers bytes to and from a chip attached to the SPI port. The bytes
+ *  in the given array are sent to the chip, and the bytes received from it at the
+ *  same time are put in their places.
+ *  @param bytes Pointer to an array holding bytes sent to and received from the device
+ *  @param size The number of bytes to be sent and received
+ *  @param slave_mask Mask for slave select bit of device with which we're talking
+ */
+
+void spi_hw_port::transfer (unsigned char* bytes, char size, unsigned char slave_mask)
+    {
+    PORTB &= ~slave_mask;
+
+    for ( ; size > 0; size--)
+        exch_byte (bytes++);
+
+    PORTB |= slave_mask;
+    }
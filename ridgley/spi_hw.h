@@ -0,0 +1,106 @@
+//======================================================================================
+/** \file spi_hw.h
+ *    This file contains a class which runs an SPI port with the AVR's SPI hardware. It
+ *    has the same methods as spi_bb_port, so the nRF24L01 radio driver can use either
+ *    one. The bit-banged port sets each bit of each byte by hand with a read, change
+ *    and write of the port through a pointer, so one 33 byte radio packet takes
+ *    hundreds of microseconds, much of it in the radio's interrupt service routine.
+ *    The SPI hardware shifts a byte out and in by itself in 16 processor cycles.
+ *
+ *  Usage:
+ *    The radio is given the hardware port when RADIO_SPI in the Makefile is set to
+ *    -DNRF24_HW_SPI; nRF24L01_base.h then makes nRF24_spi_port mean spi_hw_port
+ *    instead of spi_bb_port. The port's pins are fixed by the chip, so the
+ *    constructor takes no parameters:
+ *    \code
+ *    nRF24_spi_port my_SPI;
+ *    nRF24L01_text my_radio (PORTE, DDRE, 0x40, PORTE, DDRE, 0x80, &my_SPI, 0x01, ...);
+ *    \endcode
+ *    The radio must be wired to the SPI pins: SCK to PB1, MOSI to PB2 and MISO to PB3
+ *    on an ATmega128. The ME405 board's bit-banged wiring has MOSI and MISO the other
+ *    way around, which is why the bit-banged port is still the default. Slave select
+ *    lines have to be on port B. PB0 is the SPI hardware's own slave select pin; it
+ *    is made an output, because if it were an input pulled low the SPI hardware
+ *    would stop being the master.
+ *
+ *  How it works:
+ *    The SPI hardware runs as master in mode 0, most significant bit first, with its
+ *    clock at half the processor's clock, which the nRF24L01 can take. Each byte is
+ *    written to SPDR, and the port waits for the SPIF flag, which is set when the
+ *    hardware has shifted the byte out and the slave's byte in, before reading the
+ *    slave's byte back from SPDR.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _SPI_HW_H_                          // To prevent spi_hw.h from being included
+#define _SPI_HW_H_                          // in a source file more than once
+
+#include <avr/io.h>
+
+
+// These are the SPI hardware's pins on port B
+#if defined (__AVR_ATmega128__) || defined (__AVR_ATmega64__)
+    #define SPI_HW_SS_MASK      0x01        ///< Hardware slave select pin, PB0
+    #define SPI_HW_SCK_MASK     0x02        ///< Serial clock pin, PB1
+    #define SPI_HW_MOSI_MASK    0x04        ///< Master out, slave in pin, PB2
+    #define SPI_HW_MISO_MASK    0x08        ///< Master in, slave out pin, PB3
+#else
+    #error SPI hardware pins currently only defined for Mega128 on ME405 board
+#endif
+
+
+//--------------------------------------------------------------------------------------
+/** This class operates the AVR's SPI hardware as a master, with the same methods as a
+ *  bit-banged spi_bb_port.
+ */
+
+class spi_hw_port
+    {
+    public:
+        // The constructor sets up the SPI hardware as a fast master
+        spi_hw_port (void);
+
+        void add_slave (unsigned char);     // Method to add a slave device connection
+
+        /** This method exchanges one byte with the SPI slave. It doesn't change the
+         *  slave select bit, as this method is expected to be called repeatedly during
+         *  each transmission/reception process.
+         *  @param byte A pointer to the single byte to be exchanged with the SPI slave
+         */
+        void exch_byte (unsigned char* byte)
+            {
+            SPDR = *byte;
+            while (!(SPSR & (1 << SPIF)));
+            *byte = SPDR;
+            }
+
+        // This method sends a first command byte to the SPI device
+        void exch_cmd (unsigned char*, unsigned char);
+
+        // This method exchanges data with the SPI device
+        void exch_data (unsigned char*, char, unsigned char);
+
+        // This method simultaneously sends and receives bytes to and from a device
+        void transfer (unsigned char*, char, unsigned char);
+
+        /** This method returns a pointer to the port used for the input line, MISO.
+         */
+        volatile unsigned char* get_inport (void) { return (&PINB); }
+
+        /** This method returns a pointer to the port used for output on the MOSI,
+         *  SCK, and SS lines. */
+        volatile unsigned char* get_outport (void) { return (&PORTB); }
+
+        /** This method returns a pointer to the data direction register which is used
+         *  to set the directions of the bits on the input and output ports. */
+        volatile unsigned char* get_ddr (void) { return (&DDRB); }
+    };
+
+#endif // _SPI_HW_H_
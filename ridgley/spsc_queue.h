@@ -0,0 +1,314 @@
+//======================================================================================
+/** \file spsc_queue.h
+ *    This file contains a ring buffer for passing data from one producer to one
+ *    consumer, such as from an interrupt service routine to a task, without turning
+ *    interrupts off. The queue in avr_queue.h keeps a count of items which both put()
+ *    and get() change; when one of them is interrupted by the other partway through
+ *    that change, the count comes out wrong and data is lost or repeated. Here the
+ *    producer only ever writes the put index and the consumer only ever writes the get
+ *    index, so neither can spoil the other's work.
+ *
+ *  Usage:
+ *    \code
+ *    spsc_queue<unsigned char, 64> rx_queue;
+ *    ...
+ *    rx_queue.put (UDR0);                  // In the interrupt service routine
+ *    ...
+ *    unsigned char ch;
+ *    if (rx_queue.get (ch))                // In a task
+ *        ...
+ *    \endcode
+ *    Only the producer may call put(), put_many(), put_span() and commit_put(); only
+ *    the consumer may call get(), peek(), get_many(), get_span(), commit_get() and
+ *    flush(). Either side may ask how full the queue is, knowing that the other side
+ *    may change the answer at any moment.
+ *
+ *  How it works:
+ *    The indices are single bytes, which the AVR reads and writes in one instruction.
+ *    They count up freely and are masked to find places in the buffer, so the number
+ *    of items in the queue is always their difference and a full queue can be told
+ *    from an empty one without a separate count. The size must be a power of two no
+ *    bigger than 128 so that the difference fits. A compiler barrier makes sure data
+ *    is in the buffer before the index which hands it over is written.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _SPSC_QUEUE_H_                      // To prevent spsc_queue.h from being
+#define _SPSC_QUEUE_H_                      // included in a source file more than once
+
+/** This macro keeps the compiler from moving memory reads and writes across it. It
+ *  produces no instructions; the AVR itself does everything in program order.
+ */
+#define SPSC_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+
+//--------------------------------------------------------------------------------------
+/** This class implements the single producer, single consumer ring buffer. The type of
+ *  item and the size are template parameters, so the buffer is allocated statically:
+ *    \li qType: The type of data which will be stored in the queue
+ *    \li qSize: The number of items the queue holds: 2, 4, 8, 16, 32, 64 or 128
+ */
+
+template <class qType, unsigned char qSize>
+class spsc_queue
+    {
+    protected:
+        qType buffer[qSize];                ///< This memory buffer holds the contents
+        volatile unsigned char i_put;       ///< Count of items put in; producer's
+        volatile unsigned char i_get;       ///< Count of items taken out; consumer's
+
+        /// This type can't be declared unless the size is a power of two up to 128
+        typedef char size_check[((qSize & (qSize - 1)) == 0 && qSize <= 128) ? 1 : -1];
+
+    public:
+        /** This constructor creates an empty queue. */
+        spsc_queue (void) { i_put = 0; i_get = 0; }
+
+        /** This method returns the number of items in the queue.
+         *  @return The number of items which have been put in and not taken out
+         */
+        unsigned char num_items (void) const
+            { return ((unsigned char)(i_put - i_get)); }
+
+        /** This method returns the number of items which can be put into the queue.
+         *  @return The number of empty places in the buffer
+         */
+        unsigned char num_free (void) const { return (qSize - num_items ()); }
+
+        /** This method checks if the queue is empty.
+         *  @return True if there's nothing in the queue
+         */
+        bool is_empty (void) const { return (i_put == i_get); }
+
+        /** This method checks if the queue is full.
+         *  @return True if nothing more can be put into the queue
+         */
+        bool is_full (void) const { return (num_items () >= qSize); }
+
+        bool put (const qType&);            // Put one item in, if there's room
+        unsigned char put_many (const qType*, unsigned char);   // Put in several items
+        unsigned char put_span (qType*&);   // Find room to write items in place
+        void commit_put (unsigned char);    // Hand over items written in place
+
+        bool get (qType&);                  // Take one item out, if there is one
+        bool peek (qType&);                 // Look at the oldest item, leaving it in
+        unsigned char get_many (qType*, unsigned char); // Take out several items
+        unsigned char get_span (const qType*&); // Find items to read in place
+        void commit_get (unsigned char);    // Let go of items read in place
+        void flush (void);                  // Throw away everything in the queue
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This method puts one item into the queue. It's called only by the producer.
+ *  @param item The item to be put into the queue
+ *  @return True if the item was put in, false if the queue was full
+ */
+
+template <class qType, unsigned char qSize>
+bool spsc_queue<qType, qSize>::put (const qType& item)
+    {
+    unsigned char index = i_put;            // Only the producer changes this
+
+    if ((unsigned char)(index - i_get) >= qSize)
+        return (false);
+
+    buffer[index & (qSize - 1)] = item;
+    SPSC_BARRIER ();
+    i_put = index + 1;
+
+    return (true);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method puts as many of the given items into the queue as will fit, handing
+ *  them over to the consumer all at once. It's called only by the producer.
+ *  @param p_items A pointer to the items to be put into the queue
+ *  @param count The number of items
+ *  @return The number of items which were put in, fewer than count if it got full
+ */
+
+template <class qType, unsigned char qSize>
+unsigned char spsc_queue<qType, qSize>::put_many (const qType* p_items,
+                                                  unsigned char count)
+    {
+    unsigned char index = i_put;            // Only the producer changes this
+    unsigned char room = qSize - (unsigned char)(index - i_get);
+
+    if (count > room)
+        count = room;
+
+    for (unsigned char done = 0; done < count; done++)
+        buffer[(unsigned char)(index + done) & (qSize - 1)] = *p_items++;
+    SPSC_BARRIER ();
+    i_put = index + count;
+
+    return (count);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method finds the longest stretch of empty places which follow each other in
+ *  the buffer, so that the producer can write items straight into the queue, for
+ *  example from a DMA-style block transfer, and then hand them over with commit_put().
+ *  Because the buffer is a ring, the stretch may be shorter than the free space; what
+ *  remains can be had by calling this method again after committing.
+ *  @param p_span A reference to a pointer which is set to the first empty place
+ *  @return The number of places which may be written, zero if the queue is full
+ */
+
+template <class qType, unsigned char qSize>
+unsigned char spsc_queue<qType, qSize>::put_span (qType*& p_span)
+    {
+    unsigned char index = i_put;            // Only the producer changes this
+    unsigned char room = qSize - (unsigned char)(index - i_get);
+    unsigned char to_end = qSize - (index & (qSize - 1));
+
+    p_span = buffer + (index & (qSize - 1));
+    return (room < to_end ? room : to_end);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method hands over items which the producer wrote in place after calling
+ *  put_span().
+ *  @param count The number of items written, no more than put_span() allowed
+ */
+
+template <class qType, unsigned char qSize>
+void spsc_queue<qType, qSize>::commit_put (unsigned char count)
+    {
+    SPSC_BARRIER ();
+    i_put = i_put + count;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method takes the oldest item out of the queue. It's called only by the
+ *  consumer.
+ *  @param item A reference to a variable into which the item is copied
+ *  @return True if an item was taken, false if the queue was empty
+ */
+
+template <class qType, unsigned char qSize>
+bool spsc_queue<qType, qSize>::get (qType& item)
+    {
+    unsigned char index = i_get;            // Only the consumer changes this
+
+    if (index == i_put)
+        return (false);
+
+    SPSC_BARRIER ();
+    item = buffer[index & (qSize - 1)];
+    SPSC_BARRIER ();
+    i_get = index + 1;
+
+    return (true);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method copies the oldest item in the queue without taking it out. It's called
+ *  only by the consumer.
+ *  @param item A reference to a variable into which the item is copied
+ *  @return True if there was an item, false if the queue was empty
+ */
+
+template <class qType, unsigned char qSize>
+bool spsc_queue<qType, qSize>::peek (qType& item)
+    {
+    unsigned char index = i_get;            // Only the consumer changes this
+
+    if (index == i_put)
+        return (false);
+
+    SPSC_BARRIER ();
+    item = buffer[index & (qSize - 1)];
+
+    return (true);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method takes up to the given number of items out of the queue, oldest first.
+ *  It's called only by the consumer.
+ *  @param p_items A pointer to the place where the items are to be copied
+ *  @param count The largest number of items to take
+ *  @return The number of items which were taken, fewer than count if it got empty
+ */
+
+template <class qType, unsigned char qSize>
+unsigned char spsc_queue<qType, qSize>::get_many (qType* p_items, unsigned char count)
+    {
+    unsigned char index = i_get;            // Only the consumer changes this
+    unsigned char held = (unsigned char)(i_put - index);
+
+    if (count > held)
+        count = held;
+
+    SPSC_BARRIER ();
+    for (unsigned char done = 0; done < count; done++)
+        *p_items++ = buffer[(unsigned char)(index + done) & (qSize - 1)];
+    SPSC_BARRIER ();
+    i_get = index + count;
+
+    return (count);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method finds the longest stretch of items which follow each other in the
+ *  buffer, oldest first, so that the consumer can read them in place, for example to
+ *  send them out in one block, and then let them go with commit_get(). As with
+ *  put_span(), the stretch may stop at the end of the buffer before the items do.
+ *  @param p_span A reference to a pointer which is set to the oldest item
+ *  @return The number of items which may be read, zero if the queue is empty
+ */
+
+template <class qType, unsigned char qSize>
+unsigned char spsc_queue<qType, qSize>::get_span (const qType*& p_span)
+    {
+    unsigned char index = i_get;            // Only the consumer changes this
+    unsigned char held = (unsigned char)(i_put - index);
+    unsigned char to_end = qSize - (index & (qSize - 1));
+
+    SPSC_BARRIER ();
+    p_span = buffer + (index & (qSize - 1));
+    return (held < to_end ? held : to_end);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method lets go of items which the consumer read in place after calling
+ *  get_span(), making room for the producer.
+ *  @param count The number of items read, no more than get_span() allowed
+ */
+
+template <class qType, unsigned char qSize>
+void spsc_queue<qType, qSize>::commit_get (unsigned char count)
+    {
+    SPSC_BARRIER ();
+    i_get = i_get + count;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method throws away everything in the queue. It's called only by the consumer;
+ *  anything the producer puts in while it runs may or may not be thrown away too.
+ */
+
+template <class qType, unsigned char qSize>
+void spsc_queue<qType, qSize>::flush (void)
+    {
+    i_get = i_put;
+    }
+
+#endif // _SPSC_QUEUE_H_
@@ -0,0 +1,150 @@
+//======================================================================================
+/** \file stl_co_task.h
+ *    This file contains macros which let a task's run() method be written as one
+ *    sequence of steps, in the style of protothreads, instead of as a switch statement
+ *    on state numbers with flags to remember what has already been done. The sequence
+ *    can wait for a condition, for events, or for a time delay, and the next time the
+ *    task runs it goes on exactly where it left off without looking again at any of
+ *    the conditions which came before.
+ *
+ *  Usage:
+ *    The task class is derived from stl_co_task, and its run() method looks like this:
+ *    \code
+ *    char my_task::run (char state)
+ *        {
+ *        STL_CO_BEGIN (state);
+ *        for (;;)
+ *            {
+ *            STL_CO_WAIT_UNTIL (p_motor->position_stable ());
+ *            p_solenoid->take_picture ();
+ *            STL_CO_WAIT_EVENT (EV_SEND_DONE);
+ *            STL_CO_DELAY (settle_time);
+ *            }
+ *        STL_CO_END ();
+ *        }
+ *    \endcode
+ *    Conditions are checked each time the task runs, which is once per interval or
+ *    whenever an event is posted to it. A delay makes the next run happen that long
+ *    after this one; the task then goes back to running once per interval.
+ *
+ *  How it works:
+ *    The place where the sequence is waiting is saved as the task's state, so a
+ *    coroutine task takes no more memory than any other task. Each waiting place is
+ *    numbered from the compiler's __COUNTER__ and the numbers are case labels in a
+ *    switch around the whole sequence, so run() jumps straight back to where it was.
+ *    State transitions, and so traces, show the sequence moving from place to place.
+ *
+ *  Rules:
+ *    \li Local variables don't keep their values from one run to the next, so
+ *        anything which must be remembered while waiting belongs in the task object.
+ *    \li Local variables which are initialized where they're declared can't be in
+ *        the same block as a wait which comes after them, because the jump back to
+ *        the wait would skip over the initialization; the compiler will say so.
+ *    \li The macros can't be used inside another switch statement.
+ *    \li There can be at most 254 waits in one run() method.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _STL_CO_TASK_H_                     // To prevent stl_co_task.h from being
+#define _STL_CO_TASK_H_                     // included in a source file more than once
+
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "stl_debug.h"                      // Definitions for debugging serial port
+#include "stl_task.h"                       // The state transition logic header
+
+
+//--------------------------------------------------------------------------------------
+/** This class is the base for tasks whose run() methods are written as coroutines
+ *  with the STL_CO_ macros. It adds no data to stl_task.
+ */
+
+class stl_co_task : public stl_task
+    {
+    protected:
+        /** This method is used by the macros to go to a waiting place. It returns the
+         *  place as the next state, or no transition if the task is already there, so
+         *  a task which keeps waiting in one place isn't traced over and over.
+         *  @param state The state in which run() was called
+         *  @param place The number of the place at which the task is to wait
+         *  @return The state to which the task will go
+         */
+        static char co_wait_at (char state, char place)
+            {
+            return (state == place ? STL_NO_TRANSITION : place);
+            }
+
+    public:
+        /** The constructor just passes its parameters on to stl_task's.
+         *  @param time_interval The time between runs, which is how often conditions
+         *      being waited for are checked
+         *  @param debug_port A pointer to a serial port for debugging, if used
+         */
+        stl_co_task (const time_stamp& time_interval, STL_DEBUG_TYPE* debug_port = NULL)
+            : stl_task (time_interval, debug_port)
+            {
+            }
+    };
+
+
+/** This macro starts the body of a coroutine task's run() method.
+ *  @param state The state parameter of run()
+ */
+#define STL_CO_BEGIN(state) \
+    char stl_co_state = (state); \
+    enum { stl_co_base = __COUNTER__ }; \
+    switch (stl_co_state) { case 0:
+
+/** This macro ends the body of a coroutine task's run() method. If the sequence gets
+ *  this far, it starts over from the beginning the next time the task runs.
+ */
+#define STL_CO_END() \
+    } return (co_wait_at (stl_co_state, 0))
+
+/** This macro lets the task give up the processor until its next run. */
+#define STL_CO_YIELD() STL_CO_YIELD_AT (__COUNTER__ - stl_co_base)
+
+/** This macro waits until a condition is true. If it's already true, the task goes
+ *  right on without giving up the processor.
+ *  @param condition An expression which is checked each time the task runs
+ */
+#define STL_CO_WAIT_UNTIL(condition) \
+    STL_CO_WAIT_UNTIL_AT (__COUNTER__ - stl_co_base, condition)
+
+/** This macro waits until one of the given events has been posted to the task. The
+ *  events which were waited for are taken; any others are left to be taken later.
+ *  @param mask A byte with a bit set for each event which ends the wait
+ */
+#define STL_CO_WAIT_EVENT(mask) STL_CO_WAIT_UNTIL (take_events (mask))
+
+/** This macro waits for a time delay, counted from the time at which the current run
+ *  was scheduled. Runs caused by events during the delay don't end it.
+ *  @param delay A time stamp holding the length of the delay
+ */
+#define STL_CO_DELAY(delay) STL_CO_DELAY_AT (__COUNTER__ - stl_co_base, delay)
+
+/** This macro makes the sequence start over from the beginning the next time the task
+ *  runs.
+ */
+#define STL_CO_RESTART() return (co_wait_at (stl_co_state, 0))
+
+// These macros do the work of those above, given the number of a waiting place; the
+// number has to be worked out once and then used twice, so they're separate
+#define STL_CO_YIELD_AT(place) \
+    do { return (co_wait_at (stl_co_state, place)); case (place): ; } while (0)
+
+#define STL_CO_WAIT_UNTIL_AT(place, condition) \
+    do { case (place): if (!(condition)) return (co_wait_at (stl_co_state, place)); \
+    } while (0)
+
+#define STL_CO_DELAY_AT(place, delay) \
+    do { run_after (delay); return (co_wait_at (stl_co_state, place)); \
+        case (place): if (woken_by_event ()) return (STL_NO_TRANSITION); } while (0)
+
+#endif // _STL_CO_TASK_H_
@@ -0,0 +1,162 @@
+//======================================================================================
+/** \file stl_log.cc
+ *    This file contains the binary log ring and the task which prints its contents.
+ *    See stl_log.h for a description of how they're used.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#include <stdlib.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "stl_debug.h"                      // Definitions for debugging serial port
+#include "stl_task.h"                       // The state transition logic header
+#include "stl_log.h"                        // Header for this file
+
+
+// Nothing here takes up any memory unless logging has been turned on
+#ifdef STL_LOG_RING
+
+/// This is the one log ring which everything writes into
+stl_log_ring g_log_ring;
+
+
+//--------------------------------------------------------------------------------------
+/** This constructor creates an empty log ring with no timer.
+ */
+
+stl_log_ring::stl_log_ring (void)
+    {
+    i_put = 0;
+    i_get = 0;
+    num_lost = 0;
+    p_timer = NULL;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method takes the oldest record out of the log ring.
+ *  @param a_record A reference to a record into which the oldest record is copied
+ *  @return True if a record was taken, false if the ring was empty
+ */
+
+bool stl_log_ring::get (stl_log_record& a_record)
+    {
+    unsigned char sreg = SREG;              // Saved status register
+    bool found = false;                     // Whether there was a record to take
+
+    cli ();
+    if (i_get != i_put)
+        {
+        a_record = records[i_get++ & (STL_LOG_RING_SIZE - 1)];
+        found = true;
+        }
+    SREG = sreg;
+
+    return (found);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method returns the number of records which were written over before they could
+ *  be taken out, then sets that number back to zero.
+ *  @return The number of records lost since this method was last called
+ */
+
+unsigned char stl_log_ring::take_lost (void)
+    {
+    unsigned char sreg = SREG;              // Saved status register
+    unsigned char lost;                     // Copy of the count
+
+    cli ();
+    lost = num_lost;
+    num_lost = 0;
+    SREG = sreg;
+
+    return (lost);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This constructor creates a log drain task and gives the log ring the timer from
+ *  which records get their times.
+ *  @param time_interval The time between runs of the task, which should be long
+ *  @param a_timer A pointer to the task timer
+ *  @param a_port A pointer to the serial port to which records are printed
+ */
+
+stl_log_drain::stl_log_drain (const time_stamp& time_interval, task_timer* a_timer,
+                              base_text_serial* a_port)
+    : stl_task (time_interval)
+    {
+    p_port = a_port;
+    g_log_ring.set_timer (a_timer);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method prints a number in hexadecimal with a fixed number of digits, leading
+ *  zeros included, so that the lines in the dump are easy to pick out.
+ *  @param number The number to be printed
+ *  @param digits How many hexadecimal digits to print
+ */
+
+void stl_log_drain::put_hex (unsigned long number, unsigned char digits)
+    {
+    unsigned char nibble;                   // One hexadecimal digit's worth of bits
+
+    while (digits-- > 0)
+        {
+        nibble = (number >> (digits << 2)) & 0x0F;
+        p_port->putchar (nibble < 10 ? '0' + nibble : 'A' - 10 + nibble);
+        }
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method prints any lost record count and up to STL_LOG_DRAIN_COUNT records
+ *  from the log ring. The drain task has only one state.
+ *  @param state The state of the task when this run method begins running
+ *  @return STL_NO_TRANSITION, as this task never changes state
+ */
+
+char stl_log_drain::run (char state)
+    {
+    stl_log_record record;                  // A record taken from the log ring
+    unsigned char lost;                     // Number of records which were lost
+
+    if ((lost = g_log_ring.take_lost ()) != 0)
+        {
+        p_port->puts (F ("LL "));
+        put_hex (lost, 2);
+        p_port->puts (F ("\r\n"));
+        }
+
+    for (unsigned char count = 0; count < STL_LOG_DRAIN_COUNT; count++)
+        {
+        if (!g_log_ring.get (record))
+            break;
+
+        p_port->puts (F ("LG "));
+        put_hex (record.time, 8);
+        p_port->putchar (' ');
+        put_hex (record.id, 2);
+        for (unsigned char arg = 0; arg < record.num_args; arg++)
+            {
+            p_port->putchar (' ');
+            put_hex ((uint16_t)record.args[arg], 4);
+            }
+        p_port->puts (F ("\r\n"));
+        }
+
+    return (STL_NO_TRANSITION);
+    }
+
+#endif // STL_LOG_RING
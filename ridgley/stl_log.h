@@ -0,0 +1,201 @@
+//======================================================================================
+/** \file stl_log.h
+ *    This file contains a binary log which is kept in a ring buffer in RAM. Formatting
+ *    numbers into text and sending it through a serial port takes a long time, and 
+ *    doing it where something interesting happens holds up whatever else needs to be
+ *    done there. Here a log call saves only a message ID, the time and up to three
+ *    numbers, which takes a few microseconds, and a low priority task prints the 
+ *    records later as lines of hex. The host program log_decoder.rb turns them back 
+ *    into text with the formats listed in log_formats.h.
+ *
+ *  Usage:
+ *    Define STL_LOG_RING in the Makefile's DEBUG_CODES, create a stl_log_drain task
+ *    with the task timer and a serial port, and add it to the scheduler. Add a line
+ *    for each message to log_formats.h, then log it with the macro for its number of
+ *    arguments:
+ *    \code
+ *    STL_BLOG2 (LOG_RAD_COORDS, x, y);
+ *    \endcode
+ *    Each line the drain task prints has the form "LG tttttttt ii aaaa bbbb cccc",
+ *    where tttttttt is the time at which the record was made, ii the message ID and
+ *    aaaa through cccc as many arguments as were logged, all in hexadecimal. If the 
+ *    ring fills up before it's drained, the oldest records are lost and a line "LL nn"
+ *    tells how many. Without STL_LOG_RING, the macros produce no code at all. The
+ *    table log_decoder.rb needs is made with 'make logtable'. 
+ *
+ *  How it works:
+ *    Records are fixed in size, so saving one is a few stores; each argument is kept
+ *    as a 16-bit integer. The log may be written from interrupt service routines, so
+ *    interrupts are turned off for the moment it takes to put a record in or take
+ *    one out. 
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _STL_LOG_H_                         // To prevent stl_log.h from being
+#define _STL_LOG_H_                         // included in a source file more than once
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "base_text_serial.h"               // Serial port for printing the records
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "stl_debug.h"                      // Definitions for debugging serial port
+#include "stl_task.h"                       // The state transition logic header
+
+
+/** This is the number of records in the log ring. It must be a power of two no bigger
+ *  than 128; each record takes 12 bytes of RAM.
+ */
+#define STL_LOG_RING_SIZE       16
+
+/** This is the largest number of records the drain task prints each time it runs. */
+#define STL_LOG_DRAIN_COUNT     2
+
+/// This is the largest number of arguments a log record can hold
+#define STL_LOG_MAX_ARGS        3
+
+
+/** This enumeration holds the IDs of the messages listed in log_formats.h, numbered
+ *  in the order in which they're listed there.
+ */
+#define STL_LOG_FORMAT(id, format) id,
+enum stl_log_id
+    {
+    #include "log_formats.h"
+    STL_LOG_NUM_FORMATS                     ///< The number of messages in the list
+    };
+#undef STL_LOG_FORMAT
+
+
+//--------------------------------------------------------------------------------------
+/** This structure holds one log record.
+ */
+
+struct stl_log_record
+    {
+    long time;                              ///< Time at which the record was made
+    unsigned char id;                       ///< Which message this is
+    unsigned char num_args;                 ///< How many of the arguments are used
+    int16_t args[STL_LOG_MAX_ARGS];         ///< The message's numbers
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This class implements the ring buffer which holds log records. The indices run
+ *  freely and are masked when used, so the difference between them is always the
+ *  number of records held.
+ */
+
+class stl_log_ring
+    {
+    protected:
+        stl_log_record records[STL_LOG_RING_SIZE];  // The saved records
+        unsigned char i_put;                // Count of records which have been put in
+        unsigned char i_get;                // Count of records which have been taken
+        unsigned char num_lost;             // Records overwritten before being taken
+        task_timer* p_timer;                // Timer which gives records their times
+
+    public:
+        stl_log_ring (void);
+
+        /** This method sets the timer from which records get their times. Until it's
+         *  set, every record's time is zero.
+         *  @param a_timer A pointer to the task timer
+         */
+        void set_timer (task_timer* a_timer) { p_timer = a_timer; }
+
+        /** This method saves one record in the ring. If the ring is full, the oldest
+         *  record is written over and counted as lost. It's called by the STL_BLOG
+         *  macros, which fill in the arguments which aren't used with zeros.
+         *  @param id The ID of the message, from log_formats.h
+         *  @param num_args The number of arguments which are used
+         *  @param arg0 The first argument
+         *  @param arg1 The second argument
+         *  @param arg2 The third argument
+         */
+        inline void put (unsigned char id, unsigned char num_args, int16_t arg0,
+                         int16_t arg1, int16_t arg2)
+            {
+            time_stamp now;                 // The time at which the record is made
+            long counts = 0;                // The same time as a number
+            stl_log_record* p_rec;          // Pointer to the record being written
+            unsigned char sreg;             // Saved status register
+
+            if (p_timer != NULL)
+                {
+                p_timer->save_time_stamp (now);
+                now.get_time (counts);
+                }
+
+            sreg = SREG;
+            cli ();
+            p_rec = records + (i_put & (STL_LOG_RING_SIZE - 1));
+            p_rec->time = counts;
+            p_rec->id = id;
+            p_rec->num_args = num_args;
+            p_rec->args[0] = arg0;
+            p_rec->args[1] = arg1;
+            p_rec->args[2] = arg2;
+            if ((unsigned char)(++i_put - i_get) > STL_LOG_RING_SIZE)
+                {
+                i_get++;
+                if (num_lost != 0xFF)
+                    num_lost++;
+                }
+            SREG = sreg;
+            }
+
+        bool get (stl_log_record&);         // Take the oldest record out of the ring
+        unsigned char take_lost (void);     // Get and clear the count of lost records
+    };
+
+
+/// This is the one log ring which everything writes into
+extern stl_log_ring g_log_ring;
+
+
+/** These macros save a record in the log ring if logging has been turned on by 
+ *  defining STL_LOG_RING, and do nothing otherwise. The number in each macro's name is
+ *  the number of arguments it logs.
+ */
+#ifdef STL_LOG_RING
+    #define STL_BLOG0(id)             g_log_ring.put ((id), 0, 0, 0, 0)
+    #define STL_BLOG1(id, a)          g_log_ring.put ((id), 1, (a), 0, 0)
+    #define STL_BLOG2(id, a, b)       g_log_ring.put ((id), 2, (a), (b), 0)
+    #define STL_BLOG3(id, a, b, c)    g_log_ring.put ((id), 3, (a), (b), (c))
+#else
+    #define STL_BLOG0(id)
+    #define STL_BLOG1(id, a)
+    #define STL_BLOG2(id, a, b)
+    #define STL_BLOG3(id, a, b, c)
+#endif
+
+
+//--------------------------------------------------------------------------------------
+/** This class is a task which prints the records in the log ring to a serial port. It
+ *  should be given a long interval so that it only runs when other tasks aren't busy,
+ *  and it prints only a few records each time it runs.
+ */
+
+class stl_log_drain : public stl_task
+    {
+    protected:
+        base_text_serial* p_port;           // Serial port to which records are printed
+
+        void put_hex (unsigned long, unsigned char);    // Print a fixed width number
+
+    public:
+        // The constructor saves the port and gives the log ring the timer
+        stl_log_drain (const time_stamp&, task_timer*, base_text_serial*);
+
+        char run (char);                    // Print some of the records
+    };
+
+#endif // _STL_LOG_H_
@@ -0,0 +1,90 @@
+//======================================================================================
+/** \file stl_log_level.h
+ *    This file contains macros for text messages which are filtered by module and by
+ *    level when the program is compiled. Messages which are filtered out produce no
+ *    code, and their strings aren't kept in the program, so a module can be quieted
+ *    for a production build without taking its messages out of the source. Each module
+ *    has its own threshold, set in the Makefile, and a message is printed only if its
+ *    level is at or below its module's threshold.
+ *
+ *  Usage:
+ *    Each module has a name such as MOTOR, with a default threshold in log_levels.h.
+ *    A message is written with the module's name, the message's level and a serial
+ *    port, either as a string or as anything which can be written with <<:
+ *    \code
+ *    STL_LOG_PUTS (MOTOR, DEBUG, ptr_serial, F ("Going back\r\n"));
+ *    STL_LOG_WRITE (SENSOR, INFO, ptr_serial, F ("Reading: ") << reading << endl);
+ *    \endcode
+ *    The levels are ERROR, WARN, INFO and DEBUG. Thresholds are set in the Makefile's
+ *    LOG_LEVELS, for example -DSTL_LOG_LEVEL_MOTOR=STL_LOG_WARN for one module or
+ *    -DSTL_LOG_LEVEL_DEFAULT=STL_LOG_ERROR for all the modules which aren't given
+ *    their own; STL_LOG_NONE turns a module's messages off altogether.
+ *
+ *  How it works:
+ *    The module's name and the level are pasted into the names of two constants which
+ *    are compared in an if statement. The comparison is settled by the compiler, which
+ *    throws away a message which can't be printed along with its string. A module
+ *    name which has no threshold in log_levels.h is a compile error.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _STL_LOG_LEVEL_H_                   // To prevent stl_log_level.h from being
+#define _STL_LOG_LEVEL_H_                   // included in a source file more than once
+
+#include "base_text_serial.h"               // Serial port to which messages are written
+
+
+// These are the levels of messages, from most to least important
+#define STL_LOG_NONE            0           ///< As a threshold, no messages at all
+#define STL_LOG_ERROR           1           ///< Something has gone wrong
+#define STL_LOG_WARN            2           ///< Something may go wrong
+#define STL_LOG_INFO            3           ///< What the program is doing
+#define STL_LOG_DEBUG           4           ///< Details for finding problems
+
+/** This is the threshold for modules which aren't given one of their own. Everything
+ *  is printed unless the Makefile says otherwise.
+ */
+#ifndef STL_LOG_LEVEL_DEFAULT
+    #define STL_LOG_LEVEL_DEFAULT   STL_LOG_DEBUG
+#endif
+
+// Each module's threshold, which defaults to the one above
+#include "log_levels.h"
+
+
+/** This macro is true if messages of the given level from the given module are to be
+ *  printed. It's a constant, so it may be used in an if statement around code which
+ *  only prepares something for a message.
+ *  @param module The module's name, such as MOTOR
+ *  @param level The message's level: ERROR, WARN, INFO or DEBUG
+ */
+#define STL_LOG_ON(module, level) \
+    (STL_LOG_LEVEL_ ## module >= STL_LOG_ ## level)
+
+/** This macro writes a string to a serial port if its module and level let it.
+ *  @param module The module's name, such as MOTOR
+ *  @param level The message's level: ERROR, WARN, INFO or DEBUG
+ *  @param port A pointer to the serial port
+ *  @param text The string to be written, usually kept in program memory with F()
+ */
+#define STL_LOG_PUTS(module, level, port, text) \
+    do { if (STL_LOG_ON (module, level)) (port)->puts (text); } while (0)
+
+/** This macro writes things to a serial port with the << operator if its module and
+ *  level let it.
+ *  @param module The module's name, such as MOTOR
+ *  @param level The message's level: ERROR, WARN, INFO or DEBUG
+ *  @param port A pointer to the serial port
+ *  @param stuff What's to be written, with << between the items
+ */
+#define STL_LOG_WRITE(module, level, port, stuff) \
+    do { if (STL_LOG_ON (module, level)) *(port) << stuff; } while (0)
+
+#endif // _STL_LOG_LEVEL_H_
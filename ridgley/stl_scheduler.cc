@@ -0,0 +1,281 @@
+//======================================================================================
+/** \file stl_scheduler.cc
+ *    This file contains a scheduler class which runs a set of STL tasks in order of
+ *    their deadlines.
+ *
+ *  Usage
+ *    The programmer creates one scheduler object, gives it a pointer to the task
+ *    timer, and registers each task with add_task(). The main loop then just calls
+ *    dispatch() over and over. Each call reads the time once and runs the task at the
+ *    top of the heap if its next run time has come (or if it has asked to be run again
+ *    as soon as possible). After the task has run, its new next run time is pushed
+ *    back down into the heap. Finding the next task costs O(1) and re-sorting after a
+ *    run costs O(log n), so adding tasks doesn't slow down every pass of the loop.
+ *    Tasks which have had events posted to them, or have asked to run again as soon as
+ *    possible, are marked in a small bit mask; dispatch() checks that mask first and
+ *    runs such a task right away, so event driven tasks can have long timeouts and 
+ *    aren't called at all until something happens.
+ *    When dispatch() finds nothing to do, the main loop should call idle(), which
+ *    puts the processor to sleep until the earliest deadline or any interrupt.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file, replacing the round robin loop in main()
+ *    \li  10-16-26  Added idle() to sleep until the next deadline
+ *    \li  10-16-26  Added printing and clearing of all tasks' profiles
+ *    \li  10-16-26  Tasks with posted events are run ahead of the heap order
+ *    \li  10-16-26  A task whose run time moved sooner is moved up the heap
+ *    \li  10-16-26  First run times are counted from when tasks are added
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#include <stdlib.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include "stl_debug.h"                      // Definitions for debugging serial port
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "stl_task.h"                       // The state transition logic header
+#include "stl_scheduler.h"                  // Header for this file
+
+
+//--------------------------------------------------------------------------------------
+/** This constructor creates an empty scheduler. Tasks must be added with add_task()
+ *  before the scheduler will do anything useful.
+ *  @param a_timer A pointer to the task timer which is used to measure real time
+ */
+
+stl_scheduler::stl_scheduler (task_timer* a_timer)
+    {
+    p_timer = a_timer;
+    num_tasks = 0;
+
+    #ifdef STL_PROFILING
+        // All the tasks measure their run times with the scheduler's timer
+        stl_task::set_profile_timer (a_timer);
+    #endif
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method adds a task to the scheduler. The task's first run time, which it was
+ *  constructed with as a time after startup, is made relative to the current time, and
+ *  the task is placed into the heap at the position given by that time. Tasks should
+ *  all be added before the main loop begins to run.
+ *  @param p_task A pointer to the task which is to be run by this scheduler
+ *  @return True if the task was added, false if the scheduler was already full
+ */
+
+bool stl_scheduler::add_task (stl_task* p_task)
+    {
+    if (num_tasks >= STL_MAX_TASKS)
+        return (false);
+
+    // A task's first run time is counted from the time it's added, so that a task
+    // added after the 32-bit time has gone more than halfway around doesn't look as
+    // if its first run time is far in the future
+    p_task->set_next_run_time (p_timer->get_time_now () + p_task->get_next_run_time ());
+
+    heap[num_tasks] = p_task;
+    sift_up (num_tasks++);
+
+    return (true);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method is called by the main loop to run whichever task is due. The current
+ *  time is read only once per call. If any task has had events posted to it or has 
+ *  asked to run again right away, the first such task is found and run; otherwise 
+ *  only the task at the top of the heap is looked at. If that task is suspended, its
+ *  turn is put off by one interval so that it doesn't keep the tasks behind it from 
+ *  running; it will be looked at again then to see if it has been resumed.
+ *  @return True if a task's run() method was executed, false if nothing was due
+ */
+
+bool stl_scheduler::dispatch (void)
+    {
+    stl_task* p_task;                       // The task which is to be run
+    unsigned char index = 0;                // Where that task is in the heap
+    unsigned char ready;                    // Tasks which have events posted
+    bool ran;                               // Whether that task actually ran
+
+    if (num_tasks == 0)
+        return (false);
+
+    time_stamp& now = p_timer->get_time_now ();
+
+    // Look for a task which has been made ready by an event; this search only happens
+    // when there is one, so tasks waiting for their run times don't pay for it
+    if ((ready = stl_task::get_ready_mask ()) != 0)
+        {
+        for (index = 0; index < num_tasks; index++)
+            if (ready & heap[index]->get_ready_bit ())
+                break;
+        if (index >= num_tasks)
+            index = 0;
+        }
+
+    p_task = heap[index];
+
+    // If the task isn't due yet and hasn't been made ready, no task in the heap is 
+    // due, so there's nothing to do this time
+    if (!((ready & p_task->get_ready_bit ()) || p_task->ready () 
+            || now >= p_task->get_next_run_time ()))
+        return (false);
+
+    ran = p_task->schedule (now);
+
+    // A suspended task doesn't move its own next run time, so move it here
+    if (p_task->get_op_state () == TASK_SUSPENDED)
+        p_task->set_next_run_time (now + p_task->get_interval ());
+
+    // The task's next run time has usually moved later, so it moves down; a task run
+    // early by an event may have set a timeout or delay which is sooner than its old
+    // run time, though, and then it moves up
+    sift_down (index);
+    sift_up (index);
+
+    return (ran);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method puts the processor into idle sleep until the task at the top of the
+ *  heap is due, unless a task has been made ready by an event. A Timer 1 compare 
+ *  interrupt is armed for that time; any other interrupt, such as an encoder edge or 
+ *  the radio, also wakes the processor, after which the main loop calls dispatch() 
+ *  again to see if anything needs to run. Idle mode leaves the timers, USARTs and 
+ *  external interrupts running. Interrupts are turned off while deciding whether to 
+ *  sleep; since the instruction after sei() always runs before any pending interrupt,
+ *  the processor can't miss a wakeup which happens between the decision and the sleep
+ *  instruction. 
+ */
+
+void stl_scheduler::idle (void)
+    {
+    if (num_tasks == 0)
+        return;
+
+    cli ();
+
+    // Don't sleep if a task wants to run right away or its deadline is too close
+    if (stl_task::get_ready_mask () || heap[0]->ready () 
+            || !p_timer->set_alarm (heap[0]->get_next_run_time ()))
+        {
+        sei ();
+        return;
+        }
+
+    set_sleep_mode (SLEEP_MODE_IDLE);
+    sleep_enable ();
+    sei ();
+    sleep_cpu ();
+    sleep_disable ();
+    }
+
+
+#ifdef STL_PROFILING
+//--------------------------------------------------------------------------------------
+/** This method prints the execution profile of every task run by this scheduler. The
+ *  printing takes a long time compared to most tasks' run times, so it should only be
+ *  done when the system isn't doing anything important. 
+ *  @param a_port A pointer to a serial port object on which the data is printed
+ */
+
+void stl_scheduler::print_profiles (base_text_serial* a_port)
+    {
+    for (unsigned char index = 0; index < num_tasks; index++)
+        heap[index]->STL_PRINT_PROFILE (a_port);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method clears the execution profiles of all the tasks, so that profiling can 
+ *  be started again from scratch. 
+ */
+
+void stl_scheduler::clear_profiles (void)
+    {
+    for (unsigned char index = 0; index < num_tasks; index++)
+        heap[index]->STL_CLEAR_PROF_DATA ();
+    }
+
+#endif  // STL_PROFILING
+
+
+//--------------------------------------------------------------------------------------
+/** This method checks if the task in one heap slot needs to run before the task in
+ *  another. The comparison is done with the time stamp's overflow-safe comparison, so
+ *  it works correctly when the timer wraps around.
+ *  @param first The index of one task in the heap
+ *  @param second The index of another task in the heap
+ *  @return True if the first task's next run time is earlier than the second's
+ */
+
+bool stl_scheduler::earlier (unsigned char first, unsigned char second)
+    {
+    // Time stamps' >= operator is true when the left hand time is strictly later
+    return (heap[second]->get_next_run_time () >= heap[first]->get_next_run_time ());
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method exchanges the tasks in two slots of the heap.
+ *  @param first The index of one task in the heap
+ *  @param second The index of the other task in the heap
+ */
+
+void stl_scheduler::swap (unsigned char first, unsigned char second)
+    {
+    stl_task* p_temp = heap[first];
+    heap[first] = heap[second];
+    heap[second] = p_temp;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method moves a task up the heap until its parent is due no later than it is.
+ *  It's used when a task is added at the bottom of the heap.
+ *  @param index The index of the task which may need to move up
+ */
+
+void stl_scheduler::sift_up (unsigned char index)
+    {
+    unsigned char parent;                   // Index of the slot above this one
+
+    while (index > 0)
+        {
+        parent = (index - 1) >> 1;
+        if (!earlier (index, parent))
+            break;
+        swap (index, parent);
+        index = parent;
+        }
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method moves a task down the heap until both of its children are due no
+ *  earlier than it is. It's used after the task at the top has run and its next run
+ *  time has moved later.
+ *  @param index The index of the task which may need to move down
+ */
+
+void stl_scheduler::sift_down (unsigned char index)
+    {
+    unsigned char child;                    // Index of the earlier of two children
+
+    while ((child = (index << 1) + 1) < num_tasks)
+        {
+        if (child + 1 < num_tasks && earlier (child + 1, child))
+            child++;
+        if (!earlier (child, index))
+            break;
+        swap (index, child);
+        index = child;
+        }
+    }
@@ -0,0 +1,80 @@
+//======================================================================================
+/** \file stl_scheduler.h
+ *    This file contains a scheduler class which runs a set of STL tasks in order of
+ *    their deadlines. The tasks are kept in a binary min-heap which is sorted by each
+ *    task's next run time, so the scheduler only has to look at the task at the top
+ *    of the heap to find out if anything needs to run.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file, replacing the round robin loop in main()
+ *    \li  10-16-26  Added idle() to sleep until the next deadline
+ *    \li  10-16-26  Added printing and clearing of all tasks' profiles
+ *    \li  10-16-26  Tasks with posted events are run ahead of the heap order
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _STL_SCHEDULER_H_                   // To prevent stl_scheduler.h from being
+#define _STL_SCHEDULER_H_                   // included in a source file more than once
+
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "stl_debug.h"                      // Definitions for debugging serial port
+#include "stl_task.h"                       // The state transition logic header
+
+
+/** This is the largest number of tasks which can be registered with one scheduler.
+ *  Each slot costs one pointer of RAM, so it shouldn't be made much bigger than needed
+ */
+#define STL_MAX_TASKS       8
+
+
+//--------------------------------------------------------------------------------------
+/** This class implements a deadline ordered cooperative scheduler. Tasks are added to
+ *  the scheduler once at startup; after that, each call to dispatch() reads the task
+ *  timer exactly once and runs at most one task -- the one whose next run time is the
+ *  earliest -- if that task is due. Tasks which aren't due aren't called at all, so
+ *  the time taken by one pass through the main loop doesn't grow with the number of
+ *  tasks in the system.
+ */
+
+class stl_scheduler
+    {
+    protected:
+        task_timer* p_timer;                // Timer used to find the current time
+        stl_task* heap[STL_MAX_TASKS];      // Tasks, sorted as a min-heap by run time
+        unsigned char num_tasks;            // Number of tasks in the heap
+
+        bool earlier (unsigned char, unsigned char);    // Compare two heap entries
+        void swap (unsigned char, unsigned char);       // Exchange two heap entries
+        void sift_up (unsigned char);       // Move an entry up to where it belongs
+        void sift_down (unsigned char);     // Move an entry down to where it belongs
+
+    public:
+        // The constructor saves a pointer to the timer which measures real time
+        stl_scheduler (task_timer*);
+
+        // This method registers a task so that the scheduler will run it
+        bool add_task (stl_task*);
+
+        // This method runs the task whose deadline is earliest, if it's due
+        bool dispatch (void);
+
+        // This method sleeps until the earliest deadline or until an interrupt
+        void idle (void);
+
+    #ifdef STL_PROFILING
+        // These methods print or clear the execution profiles of all the tasks
+        void print_profiles (base_text_serial*);
+        void clear_profiles (void);
+    #endif
+
+        /** This method returns the number of tasks which have been registered.
+         *  @return The number of tasks being run by this scheduler
+         */
+        unsigned char get_num_tasks (void) { return (num_tasks); }
+    };
+
+#endif // _STL_SCHEDULER_H_
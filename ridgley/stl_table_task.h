@@ -0,0 +1,230 @@
+//======================================================================================
+/** \file stl_table_task.h
+ *    This file contains a template which lets a task's state machine be written as a
+ *    table of state methods kept in program memory instead of as a switch statement
+ *    in the run() method. Each row of the table holds an optional guard method and
+ *    the action method for one state; run() reads the row for the current state from
+ *    flash and calls it, so dispatching takes the same time for every state.
+ *
+ *  Usage:
+ *    The task class is derived from stl_table_task<task_class>. Its states are
+ *    declared as a public enumeration which ends with NUM_STATES, and each state gets
+ *    a method which returns a stl_next_state. The table is a static member of the task so that
+ *    it can refer to protected methods; it's declared without a size and defined in
+ *    the task's source file with PROGMEM, before the task's constructor:
+ *    \code
+ *    const stl_state_row<my_task> my_task::state_table[] PROGMEM =
+ *        {
+ *            { NULL, &my_task::state_idle },     // IDLE
+ *            { NULL, &my_task::state_send },     // SEND
+ *        };
+ *    \endcode
+ *    The table's size is taken from its rows, and a table with a row missing or left
+ *    over doesn't compile, rather than leaving a state with no action to be found when
+ *    the task runs.
+ *    Every transition a task may make is declared once with STL_ALLOW_TRANSITION(),
+ *    and the state methods return transition<FROM, TO>() or stay(). A transition
+ *    which hasn't been declared doesn't compile. Only those two methods can make a
+ *    stl_next_state, so a state method can't return a bare state number such as
+ *    SEND, and one which forgets to say where to go is caught by the compiler's 
+ *    missing return warning. The compiler can't tell which state's method is 
+ *    returning a transition, though; with STL_TABLE_CHECK defined in the Makefile's
+ *    DEBUG_CODES, run() checks that FROM is the state the task was in and stops the
+ *    task with an error if it isn't.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *    \li  10-16-26  The table is sized by its rows and checked against NUM_STATES
+ *    \li  10-16-26  State methods return stl_next_state, which only transition() and
+ *                   stay() can make; STL_TABLE_CHECK checks each transition's FROM
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _STL_TABLE_TASK_H_                  // To prevent stl_table_task.h from being
+#define _STL_TABLE_TASK_H_                  // included in a source file more than once
+
+#include <string.h>                         // For memcpy_P()
+#include <avr/pgmspace.h>                   // For storing the state table in flash
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "stl_debug.h"                      // Definitions for debugging serial port
+#include "stl_task.h"                       // The state transition logic header
+
+
+/** This is the largest number of states in a table driven task. It's limited so that
+ *  a task's serial number and state fit together in one byte of a state ID.
+ */
+#define STL_MAX_TABLE_STATES    16
+
+
+template <class task_type> class stl_table_task;
+
+
+//--------------------------------------------------------------------------------------
+/** This class holds what a state method returns: the state to go to next, and the
+ *  state which the method named as the one it's leaving. Its constructor can only be
+ *  used by stl_table_task, whose transition() and stay() methods are the only ways for
+ *  a state method to make one.
+ */
+
+class stl_next_state
+    {
+    template <class task_type> friend class stl_table_task;
+
+    protected:
+        char from;                          ///< FROM state, or STL_NO_TRANSITION
+        char to;                            ///< Next state, or STL_NO_TRANSITION
+
+        /** This constructor saves the two states.
+         *  @param from_state The state being left, or STL_NO_TRANSITION for stay()
+         *  @param to_state The state to go to, or STL_NO_TRANSITION to stay
+         */
+        stl_next_state (char from_state, char to_state)
+            {
+            from = from_state;
+            to = to_state;
+            }
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This structure holds one row of a state table. The guard, if there is one, is
+ *  called first; if it returns false, the action isn't run and the task stays in the
+ *  same state. The action does the work of the state and returns the next state.
+ */
+
+template <class task_type>
+struct stl_state_row
+    {
+    bool (task_type::*guard) (void);        ///< Condition to run the action, or NULL
+    stl_next_state (task_type::*action) (void);  ///< Method which does the state's work
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This template is specialized once for each transition which a task is allowed to
+ *  make, using the STL_ALLOW_TRANSITION() macro. The general template is declared but
+ *  never defined, so using a transition which hasn't been allowed fails to compile.
+ */
+
+template <class task_type, char from_state, char to_state>
+struct stl_transition_allowed;
+
+
+/** This macro declares that a task may go from one state to another. It must be used
+ *  at file scope, after the task class and its states have been declared.
+ */
+#define STL_ALLOW_TRANSITION(task, from, to) \
+    template <> struct stl_transition_allowed<task, task::from, task::to> \
+        { enum { next_state = task::to }; }
+
+
+/** This template is used to check a condition at compile time. The general template
+ *  isn't defined, so a false condition gives an error at the line which checks it.
+ */
+template <bool condition> struct stl_compile_check;
+template <> struct stl_compile_check<true> { enum { ok = 1 }; };
+
+
+//--------------------------------------------------------------------------------------
+/** This class is the base for tasks whose state machines are written as tables. It's
+ *  a template whose parameter is the task class itself, so the state methods can be
+ *  called directly without any virtual functions beyond the run() method which every
+ *  task has.
+ */
+
+template <class task_type>
+class stl_table_task : public stl_task
+    {
+    protected:
+        const stl_state_row<task_type>* p_table;    // The state table, in flash
+        unsigned char num_states;                   // Number of rows in the table
+
+        /** This method is returned by a state method to go to another state. The
+         *  transition must have been allowed with STL_ALLOW_TRANSITION().
+         *  @return The state to which the task will go
+         */
+        template <char from_state, char to_state>
+        static stl_next_state transition (void)
+            {
+            return (stl_next_state (from_state,
+                stl_transition_allowed<task_type, from_state, to_state>::next_state));
+            }
+
+        /** This method is returned by a state method to stay in the same state.
+         *  @return The code which means that no transition is to be made
+         */
+        static stl_next_state stay (void)
+            { return (stl_next_state (STL_NO_TRANSITION, STL_NO_TRANSITION)); }
+
+    public:
+        /** The constructor saves the state table. The table's size is found by the
+         *  compiler, which checks that there's one row for each of the task's
+         *  NUM_STATES states and that there aren't too many states to fit in a state
+         *  ID.
+         *  @param time_interval The time between runs of the task's run() method
+         *  @param table The state table, which must be stored in program memory
+         *  @param debug_port A pointer to a serial port for debugging, if used
+         */
+        template <unsigned int table_size>
+        stl_table_task (const time_stamp& time_interval,
+                        const stl_state_row<task_type> (&table)[table_size],
+                        STL_DEBUG_TYPE* debug_port = NULL)
+            : stl_task (time_interval, debug_port)
+            {
+            (void)stl_compile_check<(table_size == task_type::NUM_STATES)>::ok;
+            (void)stl_compile_check<(table_size <= STL_MAX_TABLE_STATES)>::ok;
+            p_table = table;
+            num_states = table_size;
+            }
+
+        char run (char);
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This method runs the current state's row of the table. The row is copied out of
+ *  program memory, its guard is checked, and its action is called. A state number
+ *  which is outside the table means that something has gone badly wrong, so the
+ *  task is stopped; so, with STL_TABLE_CHECK, does a transition whose FROM state
+ *  isn't the one the task was in.
+ *  @param state The state of the task when this run method begins running
+ *  @return The state to which the task will transition, or STL_NO_TRANSITION if no
+ *      transition is called for at this time
+ */
+
+template <class task_type>
+char stl_table_task<task_type>::run (char state)
+    {
+    stl_state_row<task_type> row;           // Copy of the table row for this state
+    stl_next_state next (STL_NO_TRANSITION, STL_NO_TRANSITION);     // Action's result
+    task_type* p_self = static_cast<task_type*> (this);
+
+    if ((unsigned char)state >= num_states)
+        {
+        error_stop (F ("State not in table"));
+        return (STL_NO_TRANSITION);
+        }
+
+    memcpy_P (&row, &p_table[(unsigned char)state], sizeof (row));
+
+    if (row.guard != NULL && !(p_self->*row.guard) ())
+        return (STL_NO_TRANSITION);
+
+    next = (p_self->*row.action) ();
+
+    #ifdef STL_TABLE_CHECK
+        if (next.from != STL_NO_TRANSITION && next.from != state)
+            {
+            error_stop (F ("Transition from the wrong state"));
+            return (STL_NO_TRANSITION);
+            }
+    #endif
+
+    return (next.to);
+    }
+
+#endif // _STL_TABLE_TASK_H_
@@ -24,16 +24,27 @@
  *        turned off for production code, as serial port writing takes up time
  *        (and of course requires a serial port to be present and connected). 
  *    \li Execution time profiling can be enabled by defining STL_PROFILING.  This
- *        option causes the execution times of the state functions to be measured
- *        and a simple set of performance data to be kept. Performance data can be
- *        written to a serial port at a convenient time, generally after the system
- *        has been run in test for a while. 
- *        (NOTE: This is a future enhancement, not currently usable)
+ *        option causes the execution time of each task's run() method, and how late
+ *        it started compared to its next run time, to be measured with the task 
+ *        timer given to set_profile_timer(). Each task keeps the minimum, maximum,
+ *        and mean of both and a histogram with logarithmically sized bins. The data
+ *        can be written to a serial port at a convenient time, generally after the
+ *        system has been run in test for a while. 
+ *    \li State transitions can be saved in a ring buffer in RAM by defining 
+ *        STL_TRACE_RING. This takes far less time than tracing through a serial port,
+ *        so it doesn't change the timing of the program much. See stl_trace.h.
  * 
  *  Revisions
  *    \li  04-21-07  JRR  Original of this file, derived from UCB's TranRun4 and
  *                        simplified greatly for efficient use in AVR processors
  *    \li  05-07-07  JRR  Small bug fixes
+ *    \li  10-16-26       Execution time profiling implemented
+ *    \li  10-16-26       Added deadline miss accounting and catch-up policies
+ *    \li  10-16-26       Added events which tasks and ISRs can post to a task
+ *    \li  10-16-26       Transitions can be saved in a RAM trace ring
+ *    \li  10-16-26       Intervals too long to compare are caught
+ *    \li  10-16-26       Error messages are written after interrupts are turned off
+ *    \li  10-16-26       Messages are kept in program memory rather than SRAM
  *
  *  License:
  *    This file released under the Lesser GNU Public License, version 2. This program
@@ -47,6 +58,7 @@
 #include "stl_debug.h"                      // Definitions for debugging serial port
 #include "stl_us_timer.h"                   // Timer measures real time
 #include "stl_task.h"                       // The state transition logic header
+#include "stl_trace.h"                      // Transition trace ring in RAM
 
 
 //--------------------------------------------------------------------------------------
@@ -54,6 +66,11 @@
 // the header file for more information on the item(s)
 
 char stl_task::serial_counter = 0;
+volatile unsigned char stl_task::ready_mask = 0;
+
+#ifdef STL_PROFILING
+task_timer* stl_task::p_prof_timer = NULL;
+#endif
 
 
 //--------------------------------------------------------------------------------------
@@ -70,17 +87,15 @@ char stl_task::serial_counter = 0;
 
 stl_task::stl_task (const time_stamp& time_interval, STL_DEBUG_TYPE* debug_port)
     {
-    // Save the time interval between runs of this task
-    interval = time_interval;
-
     // Save a pointer to the debug port object
     dbg_port = debug_port;
 
     // Give this task its serial number, then increment the serial number counter
     serial_number = serial_counter++;
-    STL_DEBUG_PUTS ("Creating task ");
+    ready_bit = 1 << (serial_number & 0x07);
+    STL_DEBUG_PUTS (F ("Creating task "));
     STL_DEBUG_WRITE (serial_number);
-    STL_DEBUG_PUTS ("\r\n");
+    STL_DEBUG_PUTS (F ("\r\n"));
 
     // This task begins life in its waiting to run operational state
     op_state = TASK_WAITING;
@@ -89,9 +104,21 @@ stl_task::stl_task (const time_stamp& time_interval, STL_DEBUG_TYPE* debug_port)
     // The task begins running in state 0, with no transitions unless called for
     current_state = 0;
 
+    // Save the time interval between runs of this task
+    set_interval (time_interval);
+
+    // No events have been posted yet
+    events = 0;
+    event_run = false;
+    next_time_rule = NEXT_ADVANCE;
+
     // The first time at which to run the task is as soon as reasonable
     next_run_time.set_time (0);
 
+    // Late tasks run as many times as needed to catch up unless told otherwise
+    catchup_policy = STL_CATCHUP_BURST;
+    clear_deadline_stats ();
+
     #ifdef STL_PROFILING
         // Clear the profile data arrays
         clear_prof_data_method ();
@@ -100,13 +127,23 @@ stl_task::stl_task (const time_stamp& time_interval, STL_DEBUG_TYPE* debug_port)
 
 
 //--------------------------------------------------------------------------------------
-/** This method sets or changes the time interval between runs of this task. 
+/** This method sets or changes the time interval between runs of this task. Intervals
+ *  of 35 minutes or more can't be used; a task which needs to wait longer can run more
+ *  often and check the time with task_timer::save_long_time(). 
  *  @param time_interval The time between runs of the task's run() method
  */
 
 void stl_task::set_interval (const time_stamp& time_interval)
     {
+    long period;                            // The interval in timer counts
+
     interval = time_interval;
+
+    // Run times which are more than half of the 32-bit time's range apart, about 35
+    // minutes, can't be compared, so a task with a longer interval would stop running
+    interval.get_time (period);
+    if (period < 0)
+        error_stop (F ("Interval too long"));
     }
 
 
@@ -127,26 +164,36 @@ void stl_task::set_next_run_time (const time_stamp& next_time)
 
 //--------------------------------------------------------------------------------------
 /** This method is called by the main task loop to try to run the task. If the task is
- *  in the waiting state, it checks to see if it's time to run yet; if it's in the
- *  suspended state, it doesn't. The task shouldn't be in the running state, because
- *  this method is used by the cooperative scheduler, not the pre-emptive one.
+ *  in the waiting state, it checks to see if it's time to run yet or if any events
+ *  have been posted to it; if it's in the suspended state, it doesn't. The task 
+ *  shouldn't be in the running state, because this method is used by the cooperative
+ *  scheduler, not the pre-emptive one. The next run time only moves ahead after runs 
+ *  which were due by the time, so events don't delay a task's timeout. 
  *  @return True if the task's run() function was executed, false if it was not
  */
 
 bool stl_task::schedule (time_stamp& the_time)
     {
     char next_state;                        // State to which a task will transition
+    long lateness;                          // How late the task is being run
+    unsigned char sreg;                     // Saved status register and interrupt bit
 
     switch (op_state)
         {
-        // If the task has been suspended, don't bother trying to run it
+        // If the task has been suspended, don't bother trying to run it; its events
+        // will make it ready again when it's resumed
         case (TASK_SUSPENDED):
+            sreg = SREG;
+            cli ();
+            ready_mask &= ~ready_bit;
+            SREG = sreg;
             return (false);
 
         // If the task needs to run, check if it needs to run now; if so, run it
         case (TASK_WAITING):
-            // If it's not time to run the task yet, exit without running it
-            if (!(the_time >= next_run_time))
+            // If it's not time to run the task yet and nothing has been posted to it,
+            // exit without running it
+            if (!(the_time >= next_run_time) && !(ready_mask & ready_bit))
                 return (false);
 
             // If we get here, it is time to run the task; just continue into the
@@ -155,9 +202,43 @@ bool stl_task::schedule (time_stamp& the_time)
         case (TASK_PENDING):
             // Set the state to waiting for the next time interval. If the task needs
             // to run again immediately, run_again_ASAP() will be called within the
-            // run() method, causing the state to be set to TASK_PENDING instead
+            // run() method, causing the state to be set to TASK_PENDING instead. The
+            // ready bit is cleared first so that events posted while run() is running
+            // will make the task run again
+            sreg = SREG;
+            cli ();
             op_state = TASK_WAITING;
-            next_state = run (current_state);       // Call the run() method
+            ready_mask &= ~ready_bit;
+            SREG = sreg;
+
+            // Find how late the task is; a task run early by an event or by 
+            // run_again_ASAP() isn't late at all
+            event_run = !(the_time >= next_run_time);
+            (the_time - next_run_time).get_time (lateness);
+            if (lateness < 0)
+                lateness = 0;
+            if (lateness > worst_lateness)
+                worst_lateness = lateness;
+
+            #ifdef STL_PROFILING
+                if (p_prof_timer)
+                    {
+                    time_stamp start_time;          // Time when run() is called
+                    time_stamp end_time;            // Time when run() returns
+                    long duration;                  // How long run() took to run
+
+                    p_prof_timer->save_time_stamp (start_time);
+                    next_state = run (current_state);
+                    p_prof_timer->save_time_stamp (end_time);
+                    (end_time - start_time).get_time (duration);
+                    record_profile (duration, lateness);
+                    }
+                else
+                    next_state = run (current_state);
+            #else
+                next_state = run (current_state);   // Call the run() method
+            #endif
+
             if (next_state != STL_NO_TRANSITION)    // Detect state transition if any
                 {                                   // has occurred
                 STL_TRACE_PUTCHAR ('T');
@@ -166,19 +247,30 @@ bool stl_task::schedule (time_stamp& the_time)
                 STL_TRACE_WRITE (current_state);
                 STL_TRACE_PUTCHAR ('-');
                 STL_TRACE_WRITE (next_state);
-                STL_TRACE_PUTS ("\r\n");
+                STL_TRACE_PUTS (F ("\r\n"));
+                STL_TRACE_RECORD (the_time, get_state_id (), next_state);
 
                 current_state = next_state;         // Go to next state next time
                 }
     
-            if (op_state == TASK_WAITING)           // Unless task needs to run again
-                next_run_time += interval;          // right away, set next run time
+            // Unless the task needs to run again right away or ran early because of
+            // an event, set the next time at which it's due. If the task has asked to
+            // restart its interval, it's due one interval from now instead, and if it
+            // has asked for a delay, which run_after() put in next_run_time, it's due
+            // that long from now
+            if (next_time_rule == NEXT_RESTART)
+                next_run_time = the_time + interval;
+            else if (next_time_rule == NEXT_DELAY)
+                next_run_time = the_time + next_run_time;
+            else if (op_state == TASK_WAITING && !event_run)
+                advance_next_run_time (the_time, lateness);
+            next_time_rule = NEXT_ADVANCE;
 
             return (true);                          // The task has run this time
 
         // If the operational state is anything else, there has been a serious error
         default:
-            error_stop ("Illegal operational state");
+            error_stop (F ("Illegal operational state"));
             break;
         };
 
@@ -188,6 +280,78 @@ bool stl_task::schedule (time_stamp& the_time)
     }
 
 
+//--------------------------------------------------------------------------------------
+/** This method sets the next run time after the task has run. If the run started less
+ *  than one interval late, the next run time is just one interval later than the last.
+ *  Otherwise one or more whole periods have been missed; they are counted, and the
+ *  next run time is found according to the task's catch-up policy:
+ *    \li STL_CATCHUP_BURST - The next run time is one interval later, so the task 
+ *        runs again right away, once for each missed period, until it has caught up
+ *    \li STL_CATCHUP_SKIP - The missed periods are skipped, and the task runs next at
+ *        the first time on its original schedule which hasn't passed yet
+ *    \li STL_CATCHUP_REPHASE - The task runs next one interval after the time at 
+ *        which this late run started, so its schedule is shifted to a new phase
+ *  The division needed to count missed periods is only done when a period has been
+ *  missed, which shouldn't happen often. 
+ *  @param the_time The time at which this run of the task was scheduled
+ *  @param lateness How late this run started compared to its next run time
+ */
+
+void stl_task::advance_next_run_time (time_stamp& the_time, long lateness)
+    {
+    long period;                            // Time between runs, in timer counts
+    long next_time;                         // Next run time, in timer counts
+    unsigned int missed;                    // Number of periods missed this time
+
+    interval.get_time (period);
+
+    // If no whole period was missed, just go on to the next run time
+    if (period <= 0 || lateness < period)
+        {
+        next_run_time += interval;
+        return;
+        }
+
+    switch (catchup_policy)
+        {
+        case (STL_CATCHUP_SKIP):
+            missed = lateness / period;
+            next_run_time.get_time (next_time);
+            next_run_time.set_time (next_time + period * (missed + 1));
+            break;
+
+        case (STL_CATCHUP_REPHASE):
+            missed = lateness / period;
+            next_run_time = the_time + interval;
+            break;
+
+        // Each run of a burst counts one missed period, so a burst which catches up
+        // after missing n periods counts n of them
+        default:
+            missed = 1;
+            next_run_time += interval;
+            break;
+        }
+
+    if (missed > 0xFFFF - missed_periods)
+        missed_periods = 0xFFFF;
+    else
+        missed_periods += missed;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method clears the count of missed periods and the worst lateness, so that 
+ *  deadline accounting can be started again from scratch. 
+ */
+
+void stl_task::clear_deadline_stats (void)
+    {
+    missed_periods = 0;
+    worst_lateness = 0;
+    }
+
+
 //--------------------------------------------------------------------------------------
 /** This is a base method which the user should overload in each descendent of this 
  *  task class. The run method is where all the user-defined action in the task takes
@@ -201,9 +365,9 @@ bool stl_task::schedule (time_stamp& the_time)
 
 char stl_task::run (char a_state)
     {
-    STL_DEBUG_PUTS ("Base run() method called for task ");
+    STL_DEBUG_PUTS (F ("Base run() method called for task "));
     STL_DEBUG_WRITE (serial_number);
-    STL_DEBUG_PUTS ("\r\n");
+    STL_DEBUG_PUTS (F ("\r\n"));
 
     return (STL_NO_TRANSITION);
     }
@@ -229,30 +393,80 @@ void stl_task::suspend (void)
 
 void stl_task::resume (void)
     {
+    unsigned char sreg = SREG;              // Saved status register
+
     op_state = save_op_state;
+
+    // If events were posted while the task was suspended, it's ready to run now
+    cli ();
+    if (events != 0 || op_state == TASK_PENDING)
+        ready_mask |= ready_bit;
+    SREG = sreg;
     }
 
 
 //--------------------------------------------------------------------------------------
-/** This method clears the profile data arrays. It's called once at startup, and it can
- *  be called later in order to restart the execution time profiling process. Usually
- *  the user should not call this method but instead use the STL_CLEAR_PROF_DATA macro, 
- *  which causes this method to disappear if profiling is deactivated. 
+/** This method posts one or more events to the task. The events are bits in a byte
+ *  whose meanings are chosen by each task. The task is marked as ready, so the 
+ *  scheduler will run it as soon as it can rather than waiting for its next run time,
+ *  and the task's run() method gets the events by calling take_events(). Events which
+ *  are posted more than once before they're taken are only seen once. This method
+ *  only turns interrupts off for a moment and restores them as they were, so it can be
+ *  called from tasks and from interrupt service routines. 
+ *  @param mask A byte with a bit set for each event to be posted
  */
 
-/*void stl_task::clear_prof_data_method (void)
+void stl_task::post_event (unsigned char mask)
     {
-    for (char count = 0; count < num_states; count++)
-        {
-        num_runs[count] = 0;
-        max_entry_runtime[count] = 0;
-        sum_entry_runtime[count] = 0;
-        max_run_runtime[count] = 0;
-        sum_run_runtime[count] = 0;
-        max_trans_runtime[count] = 0;
-        sum_trans_runtime[count] = 0;
-        }
-    }*/
+    unsigned char sreg = SREG;              // Saved status register
+
+    cli ();
+    events |= mask;
+    ready_mask |= ready_bit;
+    SREG = sreg;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method gets all the events which have been posted to the task and clears them,
+ *  so that each event is taken only once. It's usually called at the beginning of the
+ *  task's run() method. 
+ *  @return A byte with a bit set for each event which has been posted
+ */
+
+unsigned char stl_task::take_events (void)
+    {
+    unsigned char sreg = SREG;              // Saved status register
+    unsigned char taken;                    // The events which were posted
+
+    cli ();
+    taken = events;
+    events = 0;
+    SREG = sreg;
+
+    return (taken);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method gets and clears only the given events, leaving any others posted to 
+ *  the task to be taken later. Coroutine tasks use it to wait for particular events.
+ *  @param mask A byte with a bit set for each event to be taken
+ *  @return Those of the given events which had been posted
+ */
+
+unsigned char stl_task::take_events (unsigned char mask)
+    {
+    unsigned char sreg = SREG;              // Saved status register
+    unsigned char taken;                    // The events which were posted
+
+    cli ();
+    taken = events & mask;
+    events &= ~mask;
+    SREG = sreg;
+
+    return (taken);
+    }
 
 
 //--------------------------------------------------------------------------------------
@@ -275,35 +489,143 @@ void stl_task::set_initial_state (char init_state)
  *  use this function if there isn't a reasonable way to write an error state which 
  *  handles exceptions in a more useful manner, such as by turning motors and other
  *  possibly dangerous devices off and then halting. 
- *  @param message The text to be displayed before the processor stops working
+ *  @param message The text to be displayed before the processor stops working, kept
+ *      in program memory with F()
  */
 
-void stl_task::error_stop (char const* message)
+void stl_task::error_stop (const flash_string* message)
     {
-    STL_DEBUG_PUTS("ERROR in task ");
+    // With interrupts off, a buffered serial port sends the message before returning
+    cli ();                                 // Disable interrupts
+
+    STL_DEBUG_PUTS(F ("ERROR in task "));
     STL_DEBUG_WRITE (serial_number);
-    STL_DEBUG_PUTS (" state ");
+    STL_DEBUG_PUTS (F (" state "));
     STL_DEBUG_WRITE (current_state);
-    STL_DEBUG_PUTS (": ");
+    STL_DEBUG_PUTS (F (": "));
     STL_DEBUG_PUTS (message);
-    STL_DEBUG_PUTS ("\r\nProcessing stopped.\r\n");
+    STL_DEBUG_PUTS (F ("\r\nProcessing stopped.\r\n"));
 
-    cli ();                                 // Disable interrupts
     while (1);                              // Bang...you're dead (until reset)
     }
 
 
 #ifdef STL_PROFILING
+//--------------------------------------------------------------------------------------
+/** This method sets the task timer which all tasks use to measure how long their run()
+ *  methods take. The scheduler calls it when it's created; if no timer has been set,
+ *  no profiling data is collected. 
+ *  @param a_timer A pointer to the task timer
+ */
+
+void stl_task::set_profile_timer (task_timer* a_timer)
+    {
+    p_prof_timer = a_timer;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method clears the profile data. It's called once at startup, and it can be
+ *  called later in order to restart the execution time profiling process. Usually
+ *  the user should not call this method but instead use the STL_CLEAR_PROF_DATA macro, 
+ *  which causes this method to disappear if profiling is deactivated. 
+ */
+
+void stl_task::clear_prof_data_method (void)
+    {
+    num_runs = 0;
+    min_runtime = 0x7FFFFFFFL;
+    max_runtime = 0;
+    sum_runtime = 0;
+    min_lateness = 0x7FFFFFFFL;
+    max_lateness = 0;
+    sum_lateness = 0;
+    for (unsigned char count = 0; count < STL_PROF_BINS; count++)
+        {
+        runtime_hist[count] = 0;
+        lateness_hist[count] = 0;
+        }
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This function finds the histogram bin into which a time measurement falls. Bin 0
+ *  holds times under 16 microseconds and each bin after that holds times up to twice
+ *  as long as the one before; the last bin holds everything which is longer. Only
+ *  shifts are used, as division is slow on an AVR. 
+ *  @param time A time measurement in microseconds
+ *  @return The index of the bin for that time
+ */
+
+static unsigned char prof_bin (long time)
+    {
+    unsigned char bin = 0;                  // Index of the bin being checked
+
+    if (time < 0)
+        return (0);
+
+    for (time >>= 4; time != 0 && bin < STL_PROF_BINS - 1; time >>= 1)
+        bin++;
+
+    return (bin);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method adds the measurements from one run of the task to the profile data. 
+ *  Counters and histogram bins stop counting when they are full rather than wrapping
+ *  back to zero. 
+ *  @param duration How long the run() method took, in microseconds
+ *  @param lateness How long after its next run time the run() method was called
+ */
+
+void stl_task::record_profile (long duration, long lateness)
+    {
+    unsigned char bin;                      // Histogram bin for a measurement
+
+    num_runs++;
+
+    if (duration < min_runtime) min_runtime = duration;
+    if (duration > max_runtime) max_runtime = duration;
+    sum_runtime += duration;
+    bin = prof_bin (duration);
+    if (runtime_hist[bin] != 0xFFFF) runtime_hist[bin]++;
+
+    if (lateness < min_lateness) min_lateness = lateness;
+    if (lateness > max_lateness) max_lateness = lateness;
+    sum_lateness += lateness;
+    bin = prof_bin (lateness);
+    if (lateness_hist[bin] != 0xFFFF) lateness_hist[bin]++;
+    }
+
+
 //--------------------------------------------------------------------------------------
 /** This method prints the results of execution speed profiling to the given serial
  *  port. It's called by the STL_PRINT_PROFILE() macro, which does nothing unless
- *  execution profiling has been turned on by defining STL_PROFILING. 
- *  @param a_port A pointer to an object of class uart which controls a serial port
+ *  execution profiling has been turned on by defining STL_PROFILING. All times are 
+ *  printed in microseconds. The histogram counts are printed from the shortest bin
+ *  (under 16 us) to the longest. 
+ *  @param a_port A pointer to a serial port object on which the data is printed
  */
 
-void stl_task::print_profile_method (avr_uart* a_port)
+void stl_task::print_profile_method (base_text_serial* a_port)
     {
-    a_port->puts ("Execution profiling not yet enabled\r\n");
+    *a_port << F ("Task ") << (int)serial_number << F (": ") << num_runs << F (" runs") << endl;
+    if (num_runs == 0)
+        return;
+
+    *a_port << F ("  run  min ") << min_runtime << F (" mean ") 
+        << (long)(sum_runtime / num_runs) << F (" max ") << max_runtime << endl;
+    *a_port << F ("  late min ") << min_lateness << F (" mean ") 
+        << (long)(sum_lateness / num_runs) << F (" max ") << max_lateness << endl;
+
+    *a_port << F ("  run  hist");
+    for (unsigned char count = 0; count < STL_PROF_BINS; count++)
+        *a_port << ' ' << runtime_hist[count];
+    *a_port << endl << F ("  late hist");
+    for (unsigned char count = 0; count < STL_PROF_BINS; count++)
+        *a_port << ' ' << lateness_hist[count];
+    *a_port << endl;
     }
 
 #endif  // STL_PROFILING
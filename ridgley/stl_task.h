@@ -13,6 +13,11 @@
  *    \li  05-01-07  JRR  Original of this file, derived from UCB's TranRun4 and
  *                        simplified greatly for efficient use in AVR processors
  *    \li  05-07-07  JRR  Small bug fixes
+ *    \li  10-16-26       Added deadline miss accounting and catch-up policies
+ *    \li  10-16-26       Added events which tasks and ISRs can post to a task
+ *    \li  10-16-26       Added compact state IDs for tracing
+ *    \li  10-16-26       Added run_after() and taking only some events, for coroutines
+ *    \li  10-16-26       error_stop() takes its message from program memory
  *
  *  License:
  *    This file released under the Lesser GNU Public License, version 2. This program
@@ -23,6 +28,10 @@
 #ifndef _STL_TASK_H_                        // To prevent task.h from being included
 #define _STL_TASK_H_                        // in a source file more than once
 
+#include <avr/io.h>                         // For the status register, SREG
+#include <avr/interrupt.h>                  // For cli(), used to protect event bits
+#include "base_text_serial.h"               // For strings kept in program memory
+
 
 //--------------------------------------------------------------------------------------
 /** This define specifies a no-transition code which means that the next state will be
@@ -31,15 +40,30 @@
 
 const char STL_NO_TRANSITION = 0xFF;
 
-/** This macro activates the printing of profile data if profiling is turned on, and
- *  deactivates profiling entirely if it's turned off
+/** This macro packs a task's serial number and one of its states into one byte which
+ *  identifies that state of that task in traces. It works for up to 16 tasks with up
+ *  to 16 states each. 
+ */
+#define STL_STATE_ID(serial, state) \
+    ((unsigned char)(((serial) << 4) | ((state) & 0x0F)))
+
+/** These macros activate the printing and clearing of profile data if profiling is 
+ *  turned on, and deactivate profiling entirely if it's turned off
  */
 #ifdef STL_PROFILING
     #define STL_PRINT_PROFILE(x) print_profile_method(x) 
+    #define STL_CLEAR_PROF_DATA() clear_prof_data_method()
 #else
     #define STL_PRINT_PROFILE(x)
+    #define STL_CLEAR_PROF_DATA()
 #endif
 
+/** This is the number of bins in each task's histograms of run times and lateness. 
+ *  Bin 0 counts times under 16 us; each bin after that counts times up to twice as
+ *  long as the one before, and the last bin counts everything longer. 
+ */
+#define STL_PROF_BINS       12
+
 
 //--------------------------------------------------------------------------------------
 /** This enumeration lists the possible operational states of a task. These states are 
@@ -48,7 +72,7 @@ const char STL_NO_TRANSITION = 0xFF;
  *  according to priorities (if used) and which tasks are ready to be run. 
  */
 
-typedef enum task_op_state 
+enum task_op_state
     {
     TASK_RUNNING,           ///< The task's run() function is executing
     TASK_PENDING,           ///< The task needs to run again as soon as possible
@@ -58,6 +82,19 @@ typedef enum task_op_state
     };
 
 
+//--------------------------------------------------------------------------------------
+/** This enumeration lists the ways in which a task can catch up after it has run so
+ *  late that one or more of its periods have been missed entirely. 
+ */
+
+enum stl_catchup_policy
+    {
+    STL_CATCHUP_BURST,      ///< Run once for each missed period, as fast as possible
+    STL_CATCHUP_SKIP,       ///< Skip missed periods but keep the original run times
+    STL_CATCHUP_REPHASE     ///< Run next one interval after the late run's start time
+    };
+
+
 //--------------------------------------------------------------------------------------
 /** This class implements the behavior of a task in the context of a multitasking
  *  system. Each task runs "simultaneously" with other tasks. This means, of course,
@@ -75,11 +112,27 @@ class stl_task
         task_op_state save_op_state;        // For saving states of suspended tasks
         char serial_number;                 // Each task has a serial number
         char current_state;                 // State in which we're currently running
+        unsigned char ready_bit;            // This task's bit in the ready mask
+        volatile unsigned char events;      // Events posted to this task but not taken
+        bool event_run;                     // True if this run wasn't due by the time
+        unsigned char next_time_rule;       // How to find the next run time after run()
+
+        // These are the ways in which the next run time can be found after a run
+        enum { NEXT_ADVANCE, NEXT_RESTART, NEXT_DELAY };
+
+        // One bit for each task which has had events posted or asked to run ASAP
+        static volatile unsigned char ready_mask;
 
     protected:
         time_stamp next_run_time;           // Time when task should run next
         time_stamp interval;                // Time interval between runs of the task
         STL_DEBUG_TYPE* dbg_port;           // Port for serial debugging information
+        stl_catchup_policy catchup_policy;  // What to do after missing periods
+        unsigned int missed_periods;        // Number of periods which have been missed
+        long worst_lateness;                // Longest time between due time and a run
+
+        // This method finds the next run time after a run, counting missed periods
+        void advance_next_run_time (time_stamp&, long);
 
     public:
         // The constructor sets time interval between runs and debug port (if used)
@@ -96,12 +149,51 @@ class stl_task
         void suspend (void);                // Set operational state to suspended
         void resume (void);                 // Un-suspend a task so it can run again
         void set_initial_state (char);      // Set a new state in which to start up
+        void clear_deadline_stats (void);   // Zero missed periods and worst lateness
+
+        /** This method chooses how the task catches up after it has missed one or
+         *  more whole periods. The default is STL_CATCHUP_BURST. 
+         *  @param policy The catch-up policy to use from now on
+         */
+        void set_catchup_policy (stl_catchup_policy policy) 
+            { catchup_policy = policy; }
+
+        /** This method returns the number of periods in which the task has been unable
+         *  to run because it was running a whole interval or more late. The count
+         *  stops at 65535 rather than wrapping around. 
+         *  @return The number of missed periods since the count was last cleared
+         */
+        unsigned int get_missed_periods (void) { return (missed_periods); }
+
+        /** This method returns the longest time by which a run of the task has started
+         *  after the time it was due. 
+         *  @return The worst lateness in timer counts (microseconds)
+         */
+        long get_worst_lateness (void) { return (worst_lateness); }
 
         /** This method returns the task's automatically assigned serial number. 
          *  @return The task's serial number
          */
         char get_serial_number (void) { return (serial_number); }
 
+        /** This method returns a one byte ID for the state the task is in, made up of
+         *  the task's serial number and its state; see STL_STATE_ID(). 
+         *  @return The compact ID of the task's current state
+         */
+        unsigned char get_state_id (void) 
+            { return (STL_STATE_ID (serial_number, current_state)); }
+
+        /** This method returns the time at which the task is next due to run. It's
+         *  used by the scheduler to sort tasks in order of their deadlines.
+         *  @return A reference to the task's next run time
+         */
+        time_stamp& get_next_run_time (void) { return (next_run_time); }
+
+        /** This method returns the time interval between runs of the task.
+         *  @return A reference to the task's time interval
+         */
+        time_stamp& get_interval (void) { return (interval); }
+
         /** This method returns the task's current operational state. The operational
          *  state isn't the same as the state transition logic state; it's a separate
          *  variable which controls if the task is running at a given time. 
@@ -112,7 +204,14 @@ class stl_task
         /** This method will cause the task to run again as soon as it can instead of
          *  waiting for the given time interval. 
          */
-        inline void run_again_ASAP (void) { op_state = TASK_PENDING; }
+        inline void run_again_ASAP (void) 
+            { 
+            unsigned char sreg = SREG;
+            cli ();
+            op_state = TASK_PENDING; 
+            ready_mask |= ready_bit;
+            SREG = sreg;
+            }
         
         /** This method tells whether the task needs to run again as soon as possible
          *  or not. It is convenient to use when determining if the processor should
@@ -122,16 +221,73 @@ class stl_task
         inline bool ready (void) { return (op_state == TASK_PENDING 
             || op_state == TASK_RUNNING); }
 
-        void error_stop (char const*);      // Complain and stop the processor
+        void error_stop (const flash_string*);  // Complain and stop the processor
+
+        void post_event (unsigned char);    // Post events; this may be called by ISRs
+        unsigned char take_events (void);   // Get and clear all posted events
+        unsigned char take_events (unsigned char);  // Get and clear some events
+
+        /** This method tells whether the current run of the task was caused by an
+         *  event or run_again_ASAP() rather than the task's next run time arriving.
+         *  It's meant to be called from within run(). 
+         *  @return True if the task is running early because of an event
+         */
+        bool woken_by_event (void) { return (event_run); }
+
+        /** This method makes the task's next run time one interval after the time at
+         *  which the current run was scheduled, rather than one interval after the 
+         *  last run time. It's meant to be called from within run(), usually along
+         *  with set_interval(), when an event driven task starts or stops a timeout. 
+         */
+        void restart_interval (void) { next_time_rule = NEXT_RESTART; }
+
+        /** This method makes the task's next run time the given delay after the time
+         *  at which the current run was scheduled, for this run only; after that run
+         *  the task goes back to running once per interval. It's meant to be called
+         *  from within run(). The delay is kept in the next run time itself until
+         *  run() returns, so it takes no extra memory. 
+         *  @param delay The time from this run until the next one
+         */
+        void run_after (const time_stamp& delay)
+            { 
+            next_run_time = delay;
+            next_time_rule = NEXT_DELAY;
+            }
+
+        /** This method returns the task's bit in the mask of tasks which are ready to
+         *  run because they've had events posted or asked to be run again right away.
+         *  Tasks whose serial numbers are 8 apart share a bit. 
+         *  @return A byte with this task's bit set
+         */
+        unsigned char get_ready_bit (void) { return (ready_bit); }
+
+        /** This method returns the mask of tasks which have had events posted or have
+         *  asked to run again right away and haven't been run since. The scheduler 
+         *  uses this to find tasks which must run before their next run time. 
+         *  @return A byte with the bits of all the ready tasks set
+         */
+        static unsigned char get_ready_mask (void) { return (ready_mask); }
 
     #ifdef STL_PROFILING                    // Stuff for execution time profiling
     protected:
-        int *num_runs;                      // All these variables are for collecting
-        long *max_run_runtime;              // test functions take to run 
-        long *sum_run_runtime;
+        static task_timer* p_prof_timer;    // Timer used to measure run() durations
+        unsigned long num_runs;             // All these variables are for collecting
+        long min_runtime;                   // data about how long the run() function
+        long max_runtime;                   // takes to run and how late it runs 
+        unsigned long sum_runtime;          // compared to its scheduled time, in
+        long min_lateness;                  // microseconds
+        long max_lateness;
+        unsigned long sum_lateness;
+        unsigned int runtime_hist[STL_PROF_BINS];   // Histograms of run times and
+        unsigned int lateness_hist[STL_PROF_BINS];  // lateness, log2 sized bins
+
+        void record_profile (long, long);   // Add one run's data to the profile
     public:
-        void print_profile_method (avr_uart*);  // Display execution time profile data
-        void clear_prof_data_method (void);     // Clear profiling data arrays
+        // Set the timer which all tasks use to measure run() durations
+        static void set_profile_timer (task_timer*);
+
+        void print_profile_method (base_text_serial*);  // Display profile data
+        void clear_prof_data_method (void); // Clear profiling data arrays
     #endif  // STL_PROFILING
     };
 
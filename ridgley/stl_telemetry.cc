@@ -0,0 +1,190 @@
+//======================================================================================
+/** \file stl_telemetry.cc
+ *    This file contains the telemetry task, which sends sampled numbers to a PC as
+ *    COBS framed binary records. See stl_telemetry.h for how it's used.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#include <stdlib.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "crc16.h"                          // CRC which lets the PC check each frame
+#include "stl_telemetry.h"                  // Header for this file
+
+
+// Nothing here takes up any memory unless telemetry has been turned on
+#ifdef STL_TELEMETRY
+
+//--------------------------------------------------------------------------------------
+/** This constructor creates a telemetry task. No channels are sent until they're
+ *  chosen with set_decimation().
+ *  @param time_interval The time between runs of the task
+ *  @param a_timer A pointer to the task timer
+ *  @param a_port A pointer to the serial port to which frames are sent
+ */
+
+stl_telemetry::stl_telemetry (const time_stamp& time_interval, task_timer* a_timer,
+                              base_text_serial* a_port)
+    : stl_task (time_interval)
+    {
+    p_port = a_port;
+    p_timer = a_timer;
+    sequence = 0;
+
+    for (unsigned char channel = 0; channel < STL_TELEM_CHANNELS; channel++)
+        {
+        decimation[channel] = 0;
+        countdown[channel] = 0;
+        }
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method chooses how often a channel is sent. The channel is sent with the next
+ *  sample, then with every nth sample after that.
+ *  @param channel The channel's number, less than STL_TELEM_CHANNELS
+ *  @param every_nth The number of samples per value sent, or 0 to stop sending it
+ */
+
+void stl_telemetry::set_decimation (unsigned char channel, unsigned char every_nth)
+    {
+    unsigned char sreg;                     // Saved status register
+
+    if (channel >= STL_TELEM_CHANNELS)
+        return;
+
+    sreg = SREG;
+    cli ();
+    decimation[channel] = every_nth;
+    countdown[channel] = 1;
+    SREG = sreg;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method takes one sample of the channels. The channels which are due are saved
+ *  in a record with the time; if none are due, nothing is saved. If the queue is full,
+ *  the record is lost, but it still uses up a sequence number so that the PC can tell.
+ *  It may be called from an interrupt service routine, such as the control lane's; the
+ *  time is read with save_time_stamp(), which reads TCNT1 with interrupts off, so the
+ *  read here can't get between the two bytes of a read of Timer 1 made by a task.
+ *  @param values A pointer to the channels' values, in channel order
+ *  @param count The number of values, of which at most STL_TELEM_CHANNELS are used
+ */
+
+void stl_telemetry::sample (const int16_t* values, unsigned char count)
+    {
+    stl_telem_record record;                // The record being made
+    time_stamp now;                         // The time at which the sample is taken
+
+    if (count > STL_TELEM_CHANNELS)
+        count = STL_TELEM_CHANNELS;
+
+    record.mask = 0;
+    for (unsigned char channel = 0; channel < count; channel++)
+        {
+        if (decimation[channel] == 0 || --countdown[channel] != 0)
+            continue;
+
+        countdown[channel] = decimation[channel];
+        record.mask |= (1 << channel);
+        record.values[channel] = values[channel];
+        }
+    if (record.mask == 0)
+        return;
+
+    p_timer->save_time_stamp (now);
+    now.get_time (record.time);
+    record.sequence = sequence++;
+
+    queue.put (record);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method lays a record out as a frame, stuffs it with COBS and sends it with a
+ *  zero before and after. COBS replaces each zero in the frame with the distance to
+ *  the next one, and starts the frame with the distance to the first; a frame this
+ *  short never needs more than that one extra byte. The stuffed frame has no zeros in
+ *  it, so it can be sent with puts().
+ *  @param record The record to be sent
+ */
+
+void stl_telemetry::send (const stl_telem_record& record)
+    {
+    uint8_t frame[STL_TELEM_FRAME_SIZE];    // The frame before stuffing
+    char stuffed[STL_TELEM_FRAME_SIZE + 2]; // The frame after stuffing, and a '\0'
+    unsigned char length = 0;               // Number of bytes in the frame
+    unsigned char code_at = 0;              // Where the distance to the next zero goes
+    unsigned char code = 1;                 // That distance, so far
+    unsigned char out = 1;                  // Where the next stuffed byte goes
+    uint16_t crc;                           // CRC of the frame
+
+    frame[length++] = (uint8_t)record.sequence;
+    frame[length++] = (uint8_t)(record.sequence >> 8);
+    for (unsigned char shift = 0; shift < 32; shift += 8)
+        frame[length++] = (uint8_t)(record.time >> shift);
+    frame[length++] = record.mask;
+    for (unsigned char channel = 0; channel < STL_TELEM_CHANNELS; channel++)
+        if (record.mask & (1 << channel))
+            {
+            frame[length++] = (uint8_t)record.values[channel];
+            frame[length++] = (uint8_t)((uint16_t)record.values[channel] >> 8);
+            }
+    crc = crc16 (frame, length);
+    frame[length++] = (uint8_t)(crc >> 8);
+    frame[length++] = (uint8_t)crc;
+
+    for (unsigned char index = 0; index < length; index++)
+        {
+        if (frame[index] == 0)
+            {
+            stuffed[code_at] = code;
+            code_at = out++;
+            code = 1;
+            }
+        else
+            {
+            stuffed[out++] = frame[index];
+            code++;
+            }
+        }
+    stuffed[code_at] = code;
+    stuffed[out] = '\0';
+
+    p_port->putchar ('\0');
+    p_port->puts (stuffed);
+    p_port->putchar ('\0');
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method sends up to STL_TELEM_SEND_COUNT records from the queue. The telemetry
+ *  task has only one state.
+ *  @param state The state of the task when this run method begins running
+ *  @return STL_NO_TRANSITION, as this task never changes state
+ */
+
+char stl_telemetry::run (char state)
+    {
+    stl_telem_record record;                // A record taken from the queue
+
+    for (unsigned char count = 0; count < STL_TELEM_SEND_COUNT; count++)
+        {
+        if (!queue.get (record))
+            break;
+        send (record);
+        }
+
+    return (STL_NO_TRANSITION);
+    }
+
+#endif // STL_TELEMETRY
@@ -0,0 +1,117 @@
+//======================================================================================
+/** \file stl_telemetry.h
+ *    This file contains a binary telemetry stream, which sends numbers sampled in a
+ *    control loop to a PC fast enough to capture a step response. A text line with a
+ *    few numbers in it takes several milliseconds to format and send; here each sample
+ *    is saved as a fixed-layout record in a few microseconds, and a task sends the
+ *    records later as short binary frames. The host program telemetry_csv.rb turns a
+ *    capture of the stream into a CSV file for a spreadsheet.
+ *
+ *  Usage:
+ *    Define STL_TELEMETRY in the Makefile's DEBUG_CODES, create a stl_telemetry task
+ *    with the task timer and a serial port, and add it to the scheduler. Choose which
+ *    channels are sent, and how often, with set_decimation(); a channel with a
+ *    decimation of 4 is sent with every fourth sample, and one with a decimation of 0
+ *    isn't sent at all. The code being watched gives all its channels at once:
+ *    \code
+ *    int16_t values[3] = { position, error, setting };
+ *    p_telemetry->sample (values, 3);
+ *    \endcode
+ *    Only one place in the program may call sample(), which may be an interrupt
+ *    service routine. The serial port has to be fast enough for the records which are
+ *    chosen; if the queue fills up, records are lost, which shows as a gap in their
+ *    sequence numbers.
+ *
+ *  How it works:
+ *    sample() puts a record holding its sequence number, the time, a mask of the
+ *    channels which are due and their values into a spsc_queue, so neither side has
+ *    to turn interrupts off. The task takes records out and sends each one as a frame
+ *    framed with Consistent Overhead Byte Stuffing (COBS), which takes the zero bytes
+ *    out of the frame so that a zero can mark where each frame starts and ends. Before
+ *    stuffing, a frame holds the sequence number (2 bytes), the time in timer counts
+ *    (4 bytes) and the mask (1 byte), all least significant byte first, then 2 bytes
+ *    for each channel in the mask in channel order, and then a CRC-16 of everything
+ *    before it, most significant byte first. Text written to the same port between
+ *    frames spoils at most the frame after it, which the CRC catches.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _STL_TELEMETRY_H_                   // To prevent stl_telemetry.h from being
+#define _STL_TELEMETRY_H_                   // included in a source file more than once
+
+#include <stdint.h>
+#include "base_text_serial.h"               // Serial port for sending the frames
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "stl_debug.h"                      // Definitions for debugging serial port
+#include "stl_task.h"                       // The state transition logic header
+#include "spsc_queue.h"                     // Records go from sampler to task in this
+
+
+/** This is the largest number of channels a record can hold. It can't be more than 8,
+ *  since the mask of channels in a record is one byte.
+ */
+#define STL_TELEM_CHANNELS      8
+
+/** This is the number of records which can wait to be sent. It must be a power of two
+ *  no bigger than 128; each record takes 23 bytes of RAM.
+ */
+#define STL_TELEM_QUEUE_SIZE    8
+
+/** This is the largest number of records the task sends each time it runs. */
+#define STL_TELEM_SEND_COUNT    4
+
+/// This is the largest size of a frame before stuffing, with all channels and the CRC
+#define STL_TELEM_FRAME_SIZE    (7 + 2 * STL_TELEM_CHANNELS + 2)
+
+
+//--------------------------------------------------------------------------------------
+/** This structure holds one telemetry record while it waits to be sent.
+ */
+
+struct stl_telem_record
+    {
+    long time;                              ///< Time at which the sample was taken
+    uint16_t sequence;                      ///< Number of records made before this one
+    unsigned char mask;                     ///< A bit for each channel in the record
+    int16_t values[STL_TELEM_CHANNELS];     ///< The channels' values, by channel number
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This class is a task which sends telemetry records to a serial port as COBS frames.
+ *  It should run often enough to keep up with the records being made.
+ */
+
+class stl_telemetry : public stl_task
+    {
+    protected:
+        base_text_serial* p_port;           // Serial port to which frames are sent
+        task_timer* p_timer;                // Timer which gives records their times
+        spsc_queue<stl_telem_record, STL_TELEM_QUEUE_SIZE> queue;   // Records to send
+        unsigned char decimation[STL_TELEM_CHANNELS];   // Send every nth sample, 0 never
+        unsigned char countdown[STL_TELEM_CHANNELS];    // Samples until each is sent
+        uint16_t sequence;                  // Sequence number of the next record
+
+        void send (const stl_telem_record&);    // Send one record as a frame
+
+    public:
+        // The constructor saves the port and timer; no channels are sent at first
+        stl_telemetry (const time_stamp&, task_timer*, base_text_serial*);
+
+        // This method chooses how often a channel is sent
+        void set_decimation (unsigned char, unsigned char);
+
+        // This method saves the channels which are due from one sample
+        void sample (const int16_t*, unsigned char);
+
+        char run (char);                    // Send some of the records
+    };
+
+#endif // _STL_TELEMETRY_H_
@@ -0,0 +1,381 @@
+//======================================================================================
+/** \file stl_timer_wheel.cc
+ *    This file contains the timer wheel, which calls functions at given times from the
+ *    Timer 1 compare B interrupt. See stl_timer_wheel.h for how it's used.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *    \li  10-16-26  Noted why the compare interrupt may use Timer 1's 16-bit registers
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#include <stdlib.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "stl_timer_wheel.h"                // Header for this file
+
+
+/// This is the number of timer counts in each slot of the wheel
+#define STL_WHEEL_SLOT_WIDTH    (1L << STL_WHEEL_SLOT_BITS)
+
+// The compare unit sees only 16 bits, so the interrupt can't be set for more than a
+// turn of the wheel ahead unless a turn is less than the counter's range
+#if (STL_WHEEL_SLOTS << STL_WHEEL_SLOT_BITS) > 0x8000L
+    #error "A turn of the timer wheel must be no more than 32768 timer counts"
+#endif
+
+/// This pointer lets the compare interrupt find the wheel
+static stl_timer_wheel* p_the_wheel = NULL;
+
+
+//--------------------------------------------------------------------------------------
+/** This constructor creates an empty timer wheel. The compare interrupt stays off until
+ *  a timer is started.
+ *  @param a_timer A pointer to the task timer, which must already have been created
+ */
+
+stl_timer_wheel::stl_timer_wheel (task_timer* a_timer)
+    {
+    p_timer = a_timer;
+    num_created = 0;
+    num_running = 0;
+    slot_time = 0;
+
+    for (unsigned char index = 0; index < STL_WHEEL_SLOTS; index++)
+        heads[index] = STL_WHEEL_NONE;
+
+    p_the_wheel = this;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method reads the time from the task timer as one number. The task timer turns
+ *  interrupts off while it reads the hardware count, so the wheel's use of Timer 1's
+ *  16-bit registers in its interrupt can't spoil a read made by a task.
+ *  @return The current time in timer counts
+ */
+
+long stl_timer_wheel::read_time (void)
+    {
+    time_stamp now;                         // The current time
+    long counts;                            // The same time as a number
+
+    p_timer->save_time_stamp (now);
+    now.get_time (counts);
+
+    return (counts);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method puts a timer at the head of the list for the slot in which it expires.
+ *  It must be called with interrupts disabled.
+ *  @param index The timer's handle
+ */
+
+void stl_timer_wheel::link (unsigned char index)
+    {
+    stl_wheel_timer* p_tmr = timers + index;
+    unsigned char slot = (p_tmr->expires >> STL_WHEEL_SLOT_BITS) & (STL_WHEEL_SLOTS - 1);
+
+    p_tmr->slot = slot;
+    p_tmr->prev = STL_WHEEL_NONE;
+    p_tmr->next = heads[slot];
+    if (heads[slot] != STL_WHEEL_NONE)
+        timers[heads[slot]].prev = index;
+    heads[slot] = index;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method takes a timer out of its slot's list and marks it idle. It must be
+ *  called with interrupts disabled, and only for a timer which is running.
+ *  @param index The timer's handle
+ */
+
+void stl_timer_wheel::unlink (unsigned char index)
+    {
+    stl_wheel_timer* p_tmr = timers + index;
+
+    if (p_tmr->prev == STL_WHEEL_NONE)
+        heads[p_tmr->slot] = p_tmr->next;
+    else
+        timers[p_tmr->prev].next = p_tmr->next;
+    if (p_tmr->next != STL_WHEEL_NONE)
+        timers[p_tmr->next].prev = p_tmr->prev;
+
+    p_tmr->slot = STL_WHEEL_NONE;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method calls the functions of all the timers in one slot which are due. A
+ *  periodic timer is put back into the wheel for its next time before its function is
+ *  called; a function may start or stop any timer, so after each call the list is
+ *  looked through again from the beginning.
+ *  @param slot The number of the slot to look through
+ *  @param now The current time in timer counts
+ */
+
+void stl_timer_wheel::fire_due (unsigned char slot, long now)
+    {
+    unsigned char index = heads[slot];      // Handle of the timer being looked at
+    stl_wheel_timer* p_tmr;                 // Pointer to that timer
+
+    while (index != STL_WHEEL_NONE)
+        {
+        p_tmr = timers + index;
+        if (p_tmr->expires - now > 0)
+            {
+            index = p_tmr->next;
+            continue;
+            }
+
+        unlink (index);
+        if (p_tmr->period != 0)
+            {
+            // If whole periods were missed, the next call is a period from now
+            p_tmr->expires += p_tmr->period;
+            if (p_tmr->expires - now <= 0)
+                p_tmr->expires = now + p_tmr->period;
+            link (index);
+            }
+        else
+            num_running--;
+
+        p_tmr->callback (p_tmr->p_data);
+        index = heads[slot];
+        }
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method finds the time at which the wheel next has to be looked at: the time of
+ *  the earliest timer which expires in the current slot, or if there isn't one, the
+ *  start of the next slot whose list isn't empty. There must be a timer running.
+ *  @return The time in timer counts
+ */
+
+long stl_timer_wheel::next_time (void)
+    {
+    unsigned char slot = (slot_time >> STL_WHEEL_SLOT_BITS) & (STL_WHEEL_SLOTS - 1);
+    long next = slot_time + STL_WHEEL_SLOT_WIDTH;
+
+    for (unsigned char index = heads[slot]; index != STL_WHEEL_NONE;
+         index = timers[index].next)
+        if (timers[index].expires - next < 0)
+            next = timers[index].expires;
+
+    if (next == slot_time + STL_WHEEL_SLOT_WIDTH)
+        for (unsigned char count = 1; count < STL_WHEEL_SLOTS
+             && heads[(slot + count) & (STL_WHEEL_SLOTS - 1)] == STL_WHEEL_NONE; count++)
+            next += STL_WHEEL_SLOT_WIDTH;
+
+    return (next);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method sets the Timer 1 compare B unit to interrupt at the given time and
+ *  turns the interrupt on. It must be called with interrupts disabled.
+ *  @param when The time in timer counts, which must be less than a turn of the wheel
+ *      ahead and at least STL_WHEEL_MIN_COUNTS ahead
+ */
+
+void stl_timer_wheel::set_compare (long when)
+    {
+    OCR1B = (uint16_t)when;
+    #if defined __AVR_ATmega644__ || defined __AVR_ATmega324P__
+        TIFR1 = (1 << OCF1B);               // Clear any old compare match
+        TIMSK1 |= (1 << OCIE1B);            // and enable the compare interrupt
+    #else
+        TIFR = (1 << OCF1B);                // Clear any old compare match
+        TIMSK |= (1 << OCIE1B);             // and enable the compare interrupt
+    #endif
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method creates a timer. Timers can't be given back, so they should be created
+ *  once when the program starts, by the objects which will use them.
+ *  @param callback The function which the timer will call
+ *  @param p_data A pointer which is given to the function, usually to an object
+ *  @return A handle for the timer, or STL_WHEEL_NONE if all the timers are in use
+ */
+
+unsigned char stl_timer_wheel::create (stl_wheel_callback callback, void* p_data)
+    {
+    stl_wheel_timer* p_tmr;                 // Pointer to the new timer
+
+    if (num_created >= STL_WHEEL_TIMERS)
+        return (STL_WHEEL_NONE);
+
+    p_tmr = timers + num_created;
+    p_tmr->callback = callback;
+    p_tmr->p_data = p_data;
+    p_tmr->period = 0;
+    p_tmr->slot = STL_WHEEL_NONE;
+
+    return (num_created++);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method starts a timer. If the timer is already running, it's started over from
+ *  now. A delay shorter than STL_WHEEL_MIN_COUNTS may come up to that many counts late.
+ *  This method can be called from tasks or from timer functions.
+ *  @param handle The timer's handle, as returned by create()
+ *  @param delay The time from now until the timer's function is called
+ *  @param period The time between calls after that, or zero to call the function once
+ *  @return True if the timer was started, false if the handle isn't a timer's
+ */
+
+bool stl_timer_wheel::start (unsigned char handle, const time_stamp& delay,
+                             const time_stamp& period)
+    {
+    time_stamp copy;                        // Copy of a time, which can be read
+    long counts;                            // Delay in timer counts
+    long now;                               // Current time in timer counts
+    long next;                              // Time at which the wheel needs service
+    unsigned char sreg;                     // Saved status register
+
+    if (handle >= num_created)
+        return (false);
+
+    copy = delay;
+    copy.get_time (counts);
+    if (counts < 0)
+        counts = 0;
+
+    sreg = SREG;
+    cli ();
+
+    if (timers[handle].slot != STL_WHEEL_NONE)
+        unlink (handle);
+    else
+        num_running++;
+
+    // If the wheel was idle, it starts turning from the slot which holds the time now
+    now = read_time ();
+    if (num_running == 1)
+        slot_time = now & ~(STL_WHEEL_SLOT_WIDTH - 1);
+
+    copy = period;
+    copy.get_time (timers[handle].period);
+    timers[handle].expires = now + counts;
+    link (handle);
+
+    // There isn't time to wait here as the interrupt does, so a time which is too
+    // close is put off by a little
+    next = next_time ();
+    if (next - now < STL_WHEEL_MIN_COUNTS)
+        next = now + STL_WHEEL_MIN_COUNTS;
+    set_compare (next);
+
+    SREG = sreg;
+
+    return (true);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method stops a timer. Nothing happens if it wasn't running. The compare
+ *  interrupt is left as it was; if it comes when there's nothing to do, it just sets
+ *  itself for the next time or turns itself off.
+ *  @param handle The timer's handle, as returned by create()
+ */
+
+void stl_timer_wheel::stop (unsigned char handle)
+    {
+    unsigned char sreg = SREG;              // Saved status register
+
+    cli ();
+    if (handle < num_created && timers[handle].slot != STL_WHEEL_NONE)
+        {
+        unlink (handle);
+        num_running--;
+        }
+    SREG = sreg;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method checks if a timer is running.
+ *  @param handle The timer's handle, as returned by create()
+ *  @return True if the timer's function is still to be called
+ */
+
+bool stl_timer_wheel::is_running (unsigned char handle)
+    {
+    return (handle < num_created && timers[handle].slot != STL_WHEEL_NONE);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method is called by the compare interrupt, with interrupts disabled. It looks
+ *  through every slot from the one it last looked at up to the one which holds the time
+ *  now, calling the functions of timers which are due, then sets the compare interrupt
+ *  for the next time it's needed. If that time is too close to set the interrupt for,
+ *  this method waits for it and goes around again.
+ */
+
+void stl_timer_wheel::service (void)
+    {
+    long now;                               // Current time in timer counts
+    long next;                              // Time at which the wheel needs service
+
+    for (;;)
+        {
+        now = read_time ();
+
+        // If the wheel has gotten more than a turn behind, each slot is looked at once
+        if (now - slot_time >= STL_WHEEL_SLOTS * STL_WHEEL_SLOT_WIDTH)
+            slot_time = (now & ~(STL_WHEEL_SLOT_WIDTH - 1))
+                        - (STL_WHEEL_SLOTS - 1) * STL_WHEEL_SLOT_WIDTH;
+
+        for (;;)
+            {
+            fire_due ((slot_time >> STL_WHEEL_SLOT_BITS) & (STL_WHEEL_SLOTS - 1), now);
+            if (now - slot_time < STL_WHEEL_SLOT_WIDTH)
+                break;
+            slot_time += STL_WHEEL_SLOT_WIDTH;
+            }
+
+        if (num_running == 0)
+            {
+            #if defined __AVR_ATmega644__ || defined __AVR_ATmega324P__
+                TIMSK1 &= ~(1 << OCIE1B);
+            #else
+                TIMSK &= ~(1 << OCIE1B);
+            #endif
+            return;
+            }
+
+        next = next_time ();
+        if (next - read_time () >= STL_WHEEL_MIN_COUNTS)
+            {
+            set_compare (next);
+            return;
+            }
+        }
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This is the interrupt service routine for Timer 1 compare B, which the timer wheel
+ *  uses to call its timers' functions on time. It reads TCNT1 and writes OCR1B, which
+ *  go through the same TEMP byte as every other 16-bit Timer 1 access; that's safe
+ *  because the task timer reads TCNT1 with interrupts off (see get_ticks()), so this
+ *  routine can't run between the two bytes of a read in the main loop.
+ */
+
+ISR (TIMER1_COMPB_vect)
+    {
+    if (p_the_wheel != NULL)
+        p_the_wheel->service ();
+    }
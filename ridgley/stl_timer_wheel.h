@@ -0,0 +1,139 @@
+//======================================================================================
+/** \file stl_timer_wheel.h
+ *    This file contains a timer wheel, which calls functions at given times with the
+ *    resolution of the task timer. Tasks are the right place for anything which takes
+ *    a while, but a task can only notice that a time has come the next time it runs, so
+ *    short pulses timed by tasks are rounded off to the task's interval. A wheel timer
+ *    calls its function from the Timer 1 compare B interrupt within a few microseconds
+ *    of the time it was set for, and starting or stopping a timer takes the same short
+ *    time no matter how many timers are running.
+ *
+ *  Usage:
+ *    Create one stl_timer_wheel after the task_timer. Each user of the wheel creates
+ *    its timers once, at startup, getting a handle for each, and then starts and stops
+ *    them as often as needed:
+ *    \code
+ *    shutter_timer = p_wheel->create (release_shutter, this);
+ *    ...
+ *    p_wheel->start (shutter_timer, time_stamp (0, 200000));
+ *    \endcode
+ *    The function is called with interrupts disabled, so it should only do a little
+ *    work, such as changing a pin or posting an event to a task; it may start and stop
+ *    timers, including its own. A timer started with a period calls its function again
+ *    each period until it's stopped.
+ *
+ *  How it works:
+ *    Time is divided into slots of 2^STL_WHEEL_SLOT_BITS timer counts, and the wheel
+ *    has STL_WHEEL_SLOTS lists of timers, one for each slot in a turn of the wheel. A
+ *    timer goes into the list for the slot in which it will expire; timers set for
+ *    more than a turn ahead share lists with nearer ones and are passed over until
+ *    their turn comes. The timers are kept in an array and linked by index, both ways,
+ *    so putting one into a list or taking it out takes a few instructions. The compare
+ *    interrupt is set for the earliest timer in the current slot, or for the start of
+ *    the next slot which has any timers in it, and is turned off when no timers are
+ *    running.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _STL_TIMER_WHEEL_H_                 // To prevent stl_timer_wheel.h from being
+#define _STL_TIMER_WHEEL_H_                 // included in a source file more than once
+
+#include "stl_us_timer.h"                   // Timer measures real time
+
+
+/** This is the number of timers which can be created. It can't be more than 254; each
+ *  timer takes 15 bytes of RAM on the AVR.
+ */
+#define STL_WHEEL_TIMERS        16
+
+/** This is the number of slots in one turn of the wheel. It must be a power of two,
+ *  and a whole turn must be less than half of the 16-bit hardware timer's range.
+ */
+#define STL_WHEEL_SLOTS         16
+
+/** This is the log base 2 of the number of timer counts in each slot. Wider slots mean
+ *  fewer interrupts for timers set far ahead, narrower ones shorter lists to look
+ *  through when the compare time is worked out.
+ */
+#define STL_WHEEL_SLOT_BITS     10
+
+/** If the compare interrupt would have to be set for a time closer than this many
+ *  timer counts, the interrupt service routine waits for the time instead, since the
+ *  counter could pass the compare value before it was written.
+ */
+#define STL_WHEEL_MIN_COUNTS    20
+
+/// This handle means no timer; create() returns it when there are none left
+#define STL_WHEEL_NONE          0xFF
+
+
+/// This is the type of the functions which wheel timers call
+typedef void (*stl_wheel_callback) (void*);
+
+
+//--------------------------------------------------------------------------------------
+/** This structure holds one wheel timer.
+ */
+
+struct stl_wheel_timer
+    {
+    long expires;                           ///< Time at which the function is called
+    long period;                            ///< Time between calls, or 0 for one call
+    stl_wheel_callback callback;            ///< Function which is called
+    void* p_data;                           ///< Pointer which is given to the function
+    unsigned char next;                     ///< Next timer in the same slot's list
+    unsigned char prev;                     ///< Previous timer in the same slot's list
+    unsigned char slot;                     ///< Slot number, or STL_WHEEL_NONE if idle
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This class implements the timer wheel. There should be only one, since it uses the
+ *  Timer 1 compare B interrupt.
+ */
+
+class stl_timer_wheel
+    {
+    protected:
+        task_timer* p_timer;                // The timer which measures time
+        stl_wheel_timer timers[STL_WHEEL_TIMERS];   // All the timers
+        unsigned char heads[STL_WHEEL_SLOTS];       // First timer in each slot's list
+        unsigned char num_created;          // Number of timers handed out so far
+        unsigned char num_running;          // Number of timers which are running
+        long slot_time;                     // Start of the slot last looked at
+
+        long read_time (void);              // Get the time as a number of counts
+        void link (unsigned char);          // Put a timer into its slot's list
+        void unlink (unsigned char);        // Take a timer out of its slot's list
+        void fire_due (unsigned char, long);    // Call functions in a slot which are due
+        long next_time (void);              // Find when the wheel next needs service
+        void set_compare (long);            // Set the compare interrupt for a time
+
+    public:
+        // The constructor sets up an empty wheel using the given timer
+        stl_timer_wheel (task_timer*);
+
+        // This method creates a timer which will call the given function
+        unsigned char create (stl_wheel_callback, void* = NULL);
+
+        // This method starts a timer, or restarts one which is already running
+        bool start (unsigned char, const time_stamp&, const time_stamp& = time_stamp (0L));
+
+        // This method stops a timer so that its function won't be called
+        void stop (unsigned char);
+
+        // This method checks if a timer is running
+        bool is_running (unsigned char);
+
+        // This method is called by the compare interrupt to call functions when due
+        void service (void);
+    };
+
+#endif // _STL_TIMER_WHEEL_H_
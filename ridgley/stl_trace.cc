@@ -0,0 +1,140 @@
+//======================================================================================
+/** \file stl_trace.cc
+ *    This file contains the state transition trace ring and the task which prints its
+ *    contents. See stl_trace.h for a description of how they're used.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#include <stdlib.h>
+#include <avr/io.h>
+#include "stl_debug.h"                      // Definitions for debugging serial port
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "stl_task.h"                       // The state transition logic header
+#include "stl_trace.h"                      // Header for this file
+
+
+// Nothing here takes up any memory unless ring tracing has been turned on
+#ifdef STL_TRACE_RING
+
+/// This is the one trace ring which all tasks write into
+stl_trace_ring g_trace_ring;
+
+
+//--------------------------------------------------------------------------------------
+/** This constructor creates an empty trace ring.
+ */
+
+stl_trace_ring::stl_trace_ring (void)
+    {
+    i_put = 0;
+    i_get = 0;
+    num_lost = 0;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method takes the oldest record out of the trace ring.
+ *  @param a_record A reference to a record into which the oldest record is copied
+ *  @return True if a record was taken, false if the ring was empty
+ */
+
+bool stl_trace_ring::get (stl_trace_record& a_record)
+    {
+    if (i_get == i_put)
+        return (false);
+
+    a_record = records[i_get++ & (STL_TRACE_RING_SIZE - 1)];
+    return (true);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method returns the number of records which were written over before they could
+ *  be taken out, then sets that number back to zero.
+ *  @return The number of records lost since this method was last called
+ */
+
+unsigned char stl_trace_ring::take_lost (void)
+    {
+    unsigned char lost = num_lost;
+
+    num_lost = 0;
+    return (lost);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This constructor creates a trace drain task.
+ *  @param time_interval The time between runs of the task, which should be long
+ *  @param a_port A pointer to the serial port to which records are printed
+ */
+
+stl_trace_drain::stl_trace_drain (const time_stamp& time_interval,
+                                  base_text_serial* a_port)
+    : stl_task (time_interval)
+    {
+    p_port = a_port;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method prints a number in hexadecimal with a fixed number of digits, leading
+ *  zeros included, so that the lines in the dump are all the same width.
+ *  @param number The number to be printed
+ *  @param digits How many hexadecimal digits to print
+ */
+
+void stl_trace_drain::put_hex (unsigned long number, unsigned char digits)
+    {
+    unsigned char nibble;                   // One hexadecimal digit's worth of bits
+
+    while (digits-- > 0)
+        {
+        nibble = (number >> (digits << 2)) & 0x0F;
+        p_port->putchar (nibble < 10 ? '0' + nibble : 'A' - 10 + nibble);
+        }
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method prints any lost record count and then every record in the trace ring.
+ *  Records are only put into the ring from the main loop, so none can arrive while
+ *  this loop runs and it always ends. The drain task has only one state.
+ *  @param state The state of the task when this run method begins running
+ *  @return STL_NO_TRANSITION, as this task never changes state
+ */
+
+char stl_trace_drain::run (char state)
+    {
+    stl_trace_record record;                // A record taken from the trace ring
+    unsigned char lost;                     // Number of records which were lost
+
+    if ((lost = g_trace_ring.take_lost ()) != 0)
+        {
+        p_port->puts (F ("TL "));
+        put_hex (lost, 2);
+        p_port->puts (F ("\r\n"));
+        }
+
+    while (g_trace_ring.get (record))
+        {
+        p_port->puts (F ("TR "));
+        put_hex (record.time, 8);
+        p_port->putchar (' ');
+        put_hex (record.from_id, 2);
+        p_port->putchar (' ');
+        put_hex (record.to_state, 2);
+        p_port->puts (F ("\r\n"));
+        }
+
+    return (STL_NO_TRANSITION);
+    }
+
+#endif // STL_TRACE_RING
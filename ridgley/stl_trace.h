@@ -0,0 +1,141 @@
+//======================================================================================
+/** \file stl_trace.h
+ *    This file contains a state transition trace which is kept in a ring buffer in
+ *    RAM. Each transition is saved as a small binary record, which takes only a few
+ *    instructions, so turning tracing on doesn't change the timing of the tasks being
+ *    traced the way printing each transition to a serial port does. A low priority
+ *    task prints the records later as lines of hex which the host program
+ *    trace_decoder.rb turns back into a timeline.
+ *
+ *  Usage:
+ *    Define STL_TRACE_RING in the Makefile's DEBUG_CODES, create a stl_trace_drain
+ *    task with a serial port, and add it to the scheduler. Each line it prints has the
+ *    form "TR tttttttt ii ss", where tttttttt is the time at which the transition was
+ *    made, ii is the task's serial number (high nibble) and old state (low nibble),
+ *    and ss is the new state, all in hexadecimal. If the ring fills up before it's
+ *    drained, the oldest records are lost and a line "TL nn" tells how many.
+ *
+ *    Each time the drain task runs it empties the ring, so the ring only has to hold
+ *    the transitions made between two runs of the drain. Each line is 19 characters
+ *    long, so a port running at 9600 baud can carry about 50 transitions a second;
+ *    tracing tasks which change state faster than that needs a faster baud rate, or
+ *    the serial port's buffer fills up and its full policy decides what's lost.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *    \li  10-16-26  The drain task empties the ring each run; the ring holds 64 records
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _STL_TRACE_H_                       // To prevent stl_trace.h from being
+#define _STL_TRACE_H_                       // included in a source file more than once
+
+#include "base_text_serial.h"               // Serial port for printing the records
+#include "stl_us_timer.h"                   // Timer measures real time
+#include "stl_debug.h"                      // Definitions for debugging serial port
+#include "stl_task.h"                       // The state transition logic header
+
+
+/** This is the number of records in the trace ring. It must be a power of two no
+ *  bigger than 128; each record takes 6 bytes of RAM. It must hold all the
+ *  transitions which are made between two runs of the drain task.
+ */
+#define STL_TRACE_RING_SIZE     64
+
+
+//--------------------------------------------------------------------------------------
+/** This structure holds one state transition record.
+ */
+
+struct stl_trace_record
+    {
+    long time;                              ///< Time at which the transition was made
+    unsigned char from_id;                  ///< Task serial number and old state
+    unsigned char to_state;                 ///< State to which the task went
+    };
+
+
+//--------------------------------------------------------------------------------------
+/** This class implements the ring buffer which holds transition records. Records are
+ *  put in by stl_task::schedule() and taken out by the drain task, both from the main
+ *  loop, so no interrupt protection is needed. The indices run freely and are masked
+ *  when used, so the difference between them is always the number of records held.
+ */
+
+class stl_trace_ring
+    {
+    protected:
+        stl_trace_record records[STL_TRACE_RING_SIZE];  // The saved records
+        unsigned char i_put;                // Count of records which have been put in
+        unsigned char i_get;                // Count of records which have been taken
+        unsigned char num_lost;             // Records overwritten before being taken
+
+    public:
+        stl_trace_ring (void);
+
+        /** This method saves one transition in the ring. If the ring is full, the
+         *  oldest record is written over and counted as lost.
+         *  @param a_time The time at which the transition was made
+         *  @param from_id The task's serial number and old state; see STL_STATE_ID()
+         *  @param to_state The state to which the task went
+         */
+        inline void put (time_stamp& a_time, unsigned char from_id,
+                         unsigned char to_state)
+            {
+            stl_trace_record* p_rec = records + (i_put & (STL_TRACE_RING_SIZE - 1));
+
+            a_time.get_time (p_rec->time);
+            p_rec->from_id = from_id;
+            p_rec->to_state = to_state;
+            if ((unsigned char)(++i_put - i_get) > STL_TRACE_RING_SIZE)
+                {
+                i_get++;
+                if (num_lost != 0xFF)
+                    num_lost++;
+                }
+            }
+
+        bool get (stl_trace_record&);       // Take the oldest record out of the ring
+        unsigned char take_lost (void);     // Get and clear the count of lost records
+    };
+
+
+/// This is the one trace ring which all tasks write into
+extern stl_trace_ring g_trace_ring;
+
+
+/** This macro saves a transition in the trace ring if ring tracing has been turned on
+ *  by defining STL_TRACE_RING, and does nothing otherwise.
+ */
+#ifdef STL_TRACE_RING
+    #define STL_TRACE_RECORD(time, from_id, to) g_trace_ring.put (time, from_id, to)
+#else
+    #define STL_TRACE_RECORD(time, from_id, to)
+#endif
+
+
+//--------------------------------------------------------------------------------------
+/** This class is a task which prints the records in the trace ring to a serial port.
+ *  Each time it runs it prints every record in the ring, so its interval must be
+ *  short enough that the ring doesn't fill up between runs.
+ */
+
+class stl_trace_drain : public stl_task
+    {
+    protected:
+        base_text_serial* p_port;           // Serial port to which records are printed
+
+        void put_hex (unsigned long, unsigned char);    // Print a fixed width number
+
+    public:
+        // The constructor saves the port to which the records will be printed
+        stl_trace_drain (const time_stamp&, base_text_serial*);
+
+        char run (char);                    // Print all the records in the ring
+    };
+
+#endif // _STL_TRACE_H_
@@ -14,6 +14,9 @@
  *      \li 01-05-08  JRR  Converted from time-of-day version to microsecond version
  *      \li 03-27-08  JRR  Added operators + and - for time stamps
  *      \li 03-31-08  JRR  Merged in stl_us_timer (int, long) and set_time (int, long)
+ *      \li 10-16-26       Time is read without turning interrupts off
+ *      \li 10-16-26       Except for the two bytes of TCNT1, which ISRs also use
+ *      \li 10-16-26       Seconds, microseconds and digits are found without division
  *
  *  License:
  *      This file copyright 2007 by JR Ridgely. It is released under the Lesser GNU
@@ -24,6 +27,7 @@
 #include <stdlib.h>                         // Used for itoa()
 #include <string.h>
 #include <avr/interrupt.h>                  // There's an interrupt service routine here
+#include <avr/pgmspace.h>                   // The table of powers of ten is in flash
 
 #include "stl_us_timer.h"                   // Header for this file
 
@@ -35,7 +39,31 @@
 
 /** This variable holds the number of times the hardware timer has overflowed. This
  *  number is equivalent to the upper 16 bits of a 32-bit timer, and is so used. */
-unsigned int ust_overflows = 0;
+volatile uint16_t ust_overflows = 0;
+
+/** This variable holds the number of times the overflow counter has wrapped around,
+ *  making it the upper 16 bits of a 48-bit time. */
+volatile uint16_t ust_epochs = 0;
+
+/// This is the number of timer counts in one second
+#define UST_COUNTS_PER_SEC      (1000000L / USEC_PER_COUNT)
+
+/// This is the number of bits needed to hold the seconds in a 32-bit time stamp
+#define UST_SECOND_BITS         (USEC_PER_COUNT == 1 ? 13 : 14)
+
+/// These are the powers of ten, which digits are found by subtracting
+static const uint32_t ust_powers_of_ten[] PROGMEM =
+    {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 
+    10000UL, 1000UL, 100UL, 10UL, 1UL
+    };
+
+/// This is the register holding Timer 1's overflow flag, which has different names
+#if defined __AVR_ATmega644__ || defined __AVR_ATmega324P__
+    #define UST_TIFR    TIFR1
+#else
+    #define UST_TIFR    TIFR
+#endif
 
 
 //--------------------------------------------------------------------------------------
@@ -110,6 +138,78 @@ void time_stamp::get_time (long& an_item)
     }
 
 
+//--------------------------------------------------------------------------------------
+/** This function writes a number as decimal digits. Each digit is found by subtracting
+ *  its power of ten until the number is smaller, which takes at most nine 32-bit 
+ *  subtractions per digit; the AVR has no divide instruction, and the library's 32-bit
+ *  division takes several times as long. 
+ *  @param str A pointer to the buffer where the digits go, followed by a '\0'
+ *  @param number The number to be written
+ *  @param places The number of digits to write, with leading zeros, or zero to write
+ *      only as many as are needed
+ *  @return A pointer to the '\0' at the end of the digits
+ */
+
+static char* put_decimal (char* str, uint32_t number, unsigned char places)
+    {
+    bool started = (places != 0);           // True once the first digit is written
+
+    for (unsigned char index = (places != 0 ? 10 - places : 0); index < 10; index++)
+        {
+        uint32_t power = pgm_read_dword (ust_powers_of_ten + index);
+        char digit = '0';
+
+        while (number >= power)
+            {
+            number -= power;
+            digit++;
+            }
+        if (started || digit != '0' || index == 9)
+            {
+            *str++ = digit;
+            started = true;
+            }
+        }
+    *str = '\0';
+
+    return (str);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method splits the time in the time stamp into seconds and microseconds. The 
+ *  seconds are found by binary long division: the number of counts in a second, 
+ *  shifted left, is subtracted wherever it fits, one bit of the answer at a time. That
+ *  is thirteen shifts, compares and subtractions, much quicker on an AVR than dividing.
+ *  A negative time, such as a difference between time stamps, gives a negative number
+ *  of seconds and microseconds, as dividing would. 
+ *  @param sec A reference to the variable in which the seconds are put
+ *  @param microsec A reference to the variable in which the microseconds left over 
+ *      after the seconds are taken out are put
+ */
+
+void time_stamp::split (int& sec, long& microsec)
+    {
+    uint32_t counts;                        // The time, made positive
+    unsigned int seconds = 0;               // Seconds found so far
+    bool negative = (data.whole < 0);       // True if the time is negative
+
+    counts = negative ? -(uint32_t)data.whole : (uint32_t)data.whole;
+    for (unsigned char bit = UST_SECOND_BITS; bit-- > 0; )
+        {
+        uint32_t chunk = (uint32_t)UST_COUNTS_PER_SEC << bit;
+        if (counts >= chunk)
+            {
+            counts -= chunk;
+            seconds |= (1 << bit);
+            }
+        }
+
+    sec = negative ? -(int)seconds : (int)seconds;
+    microsec = negative ? -(long)(counts * USEC_PER_COUNT) : (long)(counts * USEC_PER_COUNT);
+    }
+
+
 //--------------------------------------------------------------------------------------
 /** This method returns the number of seconds in the time stamp.
  *  @return The number of whole seconds in the time stamp
@@ -117,7 +217,11 @@ void time_stamp::get_time (long& an_item)
 
 int time_stamp::get_seconds (void)
     {
-    return ((int)(data.whole / (1000000L / USEC_PER_COUNT)));
+    int sec;                                // Seconds in the time
+    long microsec;                          // Microseconds, which aren't needed
+
+    split (sec, microsec);
+    return (sec);
     }
 
 
@@ -129,7 +233,11 @@ int time_stamp::get_seconds (void)
 
 long time_stamp::get_microsec (void)
     {
-    return ((data.whole % 1000000L) * USEC_PER_COUNT);
+    int sec;                                // Seconds, which aren't needed
+    long microsec;                          // Microseconds in the time
+
+    split (sec, microsec);
+    return (microsec);
     }
 
 
@@ -233,6 +341,81 @@ bool time_stamp::operator >= (const time_stamp& other)
     }
 
 
+//--------------------------------------------------------------------------------------
+/** This method returns the time in a long time stamp as a count of microseconds. On an
+ *  AVR, 64-bit arithmetic is done by library functions which are fairly slow, so this
+ *  is meant for things like telemetry rather than scheduling. 
+ *  @return The time in microseconds
+ */
+
+uint64_t long_time_stamp::get_microsec (void) const
+    {
+    return ((((uint64_t)epochs << 32) | (uint32_t)data.whole) * USEC_PER_COUNT);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method splits the time in a long time stamp into seconds and microseconds, by
+ *  binary long division as in time_stamp::split(). There are 16 more bits of seconds
+ *  to find, each with a 64-bit compare and subtraction, but that's still far quicker
+ *  than the library's 64-bit division. 
+ *  @param sec A reference to the variable in which the seconds are put
+ *  @param microsec A reference to the variable in which the microseconds left over 
+ *      after the seconds are taken out are put
+ */
+
+void long_time_stamp::split (uint32_t& sec, uint32_t& microsec) const
+    {
+    uint64_t counts = ((uint64_t)epochs << 32) | (uint32_t)data.whole;
+    uint32_t seconds = 0;                   // Seconds found so far
+
+    for (unsigned char bit = UST_SECOND_BITS + 16; bit-- > 0; )
+        {
+        uint64_t chunk = (uint64_t)UST_COUNTS_PER_SEC << bit;
+        if (counts >= chunk)
+            {
+            counts -= chunk;
+            seconds |= ((uint32_t)1 << bit);
+            }
+        }
+
+    sec = seconds;
+    microsec = (uint32_t)counts * USEC_PER_COUNT;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method returns the number of whole seconds in a long time stamp.
+ *  @return The number of seconds
+ */
+
+uint32_t long_time_stamp::get_seconds (void) const
+    {
+    uint32_t sec;                           // Seconds in the time
+    uint32_t microsec;                      // Microseconds, which aren't needed
+
+    split (sec, microsec);
+    return (sec);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This operator checks if this long time stamp is later than or equal to another. As
+ *  long time stamps don't wrap around, the times are just compared as unsigned numbers,
+ *  the wrap count first. 
+ *  @param other A long time stamp to be compared to this one
+ *  @return True if this time is later than or the same as the other one
+ */
+
+bool long_time_stamp::operator >= (const long_time_stamp& other) const
+    {
+    if (epochs != other.epochs)
+        return (epochs > other.epochs);
+
+    return ((uint32_t)data.whole >= (uint32_t)other.data.whole);
+    }
+
+
 //--------------------------------------------------------------------------------------
 /** This constructor creates a daytime task timer object.  It sets up the hardware timer
  *  to count at ~1 MHz and interrupt on overflow. Note that this method does not enable
@@ -269,40 +452,113 @@ task_timer::task_timer (void)
     }
 
 
+//--------------------------------------------------------------------------------------
+/** This function reads the hardware and overflow counters together, turning interrupts
+ *  off only for the two instructions of the hardware count's read. The overflow count
+ *  is read before and after the hardware count; if they're different, the overflow
+ *  interrupt ran in between and the counts are read again. If the timer has overflowed
+ *  but the interrupt hasn't run yet, because interrupts are off or another interrupt
+ *  is being serviced, the overflow flag is still set; if the hardware count is then
+ *  small, it was read after the overflow, so the overflow is counted here. The
+ *  hardware count is read by get_ticks(), which keeps an interrupt service routine
+ *  that uses Timer 1's 16-bit registers, such as the timer wheel's, from getting
+ *  between the two bytes of the read.
+ *  @param a_time A reference to the time data to be filled in
+ */
+
+static inline void read_time (time_data_32& a_time)
+    {
+    uint16_t overflows;                     // Overflow count read before hardware count
+    uint8_t flags;                          // Timer flags read after hardware count
+
+    do
+        {
+        overflows = ust_overflows;
+        a_time.half[0] = task_timer::get_ticks ();
+        flags = UST_TIFR;
+        }
+    while (overflows != ust_overflows);
+
+    if ((flags & (1 << TOV1)) && !(a_time.half[0] & 0x8000))
+        overflows++;
+    a_time.half[1] = overflows;
+    }
+
+
 //--------------------------------------------------------------------------------------
 /** This method grabs the current time stamp from the hardware and overflow counters. 
- *  In order to prevent the data changing during the time when it's being read (which 
- *  would cause invalid data to be saved), interrupts are disabled while the time data 
- *  is being copied. 
+ *  Interrupts are off only while the hardware count's two bytes are read, so it hardly
+ *  delays interrupts such as the encoder's, and it can be called from an interrupt
+ *  service routine.
  *  @param the_stamp Reference to a time stamp variable which will hold the time
  */
 
 void task_timer::save_time_stamp (time_stamp& the_stamp)
     {
-    cli ();                                 // Prevent interruption
-    the_stamp.data.half[0] = TCNT1;         // Get hardware count
-    the_stamp.data.half[1] = ust_overflows; // Get overflow counter data
-    sei ();                                 // Re-enable interrupts
+    read_time (the_stamp.data);
     }
 
 
 //--------------------------------------------------------------------------------------
 /** This method saves the current time in the internal time stamp belonging to this 
  *  object, then returns a reference to the time stamp so that the caller can use it as
- *  a measurement of what the time is now. 
+ *  a measurement of what the time is now. Like save_time_stamp(), it turns interrupts
+ *  off only for the read of the hardware count. 
  */
 
 time_stamp& task_timer::get_time_now (void)
     {
-    cli ();                                 // Prevent interruption
-    now_time.data.half[0] = TCNT1;          // Get hardware count
-    now_time.data.half[1] = ust_overflows;  // Get overflow counter data
-    sei ();                                 // Re-enable interrupts
+    read_time (now_time.data);
 
     return (now_time);                      // Return a reference to the current time
     }
 
 
+//--------------------------------------------------------------------------------------
+/** This method saves the current time in a long time stamp, which won't wrap around
+ *  for almost nine years. It reads the counters the same way as save_time_stamp(), 
+ *  with the wrap count read inside the same check of the overflow count, so it turns
+ *  interrupts off only for the read of the hardware count as well. 
+ *  @param the_stamp Reference to a long time stamp which will hold the time
+ */
+
+void task_timer::save_long_time (long_time_stamp& the_stamp)
+    {
+    uint16_t overflows;                     // Overflow count read before hardware count
+    uint8_t flags;                          // Timer flags read after hardware count
+
+    do
+        {
+        overflows = ust_overflows;
+        the_stamp.epochs = ust_epochs;
+        the_stamp.data.half[0] = get_ticks ();
+        flags = UST_TIFR;
+        }
+    while (overflows != ust_overflows);
+
+    if ((flags & (1 << TOV1)) && !(the_stamp.data.half[0] & 0x8000))
+        if (++overflows == 0)
+            the_stamp.epochs++;
+    the_stamp.data.half[1] = overflows;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method returns the number of seconds since the timer started. It keeps going up
+ *  for as long as the program runs (unless set_time() is used to change the time), so
+ *  it can be used as an uptime counter in telemetry. 
+ *  @return The number of whole seconds the timer has been running
+ */
+
+uint32_t task_timer::get_uptime (void)
+    {
+    long_time_stamp now;                    // The time right now, which doesn't wrap
+
+    save_long_time (now);
+    return (now.get_seconds ());
+    }
+
+
 //--------------------------------------------------------------------------------------
 /** This method sets the timer to a given value. It's not likely that this method will
  *  be used, but it is provided for compatibility with other task timer implementations
@@ -313,10 +569,52 @@ time_stamp& task_timer::get_time_now (void)
 
 bool task_timer::set_time (time_stamp& t_stamp)
     {
+    unsigned char sreg = SREG;              // Saved status register
+
     cli ();                                 // Prevent interruption
     TCNT1 = t_stamp.data.half[0];
     ust_overflows = t_stamp.data.half[1];
-    sei ();                                 // Re-enable interrupts
+    SREG = sreg;                            // Interrupts back as they were
+
+    return (true);
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This method arms the Timer 1 output compare A interrupt so that it will fire at the
+ *  given time. The interrupt does nothing but wake the processor up, so this method
+ *  is used to put the processor to sleep until a task's next run time. The compare
+ *  unit only sees the lower 16 bits of the time; if the alarm time is more than one
+ *  timer overflow away, the processor just wakes up early (as it also does on every
+ *  overflow interrupt) and goes back to sleep. This method must be called with
+ *  interrupts disabled, so that the alarm can't be missed between setting it up and
+ *  going to sleep. 
+ *  @param alarm_time A reference to a time stamp holding the time to wake up
+ *  @return True if the alarm was set, false if the alarm time is too close (or past)
+ */
+
+bool task_timer::set_alarm (time_stamp& alarm_time)
+    {
+    time_data_32 now;                       // The time right now
+    long difference;                        // Time from now until the alarm
+
+    // Interrupts are off, so an overflow may be pending without having been counted
+    read_time (now);
+
+    difference = alarm_time.data.whole - now.whole;
+    if (difference < STL_MIN_ALARM_COUNTS)
+        return (false);
+
+    OCR1A = alarm_time.data.half[0];        // Compare with the low half of the time
+    #if defined __AVR_ATmega644__ || defined __AVR_ATmega324P__
+        TIFR1 = (1 << OCF1A);               // Clear any old compare match
+        TIMSK1 |= (1 << OCIE1A);            // and enable the compare interrupt
+    #else
+        TIFR = (1 << OCF1A);                // Clear any old compare match
+        TIMSK |= (1 << OCIE1A);             // and enable the compare interrupt
+    #endif
+
+    return (true);
     }
 
 
@@ -331,29 +629,28 @@ bool task_timer::set_time (time_stamp& t_stamp)
 
 void time_stamp::to_string (char* str, unsigned char digits)
     {
-    unsigned long microseconds;             // Holds microseconds in the time
-    unsigned int seconds;                   // Holds the seconds part of the time
+    long microseconds;                      // Holds microseconds in the time
+    int seconds;                            // Holds the seconds part of the time
 
     // The counter probably doesn't run at exactly one microsecond per count, so
     // convert the count into actual microseconds, then find the number of seconds
     // and microseconds in the time
-    microseconds = (data.whole % 1000000L) * USEC_PER_COUNT;
-    seconds = (int)(data.whole / (1000000L / USEC_PER_COUNT));
+    split (seconds, microseconds);
+    if (data.whole < 0)
+        {
+        *str++ = '-';
+        seconds = -seconds;
+        microseconds = -microseconds;
+        }
 
-    utoa (seconds, str, 10);                // Put seconds in the string
-    while (*str) str++;                     // Move pointer to end of string
+    str = put_decimal (str, seconds, 0);    // Put seconds in the string
     *str++ = '.';                           // Add the decimal point
 
-    // For the digits in the fractional part, write 'em in backwards order. We can't
-    // use itoa here because we need leading zeros
-    for (char counter = 5; counter >= 0; counter--)
-        {
-        // Only print the digit if within "digits" range; but always divide by 10
-        if (counter < digits)
-            str[counter] = microseconds % 10 + '0'; 
-        microseconds /= 10;
-        }
-    str[digits] = '\0';                     // Don't forget the end-of-string
+    // The fractional part needs its leading zeros; all six digits are written, then
+    // the string is cut off after the ones which were asked for
+    put_decimal (str, microseconds, 6);
+    if (digits < 6)
+        str[digits] = '\0';
     }
 
 
@@ -375,6 +672,30 @@ base_text_serial& operator<< (base_text_serial& serial, time_stamp& stamp)
     }
 
 
+//--------------------------------------------------------------------------------------
+/** This operator writes a long time stamp to a serial port as seconds and microseconds,
+ *  for example "86400.000125" for one day and 125 microseconds. 
+ *  @param serial A reference to the serial-type object to which to print
+ *  @param stamp A reference to the long time stamp to be displayed
+ */
+
+base_text_serial& operator<< (base_text_serial& serial, long_time_stamp& stamp)
+    {
+    uint32_t seconds;                       // Seconds in the time
+    uint32_t microsec;                      // Microseconds after the seconds
+    char str[18];                           // String on which to print the time
+    char* p_end;                            // Where the seconds end in the string
+
+    stamp.split (seconds, microsec);
+    p_end = put_decimal (str, seconds, 0);
+    *p_end++ = '.';
+    put_decimal (p_end, microsec, 6);
+    serial << str;
+
+    return (serial);
+    }
+
+
 //--------------------------------------------------------------------------------------
 /** This is the interrupt service routine which is called whenever there is a compare
  *  match on the 16-bit timer's counter. Nearly all AVR processors have a 16-bit timer
@@ -383,5 +704,22 @@ base_text_serial& operator<< (base_text_serial& serial, time_stamp& stamp)
 
 ISR (TIMER1_OVF_vect)
     {
-    ust_overflows++;
+    if (++ust_overflows == 0)
+        ust_epochs++;
+    }
+
+
+//--------------------------------------------------------------------------------------
+/** This is the interrupt service routine which is called when the Timer 1 counter
+ *  matches the alarm time set by set_alarm(). Its only job is to wake the processor
+ *  from sleep, so it just turns itself off; the alarm is a one-shot. 
+ */
+
+ISR (TIMER1_COMPA_vect)
+    {
+    #if defined __AVR_ATmega644__ || defined __AVR_ATmega324P__
+        TIMSK1 &= ~(1 << OCIE1A);
+    #else
+        TIMSK &= ~(1 << OCIE1A);
+    #endif
     }
@@ -14,6 +14,11 @@
  *      \li 01-05-08  JRR  Converted from time-of-day version to microsecond version
  *      \li 03-27-08  JRR  Added operators + and - for time stamps
  *      \li 03-31-08  JRR  Merged in stl_us_timer (int, long) and set_time (int, long)
+ *      \li 10-16-26       Sized the time data with stdint types so it also fits a host
+ *      \li 10-16-26       Added get_ticks() and ticks_since() for short intervals
+ *      \li 10-16-26       Added long time stamps, which don't wrap, and uptime
+ *      \li 10-16-26       Seconds and microseconds are found without division
+ *      \li 10-16-26       TCNT1 is read with interrupts off, as ISRs use Timer 1 too
  *
  *  License:
  *      This file copyright 2007 by JR Ridgely. It is released under the Lesser GNU
@@ -25,6 +30,9 @@
 #ifndef _STL_US_TIMER_H_
 #define _STL_US_TIMER_H_
 
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
 #include "base_text_serial.h"
 
 //------------------ Macros to be set by user -----------------------------------------
@@ -36,6 +44,12 @@
 
 #define USEC_PER_COUNT  1                   ///< Number of microseconds per timer count
 
+/** This is the smallest number of timer counts for which an alarm will be set. If the
+ *  alarm time is closer than this, there isn't time to go to sleep and wake up again
+ *  before it arrives, so set_alarm() refuses and the caller should just keep running.
+ */
+#define STL_MIN_ALARM_COUNTS    50
+
 //--------------- End of stuff the user needs to set ----------------------------------
 
 
@@ -49,8 +63,8 @@
 
 typedef union
     {
-    long whole;                             ///< All the data as one 32-bit number
-    int half[2];                            ///< The data as an array of 16-bit ints
+    int32_t whole;                          ///< All the data as one 32-bit number
+    int16_t half[2];                        ///< The data as an array of 16-bit ints
     char quarters[4];                       ///< The data as an array of 8-bit chars
     } time_data_32;
 
@@ -96,6 +110,9 @@ class time_stamp
         /// This method returns the number of microseconds in the time stamp
         long get_microsec (void);
 
+        /// This method splits the time into seconds and microseconds, without division
+        void split (int&, long&);
+
         /// This overloaded addition operator adds two time stamps together
         time_stamp operator + (const time_stamp&);
 
@@ -123,6 +140,47 @@ class time_stamp
     };
 
 
+//--------------------------------------------------------------------------------------
+/** This class holds a time stamp which doesn't wrap around for as long as the program
+ *  could possibly run. The usual 32-bit time stamp goes all the way around in about 71
+ *  minutes; that's fine for scheduling, whose comparisons work across the wrap as long
+ *  as the times being compared are less than half of that apart, but not for keeping
+ *  track of how long a device has been up. This time stamp adds a 16-bit count of the
+ *  times the 32-bit time has wrapped, making a 48-bit time which lasts for almost 9
+ *  years. Only the 32-bit part is needed for scheduling, so tasks keep using ordinary
+ *  time stamps and their cheap 32-bit arithmetic. 
+ */
+
+class long_time_stamp
+    {
+    protected:
+        uint16_t epochs;                    ///< Times the 32-bit time has wrapped
+        time_data_32 data;                  ///< The 32-bit time, as in a time_stamp
+
+    public:
+        /// This constructor creates a long time stamp holding time zero
+        long_time_stamp (void) { epochs = 0; data.whole = 0; }
+
+        /// This method returns the time as a count of microseconds
+        uint64_t get_microsec (void) const;
+
+        /// This method returns the number of whole seconds in the time
+        uint32_t get_seconds (void) const;
+
+        /// This method splits the time into seconds and microseconds, without division
+        void split (uint32_t&, uint32_t&) const;
+
+        /// This method returns the lower 32 bits of the time as an ordinary time stamp
+        time_stamp get_short (void) const { return (time_stamp (data.whole)); }
+
+        /// This operator tests if this time is later than or equal to another
+        bool operator >= (const long_time_stamp&) const;
+
+        // This declaration lets the task timer fill in the data
+        friend class task_timer;
+    };
+
+
 //--------------------------------------------------------------------------------------
 /** This class implements a timer to synchronize the operation of tasks on an AVR. The
  *  timer is implemented as a combination of a 16-bit hardware timer (Timer 1 is the 
@@ -146,10 +204,54 @@ class task_timer
 
         /// This method sets the current time to the time in the given time stamp
         bool set_time (time_stamp&);
+
+        // This method arms a compare interrupt to wake the processor at a given time
+        bool set_alarm (time_stamp&);
+
+        // This method saves the current time, which never wraps, in a long time stamp
+        void save_long_time (long_time_stamp&);
+
+        // This method returns the number of seconds since the timer was started
+        uint32_t get_uptime (void);
+
+        /** This method returns the lower 16 bits of the time, read straight from the
+         *  hardware counter. It's much quicker than getting a whole time stamp, and 
+         *  with ticks_since() it can time things which take less than one overflow 
+         *  period, 65 ms at one count per microsecond. The AVR reads a 16-bit timer
+         *  register through one TEMP byte shared by all of Timer 1's 16-bit registers,
+         *  so an interrupt which reads TCNT1 or writes OCR1B between the two halves of
+         *  this read would spoil the high byte; interrupts are turned off for the two
+         *  instructions of the read. All the timer's reads of TCNT1 go through here.
+         *  @return The hardware timer's count
+         */
+        static uint16_t get_ticks (void)
+            {
+            uint8_t sreg = SREG;            // Saved status register
+            uint16_t ticks;                 // The count read from the hardware
+
+            cli ();
+            ticks = TCNT1;
+            SREG = sreg;
+
+            return (ticks);
+            }
+
+        /** This method finds how many timer counts have gone by since a count which 
+         *  was saved with get_ticks(). The subtraction wraps around the way the counter
+         *  does, so the answer is right as long as less than one overflow period has
+         *  gone by. 
+         *  @param start The count saved at the beginning of the interval
+         *  @return The number of timer counts since the start
+         */
+        static uint16_t ticks_since (uint16_t start) 
+            { return ((uint16_t)(get_ticks () - start)); }
     };
 
 //--------------------------------------------------------------------------------------
 /// This operator allows timestamps to be written to serial ports 'cout' style
 base_text_serial& operator<< (base_text_serial&, time_stamp&);
 
+/// This operator writes long time stamps to serial ports as seconds and microseconds
+base_text_serial& operator<< (base_text_serial&, long_time_stamp&);
+
 #endif  // _STL_US_TIMER_H_
@@ -0,0 +1,172 @@
+//======================================================================================
+/** \file text_stream.h
+ *    This file contains a template front end which writes text to one particular kind
+ *    of serial device, such as rs232, without going through base_text_serial's
+ *    virtual methods. Writing through a base_text_serial pointer or reference costs a
+ *    call through the object's table of virtual functions for every string and
+ *    number, and the compiler can't see through it; here the device's class is a
+ *    template parameter, so each call goes straight to the device's own method and
+ *    can be inlined where the method's code can be seen.
+ *
+ *  Usage:
+ *    A text_stream is made for a device which already exists, and written to just as
+ *    the device would be, with the same manipulators and F() strings:
+ *    \code
+ *    text_stream<rs232> fast_port (the_serial_port);
+ *    fast_port << F ("Position: ") << position << endl;
+ *    \endcode
+ *    The stream keeps its own base for numbers, apart from the device's. Code which
+ *    has to work with any kind of device, such as the STL_DEBUG macros and the tasks
+ *    which are given a base_text_serial pointer, still writes through the device's
+ *    base_text_serial interface, which hasn't changed.
+ *
+ *  How it works:
+ *    Each method calls the device's putchar(), puts() or transmit_now() with the
+ *    device's class name in front, which tells the compiler exactly which method to
+ *    call. Numbers are written by format_number(), the same function base_text_serial
+ *    uses, so both give the same text. rs232's putchar() and puts() are written in its
+ *    header, so through a text_stream<rs232> a string is copied into the transmit
+ *    buffer by a loop compiled right into the caller.
+ *
+ *  Revisions:
+ *    \li  10-16-26  Original file
+ *    \li  10-16-26  Flash strings go through put_flash_string(), shared with the base
+ *
+ *  License:
+ *    This file released under the Lesser GNU Public License, version 2. This program
+ *    is intended for educational use only, but it is not limited thereto.
+ */
+//======================================================================================
+
+#ifndef _TEXT_STREAM_H_                     // To prevent text_stream.h from being
+#define _TEXT_STREAM_H_                     // included in a source file more than once
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "base_text_serial.h"               // Manipulators, F() and format_number()
+
+
+//--------------------------------------------------------------------------------------
+/** This class writes text to a serial device of a particular class, calling the
+ *  device's methods directly. The template parameter is:
+ *    \li sDevice: The device's class, which is descended from base_text_serial
+ */
+
+template <class sDevice>
+class text_stream
+    {
+    protected:
+        sDevice* p_device;                  ///< The device to which text is written
+        unsigned char base;                 ///< Base in which numbers are written
+
+        /** This method writes a number in the current base with one call to the
+         *  device's puts().
+         *  @param num The number, sign extended to 32 bits if it's signed
+         *  @param is_signed True if the number is of a signed type
+         *  @param size The size of the number's type in bytes
+         */
+        void put_number (uint32_t num, bool is_signed, unsigned char size)
+            {
+            char buffer[TEXT_NUMBER_SIZE];  // Room for 32 bits in binary and a '\0'
+
+            p_device->sDevice::puts (format_number (buffer + TEXT_NUMBER_SIZE - 1, num,
+                                                    is_signed, size, base));
+            }
+
+        /** This function writes a piece of a flash string straight to the device.
+         *  @param p_dev Pointer to the device
+         *  @param piece The piece of the string, copied into RAM
+         */
+        static void write_flash_piece (void* p_dev, const char* piece)
+            {
+            static_cast<sDevice*> (p_dev)->sDevice::puts (piece);
+            }
+
+    public:
+        /** This constructor makes a stream which writes to the given device.
+         *  @param a_device A reference to the device
+         */
+        text_stream (sDevice& a_device)
+            {
+            p_device = &a_device;
+            base = 10;
+            }
+
+        /** This method gives the device to which the stream writes.
+         *  @return A reference to the device
+         */
+        sDevice& device (void) { return (*p_device); }
+
+        /** This method writes one character as it is.
+         *  @param ch The character to be written
+         *  @return True if the device took the character
+         */
+        bool putchar (char ch) { return (p_device->sDevice::putchar (ch)); }
+
+        /** This method writes a string from RAM.
+         *  @param string Pointer to the string to be written
+         */
+        void puts (const char* string) { p_device->sDevice::puts (string); }
+
+        /** This method writes a string from program memory, in pieces copied onto the
+         *  stack by put_flash_string() as base_text_serial does.
+         *  @param string Pointer to the string in program memory, as made by F()
+         */
+        void puts (const flash_string* string)
+            {
+            put_flash_string (string, write_flash_piece, p_device);
+            }
+
+        // The overloaded left-shift operators write strings and numbers as the ones
+        // in base_text_serial do; manipulators change the formatting
+        text_stream& operator<< (const char* string) { puts (string); return (*this); }
+        text_stream& operator<< (const flash_string* string)
+            { puts (string); return (*this); }
+        text_stream& operator<< (bool value)
+            { putchar (value ? 'T' : 'F'); return (*this); }
+        text_stream& operator<< (unsigned char num)
+            { put_number (num, false, sizeof (num)); return (*this); }
+        text_stream& operator<< (char num)
+            { put_number ((int32_t)(signed char)num, true, sizeof (num)); return (*this); }
+        text_stream& operator<< (unsigned int num)
+            { put_number (num, false, sizeof (num)); return (*this); }
+        text_stream& operator<< (int num)
+            { put_number ((int32_t)num, true, sizeof (num)); return (*this); }
+        text_stream& operator<< (unsigned long num)
+            { put_number ((uint32_t)num, false, sizeof (num)); return (*this); }
+        text_stream& operator<< (long num)
+            { put_number ((int32_t)num, true, sizeof (num)); return (*this); }
+
+        /** This operator changes the base of numbers, ends a line or tells the device
+         *  to send what it has saved up, as base_text_serial's does.
+         *  @param manipulator Which of those to do
+         *  @return A reference to this stream
+         */
+        text_stream& operator<< (ser_manipulator manipulator)
+            {
+            switch (manipulator)
+                {
+                case (bin):
+                    base = 2;
+                    break;
+                case (oct):
+                    base = 8;
+                    break;
+                case (dec):
+                    base = 10;
+                    break;
+                case (hex):
+                    base = 16;
+                    break;
+                case (endl):
+                    puts (F ("\r\n"));
+                    break;
+                case (send_now):
+                    p_device->sDevice::transmit_now ();
+                    break;
+                }
+            return (*this);
+            }
+    };
+
+#endif // _TEXT_STREAM_H_
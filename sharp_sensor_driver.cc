@@ -15,6 +15,7 @@
 
 
 #include "sharp_sensor_driver.h"
+#include "stl_log_level.h"      // Text messages filtered by module and level
 
 #define SENSORPORT 0 //!< Pin that the sensor is connected to
 
@@ -55,7 +56,7 @@ int initial_distances[36]; //!< Array to hold the initialization sensor readings
 
 sharp_sensor_driver::sharp_sensor_driver(base_text_serial* p_serial_port) : adc_driver(p_serial_port){
 	ptr_to_serial = p_serial_port;
-	*ptr_to_serial << "Setting up sharp sensor controller" << endl;
+	STL_LOG_WRITE (SENSOR, INFO, ptr_to_serial, F ("Setting up sharp sensor controller") << endl);
 }
 
 //--------------------------------------------------------------------------------------
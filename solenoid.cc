@@ -6,6 +6,8 @@
  *  Revisions:
  *    \li  04-17-08  Created files
  *    \li  04-21-08  Began implementing methods
+ *    \li  10-16-26  Added release(), which can be called from an interrupt
+ *    \li  10-16-26  Messages go through STL_LOG_WRITE so they can be compiled out
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -17,6 +19,7 @@
 #include <avr/io.h>
 #include "rs232.h"                          // Include header for serial port class
 #include "solenoid.h"
+#include "stl_log_level.h"                 // Text messages filtered by module and level
 
 /** \brief Initialization
  *
@@ -27,7 +30,7 @@
 solenoid::solenoid (base_text_serial* p_serial_port)
 {
   ptr_to_serial = p_serial_port;
-  *ptr_to_serial << "Setting up solenid controller" << endl;
+  STL_LOG_WRITE (SOLENOID, INFO, ptr_to_serial, F ("Setting up solenid controller") << endl);
   //Sets up the data direction register to open the relevant bit of Port C
   DDRC = 0x01;
   //Sets the output to zero at the beginning
@@ -56,7 +59,7 @@ return true;
  */
 void solenoid::turn_on (void)
 {
-*ptr_to_serial << "Turning on solenoid" << endl;
+STL_LOG_WRITE (SOLENOID, DEBUG, ptr_to_serial, F ("Turning on solenoid") << endl);
     PORTC |= 0x01;
 }
 
@@ -64,6 +67,16 @@ void solenoid::turn_on (void)
  */
 void solenoid::turn_off (void)
 {
-*ptr_to_serial << "Turning off solenoid" << endl;
+STL_LOG_WRITE (SOLENOID, DEBUG, ptr_to_serial, F ("Turning off solenoid") << endl);
     PORTC &= 0x00;
 }
+
+/** \brief Turns off %solenoid without printing anything
+ *
+ *  Printing is far too slow for an interrupt service routine, so this is the way to
+ *  turn the %solenoid off from a timer wheel function
+ */
+void solenoid::release (void)
+{
+    PORTC &= ~0x01;
+}
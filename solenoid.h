@@ -4,6 +4,7 @@
  *
  *  Revisions:
  *    \li  06-01-08  Created files
+ *    \li  10-16-26  Added release(), which can be called from an interrupt
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -40,6 +41,8 @@ class solenoid
     void turn_on (void);
     //hit the focus of the camera for a certain amount of millisec
     void turn_off (void);
+    //turning off without a message, so it can be done from an interrupt
+    void release (void);
 };
 
 
@@ -4,6 +4,9 @@
  *
  *  Revisions:
  *    \li  05-31-08  Created file
+ *    \li  10-16-26  Fixed the unreachable return at the end of run()
+ *    \li  10-16-26  Rewrote run() as a coroutine, which got rid of reading_requested
+ *    \li  10-16-26  Messages go through STL_LOG_PUTS so they can be compiled out
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -12,18 +15,9 @@
 //======================================================================================
 
 #include "task_logic.h"
-
-// S T A T E S:
-const char GETTING_INIT_READING = 0; //!< Taking an initialization reading
-const char INIT = 1; //!< Moving to take the next initialization reading
-const char SCANNING_POSITIVE = 2; //!< Motor scanning in the positive direction
-const char SCANNING_NEGATIVE = 3; //!< Motor scanning in the negative direction
-const char GETTING_READING = 4; //!< Requesting a reading from the sensor
-const char CHANGE_DETECTED = 5; //!< Change was detected, taking picture and radioing coordinates
-const char FROM_RADIO = 6; //!< Recieves target coordinates from radio
+#include "stl_log_level.h"               // Text messages filtered by module and level
 
 bool turning_positive = true; //!< Direction motor is turning
-bool reading_requested = false; //!< Prevents an infinite loop when taking readings
 bool in_sensor_reading_range; //!< Flag set when the turntable enters the range when a reading should be taken
 bool enable_sensor_reading = true; //!< Flag to prevent more than one reading from being taken at each location
 
@@ -41,14 +35,14 @@ bool enable_sensor_reading = true; //!< Flag to prevent more than one reading fr
 
 
 task_logic::task_logic(time_stamp* t_stamp, task_solenoid* p_task_solenoid, task_sensor* p_task_sensor,
-		task_motor* p_task_motor, task_rad* p_task_radio, triangle* p_triangle, base_text_serial* p_ser) : stl_task (*t_stamp, p_ser){
+		task_motor* p_task_motor, task_rad* p_task_radio, triangle* p_triangle, base_text_serial* p_ser) : stl_co_task (*t_stamp, p_ser){
 	ptr_task_solenoid = p_task_solenoid;
 	ptr_task_sensor = p_task_sensor;
 	ptr_task_motor = p_task_motor;
 	ptr_task_radio = p_task_radio;
 	ptr_serial = p_ser;
 	ptr_triangle = p_triangle;
-	ptr_serial->puts("Logic task constructor\r\n");
+	STL_LOG_PUTS (LOGIC, INFO, ptr_serial, F ("Logic task constructor\r\n"));
 }
 
 //-------------------------------------------------------------------------------------
@@ -57,108 +51,64 @@ task_logic::task_logic(time_stamp* t_stamp, task_solenoid* p_task_solenoid, task
  *  array. Then, it sweeps from left to right, looking for changes from the initial
  *  room state. If it finds a change, it proceeds to take a picture of whatever it saw,
  *  as well as flagging the radio to send out new coordinates. If it detects new info
- *  from the radio, it reads in that information and moves to the new position
+ *  from the radio, it reads in that information and moves to the new position.
+ *  The logic is written as a coroutine (see stl_co_task.h), so each wait picks up
+ *  where it left off the next time the task runs
  *  
- *  \brief Logic control state machine
+ *  \brief Logic control sequence
  *  @param state The state of the task when this run method begins running
  *  @return The state to which the task will transition, or STL_NO_TRANSITION if no
  *      transition is called for at this time
  */
 char task_logic::run(char state){
+	STL_CO_BEGIN(state);
 
-int x_temp;
-int y_temp;
-	switch(state){
-		// Initialization state to get base room readings
-		case(GETTING_INIT_READING):
-			//*ptr_serial << "INIT READING get motor pos: " << ptr_task_motor->get_current_position() << "\r";
-			if(ptr_task_motor->position_stable()){
-				ptr_task_sensor->init_sensor_values();
-				ptr_serial->puts("motor is stable, took an init reading\n\r");
-				return(INIT);
-			}
-			return(GETTING_INIT_READING);
-			break;
-		case(INIT):
-			//ptr_serial->puts("INIT\n\r");
-			if(ptr_task_motor->get_target_position() == 350){
-				if(ptr_task_sensor->check_reading_taken()){
-					turning_positive = false;
-					return(SCANNING_POSITIVE);
-				}
-			}
-			else if(ptr_task_sensor->reading_taken()){
-				ptr_task_motor->increment_position(10);
-			//	ptr_serial->puts("increment! +10\n\r");
-				return(GETTING_INIT_READING);
-			}
-			return(INIT);
+	// Initialization: step around the room 10 degrees at a time, taking a base room
+	// reading each time the motor settles
+	for(;;){
+		STL_CO_WAIT_UNTIL(ptr_task_motor->position_stable());
+		ptr_task_sensor->init_sensor_values();
+		STL_LOG_PUTS (LOGIC, DEBUG, ptr_serial, F ("motor is stable, took an init reading\n\r"));
+		if(ptr_task_motor->get_target_position() == 350)
 			break;
-		case(SCANNING_POSITIVE):
-			//ptr_serial->puts("SCANNING_POSITIVE\n\r");
-			in_sensor_reading_range = (ptr_task_motor->get_current_position() % 10 < 2 || ptr_task_motor->get_current_position() % 10 > 8);
-			if(enable_sensor_reading && in_sensor_reading_range){
-				enable_sensor_reading = false;
-				return(GETTING_READING);
-			}
-			else if(in_sensor_reading_range == false){
-			//	ptr_serial->puts("Reenabling sensor reading\n\r");
-				enable_sensor_reading = true;
-			}
-			if (ptr_task_radio->check())
-				return(FROM_RADIO);
-			return(STL_NO_TRANSITION);
-		// When motor stabalizes, take a reading. reading_requested is a flag which prevents the
-		// task from getting stuck in an infinite loop of taking readings. If the reading taken
-		// is a change from the initialized reading value, go to send the coordinates over the
-		// radio
-		case(GETTING_READING):
-			//ptr_serial->puts("GETTING_READING\n\r");
-			if(reading_requested == false){
-				ptr_task_sensor->take_reading();
-				reading_requested = true;
-			}
-			// Once reading is taken, if change is detected deal with it, else
-			// go back to scanning
-			if(ptr_task_sensor->check_reading_taken()){
-			//	ptr_serial->puts("Checking for a change\n\r");
-				reading_requested = false;
-				if(ptr_task_sensor->change_detected()){
-					return(CHANGE_DETECTED);
-				}
-				else
-					return(SCANNING_POSITIVE);
-			}
-			return(GETTING_READING);
-			break;
-		case(CHANGE_DETECTED):
-			//ptr_serial->puts("CHANGE_DETECTED\n\r");
-			ptr_task_motor->enable_brake();
-			ptr_task_solenoid->take_picture();
-			//*ptr_serial << "after invoking take picture" << endl;
-			// calculate with help of triangulation global coords and send Radio coordinates in task_radio
-			ptr_task_radio->setCoords();
-			if(ptr_task_solenoid->picture_done()){
-			//	*ptr_serial << "inside if statement" << endl;
+		STL_CO_WAIT_UNTIL(ptr_task_sensor->reading_taken());
+		ptr_task_motor->increment_position(10);
+	}
+	STL_CO_WAIT_UNTIL(ptr_task_sensor->check_reading_taken());
+	turning_positive = false;
+
+	// Scanning: take a reading each time the turntable passes a multiple of 10 degrees
+	for(;;){
+		in_sensor_reading_range = (ptr_task_motor->get_current_position() % 10 < 2 || ptr_task_motor->get_current_position() % 10 > 8);
+		if(enable_sensor_reading && in_sensor_reading_range){
+			enable_sensor_reading = false;
+			ptr_task_sensor->take_reading();
+			STL_CO_WAIT_UNTIL(ptr_task_sensor->check_reading_taken());
+
+			// If the reading is a change from the room's initial state, brake, take a
+			// picture, send the coordinates over the radio, and release the brake
+			// once the picture is done
+			if(ptr_task_sensor->change_detected()){
+				ptr_task_motor->enable_brake();
+				ptr_task_solenoid->take_picture();
+				ptr_task_radio->setCoords();
+				STL_CO_WAIT_UNTIL(ptr_task_solenoid->picture_done());
 				ptr_task_motor->disable_brake();
-				return(SCANNING_POSITIVE);
 			}
-			return(CHANGE_DETECTED);
-			break;
-		case(FROM_RADIO):
-	
+		}
+		else if(in_sensor_reading_range == false){
+			enable_sensor_reading = true;
+		}
+
+		// Coordinates from the radio: turn to point at them and take a picture
+		if(ptr_task_radio->check()){
 			ptr_task_motor->change_position(ptr_triangle->global_to_angle(ptr_task_radio->get_coords(1),ptr_task_radio->get_coords(0)));
-			if(ptr_task_motor->position_stable()){
-				ptr_task_solenoid->take_picture();
-			}
-			//*ptr_serial << "after take picture from radio" << endl;
-			if(ptr_task_solenoid->picture_done()){
-				return(SCANNING_POSITIVE);
-			}
-			return(FROM_RADIO);
-			break;
+			STL_CO_WAIT_UNTIL(ptr_task_motor->position_stable());
+			ptr_task_solenoid->take_picture();
+			STL_CO_WAIT_UNTIL(ptr_task_solenoid->picture_done());
+		}
+		STL_CO_YIELD();
+	}
 
-    // If we get here, no transition is called for
-    return (STL_NO_TRANSITION);
-    }
+	STL_CO_END();
 }
@@ -4,6 +4,7 @@
  *
  *  Revisions:
  *    \li  05-31-08  Created file
+ *    \li  10-16-26  Made into a coroutine task
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -21,6 +22,7 @@
 #include "stl_debug.h"
 #include "rs232.h"
 #include "stl_task.h"
+#include "stl_co_task.h"
 #include "solenoid.h"
 #include "task_solenoid.h"
 #include "task_sensor.h"
@@ -30,10 +32,10 @@
 #include "triangle.h"
 
 //-------------------------------------------------------------------------------------
-/** \brief Class which implements a finite state machine to control the main logical flow of our application 
+/** \brief Class which implements a coroutine to control the main logical flow of our application 
  */
 
-class task_logic : public stl_task
+class task_logic : public stl_co_task
     {
     protected:
         task_solenoid* ptr_task_solenoid; //!< Pointer to task_solenoid
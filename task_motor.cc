@@ -4,6 +4,8 @@
  *
  *  Revisions:
  *    \li  05-31-08  Created file
+ *    \li  10-16-26  Position control runs in the Timer 3 control lane
+ *    \li  10-16-26  Messages go through STL_LOG_PUTS so they can be compiled out
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -12,6 +14,7 @@
 //======================================================================================
 
 #include "task_motor.h"
+#include "stl_log_level.h"               // Text messages filtered by module and level
 
 const char INIT = 0; //!< Initializing motor
 const char SCANNING = 1; //!< Scanning from side to side
@@ -33,7 +36,7 @@ task_motor::task_motor (time_stamp* t_stamp, base_text_serial* p_ser, controls*
 	ptr_serial = p_ser;
 	ptr_controls = p_controls;
 	// Say hello
-	ptr_serial->puts ("Motor task constructor\r\n");
+	STL_LOG_PUTS (MOTOR, INFO, ptr_serial, F ("Motor task constructor\r\n"));
 	target_position = 0;
 	previous_position = 0;
 	current_position = 0;
@@ -70,24 +73,26 @@ char task_motor::run (char state){
 			}
 
 			if(move_to_target_flag){
+				// The controller runs at a fixed rate from the Timer 3 interrupt
+				ptr_controls->start_control_lane();
 				return(MOVING_TO_TARGET);
 			}
 			
 			if(current_position > 350 && delay == 0){
-				ptr_serial->puts("Going back\n\r");
+				STL_LOG_PUTS (MOTOR, DEBUG, ptr_serial, F ("Going back\n\r"));
 				ptr_controls->set_power_pct(-30);
 				delay = 1000;
 			}
 			else if(current_position < 10 && delay == 0){
-				ptr_serial->puts("Going forwards\n\r");
+				STL_LOG_PUTS (MOTOR, DEBUG, ptr_serial, F ("Going forwards\n\r"));
 				ptr_controls->set_power_pct(30);
 				delay = 1000;
 			}
 			return (SCANNING);
 
 		case(MOVING_TO_TARGET):
-			ptr_controls->update_geared_position_control();
-			if(move_to_target_flag = false){
+			if(move_to_target_flag == false){
+				ptr_controls->stop_control_lane();
 				ptr_controls->set_power_pct(30);
 				return(SCANNING);
 			}
@@ -95,10 +100,10 @@ char task_motor::run (char state){
 			break;
 
 		case(BRAKE):
-			*ptr_serial << "in brake state" << endl;
+			STL_LOG_WRITE (MOTOR, DEBUG, ptr_serial, F ("in brake state") << endl);
 			if(motor_brake_flag == false){
 				ptr_controls->set_brake(false);
-				*ptr_serial << "in brake state switching to scanning" << endl;
+				STL_LOG_WRITE (MOTOR, INFO, ptr_serial, F ("in brake state switching to scanning") << endl);
 				return(SCANNING);
 			}
 			return(BRAKE);
@@ -153,7 +158,7 @@ void task_motor::return_to_scanning(void){
 bool task_motor::position_stable(void){
 	//*ptr_serial << "checking position stability, target: " << target_position << " current position: " << current_position << endl;
 	if(current_position > (target_position - 2) && current_position < (target_position + 2)){
-		ptr_serial->puts("STABLE!");
+		STL_LOG_PUTS (MOTOR, DEBUG, ptr_serial, F ("STABLE!"));
 		return true;
 	}
 	return false;
@@ -162,7 +167,7 @@ bool task_motor::position_stable(void){
 /** \brief Method to enable the brake
  */	
 void task_motor::enable_brake(void){
-	*ptr_serial << "brake enabled" << endl;
+	STL_LOG_WRITE (MOTOR, INFO, ptr_serial, F ("brake enabled") << endl);
 	motor_brake_flag = true;
 }
 
@@ -10,6 +10,13 @@
  *
  *  Revisions:
  *      \li 06-05-08	Initial Release
+ *      \li 10-16-26	Sending is requested with an event instead of a polled flag
+ *      \li 10-16-26	States are dispatched from a table in flash
+ *      \li 10-16-26	Received packets are read in place from the radio's buffer pool
+ *      \li 10-16-26	Coordinates go through packet_link, which checks them with a CRC,
+ *      		acknowledges them and sends them again when they're lost
+ *      \li 10-16-26	Coordinates are written to the binary log instead of printed
+ *      \li 10-16-26	Receiving is done while idle, so polling makes no transitions
  *
  *  License:
  *    This file released under the Lesser GNU Public License, version 2. This program
@@ -26,14 +33,27 @@
 #include "stl_task.h"
 #include "task_rad.h"
 #include "nRF24L01_text.h"              // Nordic nRF24L01 radio module header
+#include "packet_link.h"                // Checked, acknowledged packets over the radio
+#include "stl_log.h"                    // Binary log printed later by a low priority task
+#include "stl_log_level.h"              // Text messages filtered by module and level
 #include "base_text_serial.h"
 #include "triangle.h"    // Include header for this class
 #include "sharp_sensor_driver.h"
 #include "task_motor.h"
 
-#define IDLE 0 //!< Radio is idle
-#define SEND 1 //!< Sending data
-#define RECEIVE 2 //!< Receiving data
+#define EV_SEND 0x01 //!< Event posted when new coordinates are ready to be sent
+
+/// The state table; each row's position must match its state in task_rad's enumeration,
+/// and the constructor checks that there's one row for each state
+const stl_state_row<task_rad> task_rad::state_table[] PROGMEM =
+	{
+	{ NULL, &task_rad::state_idle },	// IDLE
+	{ NULL, &task_rad::state_send }	// SEND
+	};
+
+// These are the only transitions the radio task may make
+STL_ALLOW_TRANSITION (task_rad, IDLE, SEND);
+STL_ALLOW_TRANSITION (task_rad, SEND, IDLE);
 
 //-------------------------------------------------------------------------------------
 /** This constructor creates a radio task class. The radio needs pointers to the base
@@ -41,6 +61,7 @@
  *  @param cameraID 	The ID of the camera
  *  @param packetType	The type of packet to be sent
  *  @param t_stamp 	A timestamp which contains the time between runs of this task
+ *  @param p_timer 	A pointer to the task timer, which times retransmissions
  *  @param p_rad   	A pointer to a radio controller object
  *  @param p_ser   	A pointer to a serial port for sending messages if required
  *  @param p_task_motor  A pointer to a task_motor object
@@ -49,9 +70,10 @@
  */
 
 task_rad::task_rad (unsigned char cameraID, unsigned char packetType, 
-			time_stamp* t_stamp, nRF24L01_text* p_rad, rs232* p_ser,
+			time_stamp* t_stamp, task_timer* p_timer, nRF24L01_text* p_rad, rs232* p_ser,
 			task_motor* p_task_motor, triangle* p_triangle, sharp_sensor_driver* p_sharp_sensor_driver)
-			: stl_task (*t_stamp, p_ser)
+			: stl_table_task<task_rad> (*t_stamp, state_table, p_ser),
+			link (p_rad, p_timer, cameraID, p_ser)
 	{
 	 // Save pointers to other objects
 	p_serial = p_ser;
@@ -65,132 +87,85 @@ task_rad::task_rad (unsigned char cameraID, unsigned char packetType,
 	y = 0;
 	a_i = 0;
 	a_j = 0;
-	end_of_packet = 0xFF;
-	checksum = 0;
+	sth_received = false;
+	send_pending = false;
 
 	// Say hello
-	p_serial->puts ("Radio task constructor\r\n");
+	STL_LOG_PUTS (RADIO, INFO, p_serial, F ("Radio task constructor\r\n"));
 }
 
 
 //-------------------------------------------------------------------------------------
-/** This is the function which runs when it is called by the task scheduler. It allows
- *  the radio to be in three states: reset, receive, and transmit. Reset is used when
- *  starting up and won't run again, but can if needed. Receive mode polls for characters
- *  on the queue and loads them 8 at a time into the receive buffer. Transmit checks to
- *  see if the transmit flag is set and sends the data.
- *  @param state The state of the task when this run method begins running
- *  @return The state to which the task will transition, or STL_NO_TRANSITION if no
- *      transition is called for at this time
- *  \brief Run method
+/** This is the IDLE state of the radio task, in which it waits for something to send.
+ *  Each run it lets the link handle what the radio has received and send again
+ *  anything which hasn't been acknowledged, then takes the coordinates from the packet
+ *  which the link last received, if there is one; the link has already checked the
+ *  packet's CRC and thrown away any repeats. If new coordinates have been posted to
+ *  the task, it goes to transmit them as soon as the link has finished with the last
+ *  ones; newer coordinates replace older ones which haven't been sent yet. Otherwise
+ *  it stays idle, so that a run with nothing to send makes no state transitions.
+ *  @return The state to which the task will transition
+ *  \brief Idle state method
  */
 
-char task_rad::run (char state)
-    {
-    int count;
-    switch (state)
-        {
-        // In State 0, reset the radio
-        case (IDLE):
+stl_next_state task_rad::state_idle (void)
+	{
+	link_packet packet;
+
+	link.poll();
+	if (link.receive(packet) && packet.get_type() == PKT_COORDS)
 		{
-		if (send)
-			{
-			return (SEND);
-			}
-		else
-			{
-			return (RECEIVE);
-			}
-	
+		x = packet[0];
+		y = packet[1];
+		//p_triangulate->setFoundExact(x, y);
+		sth_received = true;
 		}
 
-	case (SEND):
+	if (take_events() & EV_SEND)
+		send_pending = true;
+	if (send_pending && !link.is_busy())
 		{
-		char sendbuffer[4];
+		run_again_ASAP();
+		return (transition<IDLE, SEND> ());
+		}
+	return (stay ());
+	}
 
-		sendbuffer[0] = x;
-		sendbuffer[1] = y;
-		sendbuffer[2] = checksum;
-		sendbuffer[3] = end_of_packet;
+//-------------------------------------------------------------------------------------
+/** This is the SEND state of the radio task. It sends the coordinates to every board
+ *  which is listening, in a packet which the link will send again until it's been
+ *  acknowledged.
+ *  @return The state to which the task will transition
+ *  \brief Send state method
+ */
 
-		*p_serial << endl << "Sending...";
-	
-		for (int n = 0; n < 4; n++)
-			{
-			*p_serial << endl << "S: " << sendbuffer[n];
-			}
+stl_next_state task_rad::state_send (void)
+	{
+	char sendbuffer[2];
 
-		*p_radio << sendbuffer;
+	sendbuffer[0] = x;
+	sendbuffer[1] = y;
 
-		send = false;
-		return (IDLE);
-		}
+	STL_BLOG2 (LOG_RAD_SENDING, x, y);
 
-	case (RECEIVE):
-		{
-		
-		if (p_radio->check_for_char())
-			{
-			sth_received = true;
-			//*p_serial << endl << "Receiving...";
-			char temp = 0;
-			char buffer[4];
-			int i = 0;
-			int j = 0;
-			while (temp != 0xFF)
-				{
-				temp = p_radio->getchar();
-                                j++;
-				if (temp == 0) 
-					{
-					if (j > 12) 
-                                           return (IDLE);
-					
-					}
-				else
-					{
-					//*p_serial << endl << temp;
-					buffer[i] = temp;
-					i++;
-					if (i== 4) break;
-					}
-				}
-			char remote_Checksum = 0;
-			for (int i = 0; i < 2; i++)
-				{
-				remote_Checksum += (int)buffer[i];
-				}
-			if (remote_Checksum != buffer[2])
-				{
-				return (IDLE);
-				}
-			x = buffer[0];
-			y = buffer[1];
-			//p_triangulate->setFoundExact(x, y);
-			
-			//*p_serial << endl << "X: " << x;
-			//*p_serial << endl << "Y: " << y;
-			sth_received = true;
-			return (IDLE);	
-			}
-		}	
-   	}
-   }
+	link.send(LINK_BROADCAST, PKT_COORDS, sendbuffer, 2);
+	send_pending = false;
+
+	return (transition<SEND, IDLE> ());
+	}
 
 /** \brief Loads the current position into the send %buffer
  *
  *  This method calls triangulation methods to calculate a coordinate position
- *  to broadcast, loads that position into the send %buffer, and then sets a
- *  flag to send out the coordinate the next time the radio task is called
+ *  to broadcast, loads that position into the send %buffer, and then posts an
+ *  event so the radio task sends out the coordinate as soon as it can
  */
 void task_rad::setCoords (void)
 	{
     	x = ptr_triangle->angle_to_global (1, ptr_task_motor->get_current_position(), ptr_sharp_sensor_driver->get_distance());
 	y = ptr_triangle->angle_to_global (0, ptr_task_motor->get_current_position(), ptr_sharp_sensor_driver->get_distance());
-*p_serial << "X: " << x;
-*p_serial << "Y: " << y;
-	checkSum();
-	send = true;
+	STL_BLOG2 (LOG_RAD_COORDS, x, y);
+	post_event(EV_SEND);
 	}
 
 /** \brief Sets angles directly, with no distance
@@ -201,14 +176,7 @@ void task_rad::setAngles (char new_i, char new_j)
 	{
     	a_i = new_i;
 	a_j = new_j;
-	checkSum();
-	send = true;
-	}
-
-/** \brief Generates a checksum for the package */
-void task_rad::checkSum()
-	{
-	checksum = (int)x + (int)y;
+	post_event(EV_SEND);
 	}
 
 /** \brief Checks if data has been received */
@@ -11,6 +11,10 @@
  *      \li 05-28-08  Modified for use with the radio
  *	\li 06-03-08  Changed state structure, added checksum, header information
  *	\li 06-03-08  added pointer to triangulator object
+ *	\li 10-16-26  Sending is requested with an event instead of a polled flag
+ *	\li 10-16-26  States are dispatched from a table in flash
+ *	\li 10-16-26  Coordinates are sent in CRC-checked packets which are acknowledged
+ *	\li 10-16-26  The RECEIVE state was folded into IDLE
  *
  *  License:
  *    This file released under the Lesser GNU Public License, version 2. This program
@@ -25,7 +29,9 @@
 #include "stl_us_timer.h"                   // Task timer and time stamp header
 #include "stl_debug.h"
 #include "nRF24L01_text.h"
+#include "packet_link.h"			// Checked, acknowledged packets over the radio
 #include "stl_task.h"
+#include "stl_table_task.h"
 #include "triangle.h"				// Triangulation class converts local coords to global and the other way
 #include "sharp_sensor_driver.h"
 #include "task_motor.h"
@@ -45,16 +51,22 @@ typedef union rad_buffer
  *  and receiving of data
  */
 
-class task_rad : public stl_task
+class task_rad : public stl_table_task<task_rad>
     {
+    public:
+	/// The states of the radio task, in the order of the rows in the state table
+	enum { IDLE, SEND, NUM_STATES };
+
     protected:
+	static const stl_state_row<task_rad> state_table[];	//!< State table, in flash
+
         base_text_serial* p_serial;         //!< Pointer to a serial port for messages
         nRF24L01_text* p_radio;             //!< Pointer to a radio object
+	packet_link link;		    //!< Link protocol which carries packets over the radio
 	task_motor* ptr_task_motor;  //!< Pointer to a task_motor object
 	sharp_sensor_driver* ptr_sharp_sensor_driver; //!< Pointer to a sharp_sensor_driver object
 	triangle* ptr_triangle; //!< Pointer to a triangle object
 	unsigned char count;		    //!< Count for receive/transmit array
-        bool send;		    //!< True if radio is transmitting
 	bool receive;		    //!< True if data has been received
 	rad_buffer transmit_buffer;		    //!< 8-character transmit %buffer
 	rad_buffer receive_buffer;		    //!< 8-character receive %buffer
@@ -64,16 +76,16 @@ class task_rad : public stl_task
 	char y;				//!< 4
 	char a_i;			//!< 5
 	char a_j;			//!< 6
-	char checksum;			//!< 7
-	char end_of_packet;		//!< 8
 	bool sth_received;		//!< Flags that something was received	
+	bool send_pending;		//!< Coordinates are waiting for the link to be free
+
+        // State methods, which are called from the state table
+        stl_next_state state_idle (void);
+        stl_next_state state_send (void);
 
     public:
         // The constructor creates a new task object
-        task_rad (unsigned char, unsigned char, time_stamp*, nRF24L01_text*, rs232*, task_motor*, triangle*, sharp_sensor_driver*);
-
-        // virtual run function for task stuff
-        char run(char);
+        task_rad (unsigned char, unsigned char, time_stamp*, task_timer*, nRF24L01_text*, rs232*, task_motor*, triangle*, sharp_sensor_driver*);
 	
 	// This method loads the transmit buffer for transmission
 	void setCoords (void);
@@ -84,8 +96,6 @@ class task_rad : public stl_task
 	// This method gets two character pointers to modify, returns 1 if data exists
 	void setAngles (char, char);
 
-	void checkSum (void);
-
 	// tells that something was received
 	bool check (void);
 
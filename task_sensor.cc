@@ -4,6 +4,8 @@
  *
  *  Revisions:
  *    \li  05-31-08  Created file
+ *    \li  10-16-26  Readings are requested with events instead of polled flags
+ *    \li  10-16-26  Messages go through STL_LOG_PUTS so they can be compiled out
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -11,12 +13,17 @@
  */
 //======================================================================================
 #include "task_sensor.h"
+#include "stl_log_level.h"              // Text messages filtered by module and level
 
 // S T A T E S:
 const char WAITING = 0;                  		//!< Is waiting for change of state
 const char TAKE_READING = 1;                    	//!< Is taking a reading from ADC-Port
 const char TAKE_INITIAL_READING = 2;			//!< Writes initial values to array
 
+// E V E N T S:
+const unsigned char EV_TAKE_READING = 0x01;		//!< A reading has been requested
+const unsigned char EV_TAKE_INITIAL_READING = 0x02;	//!< An initialization reading has been requested
+
 //-------------------------------------------------------------------------------------
 /** Creates a sensor task object. This object interfaces with the sensor class to allow
  *  readings to be taken in a multitasking fashion
@@ -31,19 +38,21 @@ task_sensor::task_sensor (time_stamp* t_stamp, sharp_sensor_driver* p_sharp_sens
 	ptr_sharp_sensor_driver = p_sharp_sensor_driver;                        // Save pointers to other objects
 	ptr_serial = p_ser;
 	ptr_task_motor = p_task_motor;
-	take_reading_flag = false;
 	reading_taken_flag = true;
 	change_detected_flag = false;
 	latest_reading = 0;
 	// Say hello
-	ptr_serial->puts ("Sensor task constructor\r\n");
+	STL_LOG_PUTS (SENSOR, INFO, ptr_serial, F ("Sensor task constructor\r\n"));
 }
 
 //-------------------------------------------------------------------------------------
 /** \brief Run method for the sensor task
  *  This is the function which runs when it is called by the task scheduler. If a reading
  *  is requested, it transitions into one of the two "take reading" states, one if the
- *  reading asked for was an initialization reading and the other if it was a normal reading
+ *  reading asked for was an initialization reading and the other if it was a normal reading.
+ *  Readings are requested by posting events, so in the WAITING state the task only runs
+ *  when a reading is wanted or its interval times out; the reading is then taken right
+ *  away rather than a whole interval later
  *  @param state The state of the task when this run method begins running
  *  @return The state to which the task will transition, or STL_NO_TRANSITION if no
  *      transition is called for at this time
@@ -51,16 +60,23 @@ task_sensor::task_sensor (time_stamp* t_stamp, sharp_sensor_driver* p_sharp_sens
 
 char task_sensor::run (char state)
 {
+	unsigned char posted;
+
 	switch (state)
 	{
 		case (WAITING):
-			if(take_reading_flag){
-				take_reading_flag = false;
+			posted = take_events();
+			if(posted & EV_TAKE_READING){
+				// An initialization reading asked for at the same time waits its turn
+				if(posted & EV_TAKE_INITIAL_READING){
+					post_event(EV_TAKE_INITIAL_READING);
+				}
 				reading_taken_flag = false;
+				run_again_ASAP();
 				return(TAKE_READING);
 			}
-			if(take_initial_reading_flag){
-				take_initial_reading_flag = false;
+			if(posted & EV_TAKE_INITIAL_READING){
+				run_again_ASAP();
 				return(TAKE_INITIAL_READING);
 			}
 			break;
@@ -80,9 +96,9 @@ char task_sensor::run (char state)
 			break;
 			// If the state isn't a known state, call Houston; we have a problem
 		default:
-			STL_DEBUG_PUTS ("WARNING: Sensor control task in state ");
+			STL_DEBUG_PUTS (F ("WARNING: Sensor control task in state "));
 			STL_DEBUG_WRITE (state);
-			STL_DEBUG_PUTS ("\r\n");
+			STL_DEBUG_PUTS (F ("\r\n"));
 			return(WAITING);
 	};
 	// If we get here, no transition is called for
@@ -106,8 +122,8 @@ bool task_sensor::change_detected(void){
 /** \brief This method is called to tell the sensor to take a reading */
 void task_sensor::take_reading (void)
 {
-	ptr_serial->puts ("Take reading\r\n");
-	take_reading_flag = true;
+	STL_LOG_PUTS (SENSOR, DEBUG, ptr_serial, F ("Take reading\r\n"));
+	post_event(EV_TAKE_READING);
 }
 
 /** \brief This method is called to check if a reading has been taken
@@ -137,6 +153,6 @@ bool task_sensor::reading_taken(void){
 
 void task_sensor::init_sensor_values (void)
 {
-	ptr_serial->puts ("Take initial reading\r\n");
-	take_initial_reading_flag = true;
+	STL_LOG_PUTS (SENSOR, DEBUG, ptr_serial, F ("Take initial reading\r\n"));
+	post_event(EV_TAKE_INITIAL_READING);
 }
@@ -4,6 +4,7 @@
  *
  *  Revisions:
  *    \li  05-31-08  Created file
+ *    \li  10-16-26  Readings are requested with events instead of polled flags
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -39,9 +40,7 @@ class task_sensor : public stl_task
         sharp_sensor_driver* ptr_sharp_sensor_driver;    //!< Pointer to a sharp_sensor_driver object
 		task_motor* ptr_task_motor; //!< Pointer to a task_motor object
         base_text_serial* ptr_serial; //!< Pointer to a serial port for messages
-		bool take_reading_flag; //!< Flag set when a reading is required
 		bool reading_taken_flag; //!< Flag set when that reading is taken
-		bool take_initial_reading_flag; //!< Flag set when an initialization reading is required
 		bool change_detected_flag; //!< Flag set if a change was detected
 		int latest_reading;     //!< Variable to hold the latest value recorded from the sensor
     public:
@@ -5,6 +5,10 @@
  *
  *  Revisions:
  *    \li  05-31-08  Created file
+ *    \li  10-16-26  Pictures are requested with events instead of a polled flag
+ *    \li  10-16-26  The shutter is released by a timer wheel timer, on time
+ *    \li  10-16-26  Messages go through the STL_LOG macros so they can be compiled out
+ *    \li  10-16-26  The unused interval parameter was taken out of the constructor
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -13,42 +17,58 @@
 //======================================================================================
 
 #include "task_solenoid.h"
+#include "stl_log_level.h"            // Text messages filtered by module and level
 
 // S T A T E S:
 const char WAITING = 0;  //!< Waiting for change of state
 const char TAKE_PIC = 1; //!< Taking a picture
 
-unsigned int timer = 0; //!< Timer counter
+// E V E N T S:
+const unsigned char EV_TAKE_PICTURE = 0x01; //!< A picture has been requested
+const unsigned char EV_SHUTTER_RELEASED = 0x02; //!< The shutter timer has run out
 
-int time_to_wake_up = 27000; //!< Number of times the task needs to be called before waking the camera,
-                             //!< to prevent the camera from sleeping (task runs every 10ms)
-int time_to_take_pic = 20; //!< Number of times the task needs to be called to take a picture
+int time_to_wake_up = 270; //!< Number of seconds after which the camera is woken up,
+                           //!< to prevent the camera from sleeping
+long time_to_take_pic = 210000L; //!< Number of microseconds the shutter is held down to take a picture
 
 //-------------------------------------------------------------------------------------
 /** \brief This constructor creates a %solenoid task object. 
  *
- *  The object needs pointers to a solenoid controller in order to operate
- *  @param t_stamp A timestamp which contains the time between runs of this task
+ *  The object needs pointers to a solenoid controller in order to operate, and to
+ *  the timer wheel, from which it gets the timer which releases the shutter. The
+ *  task's interval is the camera's wake-up time, so it isn't given one
  *  @param p_solenoid   A pointer to a solenoid controller object
+ *  @param p_wheel   A pointer to the timer wheel
  *  @param p_ser   A pointer to a serial port for sending messages if required
  */
 
-task_solenoid::task_solenoid (time_stamp* t_stamp, solenoid* p_solenoid, base_text_serial* p_ser)
-    : stl_task (*t_stamp, p_ser)
+task_solenoid::task_solenoid (solenoid* p_solenoid, stl_timer_wheel* p_wheel,
+                              base_text_serial* p_ser)
+    : stl_task (time_stamp (time_to_wake_up, 0L), p_ser)
     {
 	ptr_solenoid = p_solenoid;                        // Save pointers to other objects
+	ptr_wheel = p_wheel;
 	ptr_serial = p_ser;
-	take_picture_flag = false;
 	picture_done_flag = false;
+	shutter_timer = ptr_wheel->create(release_shutter, this);
+
+	// The task only runs when a picture is asked for, when the shutter is released,
+	// or when the camera needs waking up
+	shutter_time.set_time(time_to_take_pic);
+	wake_up_interval.set_time(time_to_wake_up, 0);
+	set_next_run_time(wake_up_interval);
     // Say hello
-    ptr_serial->puts ("Solenoid task constructor\r\n");
+    STL_LOG_PUTS (SOLENOID, INFO, ptr_serial, F ("Solenoid task constructor\r\n"));
     }
 
 //-------------------------------------------------------------------------------------
 /** \brief Run function for the %solenoid task 
  *
- *  This is the function which runs when it is called by the task scheduler. It causes
- *  the solenoid to go up and down, having several states to cause such motion. 
+ *  This is the function which runs when it is called by the task scheduler. In the
+ *  WAITING state the task only runs when a picture is asked for or the camera needs to
+ *  be woken up, so the shutter is pressed as soon as the request is made. The shutter
+ *  is let go by a timer wheel timer exactly time_to_take_pic later, and the task goes
+ *  back to WAITING when the timer tells it so
  *  @param state The state of the task when this run method begins running
  *  @return The state to which the task will transition, or STL_NO_TRANSITION if no
  *      transition is called for at this time
@@ -59,61 +79,63 @@ char task_solenoid::run (char state)
 	//*ptr_serial << "ENTERING SOLENOID TASK" << endl;
 	switch (state)
 	{
-		// In State 0, the motor should stop; when it starts up again, we want it
-		// to be going to the right
+		// In State 0, either a picture was asked for or it's time to wake the
+		// camera up, so the shutter is pressed
 		case (WAITING):
 			//*ptr_serial << "waiting" << endl;
-			timer++;
-			//		*ptr_serial << "Solenoid Timer: " << timer << endl;
-			if(take_picture_flag){
-				//*ptr_serial << "before setting flags" << endl;
-				take_picture_flag = false;
-				picture_done_flag = false;
-				//*ptr_serial << "after setting flags" << endl;
-				timer = 0;
-				//*ptr_serial << "after zeroing timer" << endl;
-				return(TAKE_PIC);
-			}
-			if (timer > time_to_wake_up){
-				take_picture_flag = false;
-				timer = 0;
-				return(TAKE_PIC);
-			}
-			return(WAITING);
+			take_events(EV_TAKE_PICTURE);
+			picture_done_flag = false;
+			ptr_solenoid->turn_on();
+			ptr_wheel->start(shutter_timer, shutter_time);
+			return(TAKE_PIC);
 			break;
 
-			// In State 1, the motor goes to the right
+			// In State 1, the shutter is held down until the timer releases it
 		case (TAKE_PIC):
 			//*ptr_serial << "taking pic" << endl;
-			timer++;
-			*ptr_serial << "picture timer: " << timer << endl;
-			ptr_solenoid->turn_on();
-			if (timer > time_to_take_pic){
-				timer = 0;
-				ptr_solenoid->turn_off();
+			// Requests made while this picture is being taken are for this picture
+			take_events(EV_TAKE_PICTURE);
+			if(take_events(EV_SHUTTER_RELEASED)){
+				STL_LOG_WRITE (SOLENOID, INFO, ptr_serial, F ("picture taken") << endl);
 				picture_done_flag = true;
+				restart_interval();
 				return(WAITING);
 			}
-			return(TAKE_PIC);
+			return(STL_NO_TRANSITION);
 			break;
 			// If the state isn't a known state, call Houston; we have a problem
 		default:
-			STL_DEBUG_PUTS ("WARNING: Solenoid control task in state ");
+			STL_DEBUG_PUTS (F ("WARNING: Solenoid control task in state "));
 			STL_DEBUG_WRITE (state);
-			STL_DEBUG_PUTS ("\r\n");
+			STL_DEBUG_PUTS (F ("\r\n"));
 			return(WAITING);
 	};
 	// If we get here, no transition is called for
 	return (STL_NO_TRANSITION);
 }
 
+/** \brief Wheel timer function which lets go of the shutter
+ *
+ *  This runs in the timer wheel's interrupt, so it only releases the %solenoid and
+ *  tells the task, which does the rest
+ *  \param p_data A pointer to the %solenoid task
+ */
+
+void task_solenoid::release_shutter (void* p_data)
+{
+	task_solenoid* p_task = (task_solenoid*)p_data;
+
+	p_task->ptr_solenoid->release();
+	p_task->post_event(EV_SHUTTER_RELEASED);
+}
+
 /** \brief This method is called to tell the solenoid to take a picture
 */
 
 void task_solenoid::take_picture (void)
 {
 	//ptr_serial->puts ("Taking picture\r\n");
-	take_picture_flag = true;
+	post_event(EV_TAKE_PICTURE);
 }
 
 /** \brief Checks if a picture has been taken.
@@ -124,7 +146,7 @@ void task_solenoid::take_picture (void)
  */
 bool task_solenoid::picture_done(void){
 	if(picture_done_flag){
-		*ptr_serial << "picture done flag being cleared" << endl;
+		STL_LOG_WRITE (SOLENOID, DEBUG, ptr_serial, F ("picture done flag being cleared") << endl);
 		picture_done_flag = false;
 		return true;
 	}
@@ -5,6 +5,8 @@
  *
  *  Revisions:
  *    \li  05-31-08  Created file
+ *    \li  10-16-26  Pictures are requested with events instead of a polled flag
+ *    \li  10-16-26  The shutter is released by a timer wheel timer, on time
  *
  *  License:
  *    This file released under the Lesser GNU Public License. The program is intended
@@ -22,6 +24,7 @@
 #include "stl_debug.h"
 #include "rs232.h"
 #include "stl_task.h"
+#include "stl_timer_wheel.h"
 #include "solenoid.h"
 
 //-------------------------------------------------------------------------------------
@@ -36,12 +39,18 @@ class task_solenoid : public stl_task
     protected:
         solenoid* ptr_solenoid;                 //!< Pointer to solenoid object
         base_text_serial* ptr_serial;         	//!< Pointer to a serial port for messages
-		bool take_picture_flag; //!< Flag set when a picture is to be taken
+		stl_timer_wheel* ptr_wheel; //!< Pointer to the timer wheel
+		unsigned char shutter_timer; //!< Wheel timer which releases the shutter
 		bool picture_done_flag; //!< Flag set when the picture is finished
+		time_stamp shutter_time; //!< Time for which the shutter is held down
+		time_stamp wake_up_interval; //!< Time after which the camera must be woken up
+
+		// Wheel timer function which releases the shutter
+		static void release_shutter(void*);
 
     public:
         // The constructor creates a new task object
-        task_solenoid(time_stamp*, solenoid*, base_text_serial*);
+        task_solenoid(solenoid*, stl_timer_wheel*, base_text_serial*);
 
         // The run method is where the task actually performs its function
         char run(char);
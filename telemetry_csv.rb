@@ -0,0 +1,92 @@
+# Turns a capture of the binary telemetry stream sent by the stl_telemetry task
+# (built with -DSTL_TELEMETRY) into a CSV file, one row per record. Usage:
+#
+#   ruby telemetry_csv.rb capture.bin [channel names...] > capture.csv
+#
+# The capture is every byte which came from the serial port, saved in binary; text
+# mixed in with the frames is skipped, and counted with the bad frames. Channels are named in order by the names
+# given, or ch0, ch1, ... if there aren't enough names; a channel which wasn't sent
+# with a record leaves its cell empty. For the motor controller the names are
+#
+#   position target error error_sum setting
+#
+# Times are in microseconds since the first record. Frames which fail their CRC and
+# records lost on the AVR, shown by gaps in the sequence numbers, are counted on
+# standard error so they don't get into the CSV.
+
+CHANNELS = 8
+
+# The CRC-16 with polynomial 0x1021 which crc16.cc computes, starting from 0xFFFF
+def crc16(bytes)
+  crc = 0xFFFF
+  bytes.each{|byte|
+    crc ^= byte << 8
+    8.times{ crc = (crc & 0x8000) != 0 ? ((crc << 1) ^ 0x1021) & 0xFFFF : (crc << 1) & 0xFFFF }
+  }
+  crc
+end
+
+# Undoes Consistent Overhead Byte Stuffing; returns nil if the frame is malformed
+def cobs_decode(bytes)
+  out = []
+  index = 0
+  while index < bytes.length
+    code = bytes[index]
+    return nil if code == 0 || index + code > bytes.length
+    out.concat(bytes[index + 1, code - 1])
+    index += code
+    out << 0 if code < 0xFF && index < bytes.length
+  end
+  out
+end
+
+filename = ARGV.shift
+names = (0...CHANNELS).map{|channel| ARGV[channel] || "ch#{channel}"}
+
+data = File.open(filename, 'rb'){|file| file.read}.bytes
+start = nil
+last_sequence = nil
+bad_frames = 0
+lost_records = 0
+used = 0
+
+rows = []
+data.slice_when{|before, after| before == 0 || after == 0}.each{|chunk|
+  next if chunk.include?(0)
+  frame = cobs_decode(chunk)
+  if frame.nil? || frame.length < 9 || crc16(frame[0...-2]) != (frame[-2] << 8 | frame[-1])
+    bad_frames += 1
+    next
+  end
+
+  sequence = frame[0] | frame[1] << 8
+  time = frame[2] | frame[3] << 8 | frame[4] << 16 | frame[5] << 24
+  mask = frame[6]
+  values = Array.new(CHANNELS)
+  offset = 7
+  CHANNELS.times{|channel|
+    next if mask[channel] == 0
+    value = frame[offset] | frame[offset + 1] << 8
+    values[channel] = value >= 0x8000 ? value - 0x10000 : value
+    offset += 2
+  }
+  if offset != frame.length - 2
+    bad_frames += 1
+    next
+  end
+
+  # The sequence number and the timer's count both wrap around
+  lost_records += (sequence - last_sequence - 1) % 2**16 unless last_sequence.nil?
+  last_sequence = sequence
+  start = time if start.nil?
+  used |= mask
+  rows << [sequence, (time - start) % 2**32, values]
+}
+
+columns = (0...CHANNELS).select{|channel| used[channel] != 0}
+puts (['sequence', 'time_us'] + columns.map{|channel| names[channel]}).join(',')
+rows.each{|sequence, time, values|
+  puts ([sequence, time] + columns.map{|channel| values[channel]}).join(',')
+}
+
+$stderr.puts "#{rows.length} records, #{lost_records} lost, #{bad_frames} bad frames"
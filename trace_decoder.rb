@@ -0,0 +1,42 @@
+# Decodes a state transition trace dumped by the stl_trace_drain task (built with
+# -DSTL_TRACE_RING) into a timeline. Usage:
+#
+#   ruby trace_decoder.rb dump.txt [0=logic 1=motor ...]
+#
+# The dump is whatever was captured from the serial port; lines which aren't trace
+# records are ignored. Tasks can be given names by serial number on the command line,
+# otherwise they're shown by number. Times are in microseconds since the first record.
+
+filename = ARGV.shift
+names = {}
+ARGV.each{|arg|
+  number, name = arg.split('=')
+  names[number.to_i] = name
+}
+
+recordRegex = Regexp.new('TR ([0-9A-F]{8}) ([0-9A-F]{2}) ([0-9A-F]{2})', Regexp::IGNORECASE)
+lostRegex = Regexp.new('TL ([0-9A-F]{2})', Regexp::IGNORECASE)
+
+start = nil
+last = nil
+
+File.open(filename){|file| file.readlines}.each{|line|
+  if match = recordRegex.match(line)
+    # The timer's 32 bit count wraps around, so differences are taken modulo 2^32
+    time = match[1].to_i(16)
+    start = time if start.nil?
+    elapsed = (time - start) % 2**32
+    delta = last.nil? ? 0 : (time - last) % 2**32
+    last = time
+
+    id = match[2].to_i(16)
+    task = id >> 4
+    from = id & 0x0F
+    to = match[3].to_i(16)
+    name = names[task] || "task #{task}"
+
+    puts "%10d us  %+8d  %-10s %2d -> %2d" % [elapsed, delta, name, from, to]
+  elsif match = lostRegex.match(line)
+    puts "            ---- #{match[1].to_i(16)} records lost ----"
+  end
+}
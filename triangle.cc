@@ -7,6 +7,10 @@
  *    \li  6-01-08  BC&MR  created constructor and methods
  *    \li  6-01-08  BC&MR  tested and finished methods
  *    \li  6-04-08  BC     debuged methods
+ *    \li  10-16-26        Fixed reading past the table and dividing by zero on the y axis
+ *    \li  10-16-26        Angles steeper than the table give its steepest angle
+ *    \li  10-16-26        Angles are written to the binary log instead of printed
+ *    \li  10-16-26        The banner goes through STL_LOG_WRITE so it can be compiled out
  *
  *    \author Markus Richter
  *    \author Justin Bagley
@@ -18,6 +22,8 @@
 //======================================================================================
 
 #include "triangle.h"    // Include header for this class
+#include "stl_log.h"     // Binary log which is printed later by a low priority task
+#include "stl_log_level.h"  // Text messages filtered by module and level
 
 /** First Column: angle, Second column: inverse tangent of that angle */
 int traing_tbl[45][2]  = {{88,2863},
@@ -132,7 +138,7 @@ int unit_tbl[49][3]   ={{0,1000,0},
 triangle::triangle (base_text_serial* p_serial_port){
 
     ptr_to_serial = p_serial_port;          // Store the serial port pointer locally
-    *ptr_to_serial << "Setting up triangulation" << endl;
+    STL_LOG_WRITE (TRIANGLE, INFO, ptr_to_serial, F ("Setting up triangulation") << endl);
 
     }
 
@@ -208,8 +214,13 @@ int triangle::global_to_angle (signed int x_global, signed int y_global)
 	   y_global= 0 - y_global;
 	   }
 	}
+    // A ratio steeper than the table's first row, or straight along the y axis where
+    // there's no ratio at all, is closest to that row's angle
+    angle = traing_tbl[0][0] + quad - cam_init_angle;
+    if (x_global == 0)
+	return (angle);
     inv_tan = y_global * 100/x_global;
-    for (int n = 0; n <= 45; n++)
+    for (int n = 0; n < 45; n++)
 	{
 	curr_dif= traing_tbl[n][1]-inv_tan;
 
@@ -248,7 +259,7 @@ int triangle::angle_to_global (bool vector, signed int loc_angle, signed int dis
 	bool y_sign=false;
 
 	local_angle = loc_angle + cam_init_angle;
-	*ptr_to_serial << "loc_angle " << loc_angle << " cam_init_angle " << cam_init_angle << " local_angle " << local_angle << endl;
+	STL_BLOG3 (LOG_TRI_ANGLES, loc_angle, cam_init_angle, local_angle);
 	while (local_angle >= 360)
 	local_angle = local_angle - 360;
 	